@@ -0,0 +1,158 @@
+#include "platform.h"
+#include "video_encoder.h"
+#include "content_classifier.h"
+#include "hybrid_video_encoder.h"
+#include "tile_change_detector.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+using namespace SplashTop;
+
+// Bandwidth and CPU of content-routed encoding (tile codec for UI, video
+// codec for embedded video) against each codec alone, on a synthetic
+// spreadsheet with a video playing in one corner.
+// Usage: bench_content_routing [frames]
+
+static const uint32 kWidth = 1920;
+static const uint32 kHeight = 1080;
+static const uint32 kVideoX = 1216, kVideoY = 640, kVideoW = 640, kVideoH = 384;
+
+class MixedScene {
+public:
+    MixedScene() : m_pixels(static_cast<size_t>(kWidth) * kHeight * 4), m_rng(42) {
+        // White sheet with a grey grid and a cell of "text" in most cells
+        for (uint32 y = 0; y < kHeight; y++) {
+            for (uint32 x = 0; x < kWidth; x++) {
+                Set(x, y, (x % 80 == 0 || y % 20 == 0) ? 0xFFC8C8C8 : 0xFFFFFFFF);
+            }
+        }
+        for (uint32 cy = 0; cy < kHeight / 20; cy++) {
+            for (uint32 cx = 0; cx < kWidth / 80; cx++) {
+                if (m_rng() % 4) DrawCell(cx, cy);
+            }
+        }
+    }
+
+    // Retype a few cells and advance the video by one frame
+    void Advance(uint32 frame) {
+        for (int i = 0; i < 3; i++) {
+            DrawCell(m_rng() % (kWidth / 80), m_rng() % (kHeight / 20));
+        }
+        for (uint32 y = 0; y < kVideoH; y++) {
+            for (uint32 x = 0; x < kVideoW; x++) {
+                uint32 noise = m_rng() & 7;
+                uint32 r = (x + frame * 3) / 3 % 256;
+                uint32 g = (y * 2 + frame) / 3 % 256;
+                uint32 b = ((x + y) / 4 + frame * 2) % 256;
+                Set(kVideoX + x, kVideoY + y, 0xFF000000 | ((r ^ noise) << 16) | ((g + noise) % 256 << 8) | b);
+            }
+        }
+    }
+
+    VideoFrame Frame() {
+        VideoFrame frame;
+        frame.data = m_pixels.data();
+        frame.width = kWidth;
+        frame.height = kHeight;
+        frame.stride = kWidth * 4;
+        frame.timestamp = 0;
+        frame.format = 0;
+        return frame;
+    }
+
+private:
+    void Set(uint32 x, uint32 y, uint32 color) {
+        std::memcpy(m_pixels.data() + (static_cast<size_t>(y) * kWidth + x) * 4, &color, 4);
+    }
+
+    void DrawCell(uint32 cx, uint32 cy) {
+        uint32 x0 = cx * 80 + 1, y0 = cy * 20 + 1;
+        if (x0 + 79 > kVideoX && y0 + 19 > kVideoY) return; // Under the video
+        uint32 length = 10 + m_rng() % 60;
+        for (uint32 y = y0; y < y0 + 19; y++) {
+            for (uint32 x = x0; x < x0 + 79; x++) {
+                bool ink = x - x0 > 2 && x - x0 < length && y - y0 > 4 && y - y0 < 15 && (m_rng() % 3 == 0);
+                Set(x, y, ink ? 0xFF202020 : 0xFFFFFFFF);
+            }
+        }
+    }
+
+    std::vector<uint8> m_pixels;
+    std::mt19937 m_rng;
+};
+
+static void RunBenchmark(const char* name, IVideoEncoder& encoder, bool classify, int frames) {
+    MixedScene scene;
+    TileChangeDetector detector(64);
+    ContentClassifier classifier(64);
+    VideoFrame frame = scene.Frame();
+    std::vector<uint8> encoded;
+
+    if (!encoder.Initialize(kWidth, kHeight, 30, 8000000)) {
+        std::cerr << name << ": failed to initialize" << std::endl;
+        return;
+    }
+
+    uint64 bytes = 0;
+    uint32 naturalTiles = 0;
+    std::chrono::nanoseconds elapsed(0);
+
+    for (int i = 0; i < frames; i++) {
+        scene.Advance(i);
+        frame.sequence = i + 1;
+        frame.timestamp = static_cast<uint64>(i) * 33333;
+        detector.Detect(frame, frame.dirtyTiles); // What the capture would report
+
+        auto start = std::chrono::steady_clock::now();
+        if (classify) naturalTiles = classifier.Classify(frame);
+        bool ok = encoder.EncodeFrame(frame, encoded);
+        elapsed += std::chrono::steady_clock::now() - start;
+
+        if (ok) bytes += encoded.size();
+    }
+
+    double kibPerFrame = static_cast<double>(bytes) / frames / 1024.0;
+    double mbps = static_cast<double>(bytes) * 8.0 * 30.0 / frames / 1e6;
+    double msPerFrame = std::chrono::duration<double, std::milli>(elapsed).count() / frames;
+
+    std::cout << std::left << std::setw(10) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << kibPerFrame << " KiB/frame"
+              << std::setw(10) << mbps << " Mbit/s @30"
+              << std::setw(9) << std::setprecision(2) << msPerFrame << " ms/frame";
+    if (classify) std::cout << std::setw(6) << naturalTiles << " natural tiles";
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 120;
+
+    std::cout << "SplashTop Content Routing Benchmark" << std::endl;
+    std::cout << "===================================" << std::endl;
+    std::cout << kWidth << "x" << kHeight << " spreadsheet with a " << kVideoW << "x" << kVideoH
+              << " video, " << frames << " frames" << std::endl;
+
+    auto codecs = GetAvailableVideoCodecs();
+    bool haveH264 = std::find(codecs.begin(), codecs.end(), "h264") != codecs.end();
+    const std::string videoCodec = haveH264 ? "h264" : "raw";
+    if (!haveH264) std::cout << "H.264 not available, the video codec is raw" << std::endl;
+    std::cout << std::endl;
+
+    auto video = CreateVideoEncoder(videoCodec);
+    RunBenchmark(videoCodec.c_str(), *video, false, frames);
+
+    auto tiles = CreateVideoEncoder("tile");
+    RunBenchmark("tile", *tiles, false, frames);
+
+    HybridVideoEncoder hybrid(videoCodec);
+    RunBenchmark("hybrid", hybrid, true, frames);
+    std::cout << "  hybrid split: " << hybrid.GetTileLayerBytes() / 1024 << " KiB tile layer, "
+              << hybrid.GetVideoLayerBytes() / 1024 << " KiB video layer" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,458 @@
+#include "platform.h"
+#include "pixel_convert.h"
+#include "yuv_convert.h"
+#include "tile_change_detector.h"
+#include "content_classifier.h"
+#include "codec_registry.h"
+#include "synthetic_screen_capture.h"
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace SplashTop;
+
+// Microbenchmarks of the per-pixel hot paths at 720p, 1080p, 1440p and 4K:
+// XImage to BGRA per visual and kernel (as ConvertImage does), BGRA to
+// YUV420 per kernel and threaded, half-size conversion, tile hashing and
+// change detection, and EncodeFrame per codec and quality preset. Each
+// benchmark repeats until --min-time has been spent on it and reports the
+// median and best time per frame.
+//
+// --json writes the results, one per line; --baseline compares against
+// such a file and exits with 2 if a benchmark got slower by more than
+// --threshold percent.
+// Usage: bench_kernels [--filter text] [--resolution 720p,1080p,1440p,4k,WxH] [--min-time 0.5]
+//                      [--json file] [--baseline file] [--threshold 10]
+
+namespace {
+
+    struct Options {
+        std::vector<std::pair<uint32, uint32>> resolutions = {{1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+        std::string filter;
+        double minSeconds = 0.5;
+        std::string jsonPath;
+        std::string baselinePath;
+        double thresholdPercent = 10.0;
+    };
+
+    struct Result {
+        std::string name;
+        uint32 width = 0;
+        uint32 height = 0;
+        uint64 iterations = 0;
+        double medianMicros = 0.0;
+        double minMicros = 0.0;
+        double bytesPerFrame = 0.0; // Input bytes read per frame, for GB/s
+    };
+
+    const uint32 kMinIterations = 3;
+    volatile uint64 g_sink = 0;
+
+    // Quality presets handed to SetQuality; each encoder maps quality to
+    // its own speed settings (x264 presets, libvpx cpu-used, tile effort)
+    struct EncoderPreset {
+        const char* name;
+        uint32 quality;
+    };
+
+    const EncoderPreset kPresets[] = {{"quality", 80}, {"balanced", 50}, {"speed", 20}};
+
+    // Source images of one resolution, made once and shared by every benchmark
+    struct Images {
+        uint32 width, height;
+        std::vector<uint8> bgra;  // Random pixels, so no kernel gets an easy ride
+        std::vector<uint8> rgb24; // Packed 24-bit visual
+        std::vector<uint8> rgb16; // 5-6-5 visual
+    };
+
+    void FillRandom(std::vector<uint8>& buffer, uint32 seed) {
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i + 4 <= buffer.size(); i += 4) {
+            uint32 word = rng();
+            memcpy(buffer.data() + i, &word, 4);
+        }
+    }
+
+    Images MakeImages(uint32 width, uint32 height) {
+        Images images;
+        images.width = width;
+        images.height = height;
+        images.bgra.resize(static_cast<size_t>(width) * height * 4);
+        images.rgb24.resize(static_cast<size_t>(width) * height * 3 + 4);
+        images.rgb16.resize(static_cast<size_t>(width) * height * 2 + 4);
+        FillRandom(images.bgra, width ^ height);
+        FillRandom(images.rgb24, width + height);
+        FillRandom(images.rgb16, width * height);
+        return images;
+    }
+
+    // Planes for a width x height YUV420 image
+    struct YuvPlanes {
+        std::vector<uint8> data;
+        YuvImage image;
+
+        YuvPlanes(uint32 width, uint32 height) {
+            const uint32 chromaWidth = (width + 1) / 2;
+            const uint32 chromaHeight = (height + 1) / 2;
+            data.resize(static_cast<size_t>(width) * height + static_cast<size_t>(chromaWidth) * chromaHeight * 2);
+            image.y = data.data();
+            image.u = image.y + static_cast<size_t>(width) * height;
+            image.v = image.u + static_cast<size_t>(chromaWidth) * chromaHeight;
+            image.yStride = width;
+            image.uStride = chromaWidth;
+            image.vStride = chromaWidth;
+        }
+    };
+
+    class Runner {
+    public:
+        explicit Runner(const Options& options) : m_options(options) {}
+
+        bool Wants(const std::string& name) const {
+            return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+        }
+
+        // Time body, which returns how long its measured part took, until
+        // min-time has been spent and at least kMinIterations have run
+        template<typename Body>
+        void Run(const std::string& name, uint32 width, uint32 height, double bytesPerFrame, Body body) {
+            if (!Wants(name)) return;
+
+            body(); // Warm up caches, worker threads and encoder state
+            std::vector<double> samples;
+            std::chrono::nanoseconds spent(0);
+            const auto minTime = std::chrono::duration<double>(m_options.minSeconds);
+            while (spent < minTime || samples.size() < kMinIterations) {
+                auto start = std::chrono::steady_clock::now();
+                std::chrono::nanoseconds measured = body();
+                spent += std::chrono::steady_clock::now() - start;
+                samples.push_back(std::chrono::duration<double, std::micro>(measured).count());
+            }
+            std::sort(samples.begin(), samples.end());
+
+            Result result;
+            result.name = name;
+            result.width = width;
+            result.height = height;
+            result.iterations = samples.size();
+            result.medianMicros = samples[samples.size() / 2];
+            result.minMicros = samples.front();
+            result.bytesPerFrame = bytesPerFrame;
+            Print(result);
+            m_results.push_back(result);
+        }
+
+        const std::vector<Result>& GetResults() const { return m_results; }
+
+    private:
+        static void Print(const Result& result) {
+            double megapixels = static_cast<double>(result.width) * result.height / 1e6;
+            std::cout << std::left << std::setw(34) << result.name
+                      << std::setw(11) << (std::to_string(result.width) + "x" + std::to_string(result.height))
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(11) << result.medianMicros << " us"
+                      << std::setw(11) << result.minMicros << " us min"
+                      << std::setw(9) << (result.medianMicros > 0 ? megapixels * 1e6 / result.medianMicros : 0.0) << " MP/s";
+            if (result.bytesPerFrame > 0 && result.medianMicros > 0) {
+                std::cout << std::setw(8) << std::setprecision(2) << result.bytesPerFrame / 1e3 / result.medianMicros << " GB/s";
+            }
+            std::cout << std::endl;
+        }
+
+        const Options& m_options;
+        std::vector<Result> m_results;
+    };
+
+    template<typename Function>
+    std::chrono::nanoseconds Time(Function function) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    const PixelKernel kKernels[] = {PixelKernel::Scalar, PixelKernel::SSE2, PixelKernel::AVX2};
+
+    // The visuals an X server hands ConvertImage most often
+    void BenchmarkPixelConvert(Runner& runner, const Images& images) {
+        struct Visual {
+            const char* name;
+            PixelLayout layout;
+            const std::vector<uint8>* data;
+            uint32 bytesPerPixel;
+        };
+        const Visual visuals[] = {
+            {"bgrx32", {32, 0xFF0000, 0xFF00, 0xFF, false}, &images.bgra, 4},
+            {"rgbx32", {32, 0xFF, 0xFF00, 0xFF0000, false}, &images.bgra, 4},
+            {"rgb24", {24, 0xFF0000, 0xFF00, 0xFF, false}, &images.rgb24, 3},
+            {"rgb565", {16, 0xF800, 0x07E0, 0x001F, false}, &images.rgb16, 2},
+        };
+
+        std::vector<uint8> dst(static_cast<size_t>(images.width) * images.height * 4);
+        for (const Visual& visual : visuals) {
+            for (PixelKernel kernel : kKernels) {
+                if (!IsPixelKernelSupported(kernel, visual.layout)) continue;
+                std::string name = std::string("ximage_to_bgra/") + visual.name + "/" + GetPixelKernelName(kernel);
+                runner.Run(name, images.width, images.height,
+                           static_cast<double>(images.width) * images.height * visual.bytesPerPixel, [&] {
+                    return Time([&] {
+                        ConvertToBGRAWithKernel(kernel, visual.data->data(), images.width * visual.bytesPerPixel,
+                                                visual.layout, dst.data(), images.width * 4, images.width, images.height);
+                    });
+                });
+            }
+        }
+    }
+
+    void BenchmarkYuvConvert(Runner& runner, const Images& images) {
+        const uint32 width = images.width, height = images.height;
+        const double bytes = static_cast<double>(width) * height * 4;
+        YuvPlanes planes(width, height);
+        YuvPlanes halfPlanes((width + 1) / 2, (height + 1) / 2);
+
+        for (PixelKernel kernel : kKernels) {
+            if (!IsPixelKernelAvailable(kernel)) continue;
+            runner.Run(std::string("bgra_to_yuv/") + GetPixelKernelName(kernel), width, height, bytes, [&] {
+                return Time([&] {
+                    ConvertBGRAToYuvWithKernel(kernel, images.bgra.data(), width * 4, width, height, planes.image);
+                });
+            });
+        }
+
+        // What the capture backends actually call
+        YuvConverter threaded(0);
+        runner.Run("bgra_to_yuv/threads:" + std::to_string(threaded.GetThreadCount()), width, height, bytes, [&] {
+            return Time([&] { threaded.Convert(images.bgra.data(), width * 4, width, height, planes.image); });
+        });
+
+        // Downscale: conversion to half size in one pass
+        YuvConverter half(1);
+        half.SetHalfSize(true);
+        runner.Run("downscale_yuv_half", width, height, bytes, [&] {
+            return Time([&] { half.Convert(images.bgra.data(), width * 4, width, height, halfPlanes.image); });
+        });
+    }
+
+    void BenchmarkTiles(Runner& runner, const Images& images) {
+        const uint32 width = images.width, height = images.height;
+        const uint32 tileSize = 64;
+        const double bytes = static_cast<double>(width) * height * 4;
+
+        for (PixelKernel kernel : kKernels) {
+            if (!IsPixelKernelAvailable(kernel)) continue;
+
+            // Every tile of the frame, as after a full-screen change
+            runner.Run(std::string("tile_hash/") + GetPixelKernelName(kernel), width, height, bytes, [&] {
+                uint64 combined = 0;
+                auto elapsed = Time([&] {
+                    for (uint32 y = 0; y < height; y += tileSize) {
+                        for (uint32 x = 0; x < width; x += tileSize) {
+                            combined ^= HashTile(kernel, images.bgra.data() + static_cast<size_t>(y) * width * 4 + x * 4,
+                                                 width * 4, std::min(tileSize, width - x), std::min(tileSize, height - y));
+                        }
+                    }
+                });
+                g_sink = combined; // Keep the hashes alive
+                return elapsed;
+            });
+
+            // Hash and compare a scrolling desktop without damage info
+            SyntheticDesktop desktop(SyntheticWorkload::ScrollingText, width, height);
+            desktop.Step();
+            TileChangeDetector detector(tileSize);
+            detector.SetKernel(kernel);
+            DirtyTileMap dirtyTiles;
+            runner.Run(std::string("tile_diff/") + GetPixelKernelName(kernel), width, height, bytes, [&] {
+                desktop.Step();
+                VideoFrame frame = desktop.GetFrame();
+                return Time([&] { detector.Detect(frame, dirtyTiles); });
+            });
+        }
+    }
+
+    // Encoders see a mixed desktop moving every frame, with the damage,
+    // dirty tiles and content classes the pipeline would give them
+    void BenchmarkEncoders(Runner& runner, uint32 width, uint32 height) {
+        for (const VideoCodecInfo& codec : VideoCodecRegistry::Instance().GetAvailable()) {
+            for (const EncoderPreset& preset : kPresets) {
+                std::string name = "encode/" + codec.name + "/" + preset.name;
+                if (!runner.Wants(name)) continue;
+
+                auto encoder = VideoCodecRegistry::Instance().Create(codec.name);
+                if (!encoder) continue;
+                encoder->SetQuality(preset.quality);
+                encoder->SetKeyframeInterval(0);
+                if (!encoder->Initialize(width, height, 60, 8000000)) {
+                    std::cerr << "Failed to initialize " << codec.name << " encoder at "
+                              << width << "x" << height << std::endl;
+                    continue;
+                }
+
+                SyntheticDesktop desktop(SyntheticWorkload::Mixed, width, height);
+                TileChangeDetector detector(64);
+                ContentClassifier classifier(64);
+                std::vector<uint8> encoded;
+                uint64 sequence = 0;
+                runner.Run(name, width, height, static_cast<double>(width) * height * 4, [&] {
+                    VideoFrame frame = desktop.GetFrame();
+                    frame.dirtyRects = desktop.Step();
+                    frame.hasDamageInfo = true;
+                    frame.sequence = ++sequence;
+                    frame.timestamp = sequence * 16667;
+                    detector.Detect(frame, frame.dirtyTiles);
+                    if (codec.routesByContent) classifier.Classify(frame);
+                    return Time([&] { encoder->EncodeFrame(frame, encoded); });
+                });
+            }
+        }
+    }
+
+    bool ParseResolution(const std::string& text, std::pair<uint32, uint32>& resolution) {
+        if (text == "720p") resolution = {1280, 720};
+        else if (text == "1080p") resolution = {1920, 1080};
+        else if (text == "1440p") resolution = {2560, 1440};
+        else if (text == "4k" || text == "2160p") resolution = {3840, 2160};
+        else {
+            unsigned width = 0, height = 0;
+            char separator = 0;
+            std::istringstream stream(text);
+            if (!(stream >> width >> separator >> height) || separator != 'x') return false;
+            resolution = {width, height};
+        }
+        return resolution.first >= 64 && resolution.second >= 64;
+    }
+
+    std::string ResultKey(const std::string& name, uint32 width, uint32 height) {
+        return name + "@" + std::to_string(width) + "x" + std::to_string(height);
+    }
+
+    bool WriteJson(const std::string& path, const std::vector<Result>& results) {
+        std::ofstream out(path);
+        if (!out) return false;
+        out << std::fixed << std::setprecision(2) << "[\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            out << "  {\"name\": \"" << result.name << "\", \"width\": " << result.width
+                << ", \"height\": " << result.height << ", \"iterations\": " << result.iterations
+                << ", \"medianMicros\": " << result.medianMicros << ", \"minMicros\": " << result.minMicros << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "]" << std::endl;
+        return static_cast<bool>(out);
+    }
+
+    // Reads what WriteJson wrote: one result per line
+    bool ReadBaseline(const std::string& path, std::map<std::string, double>& medians) {
+        std::ifstream in(path);
+        if (!in) return false;
+        auto field = [](const std::string& line, const std::string& key) -> std::string {
+            size_t pos = line.find("\"" + key + "\": ");
+            if (pos == std::string::npos) return std::string();
+            pos += key.size() + 4;
+            if (line[pos] == '"') {
+                size_t end = line.find('"', pos + 1);
+                return end == std::string::npos ? std::string() : line.substr(pos + 1, end - pos - 1);
+            }
+            return line.substr(pos, line.find_first_of(",}", pos) - pos);
+        };
+        std::string line;
+        while (std::getline(in, line)) {
+            std::string name = field(line, "name");
+            std::string median = field(line, "medianMicros");
+            if (name.empty() || median.empty()) continue;
+            uint32 width = static_cast<uint32>(std::atoi(field(line, "width").c_str()));
+            uint32 height = static_cast<uint32>(std::atoi(field(line, "height").c_str()));
+            medians[ResultKey(name, width, height)] = std::atof(median.c_str());
+        }
+        return true;
+    }
+
+    // Returns the number of benchmarks slower than the baseline by more than the threshold
+    int CompareToBaseline(const std::vector<Result>& results, const std::map<std::string, double>& baseline,
+                          double thresholdPercent) {
+        std::cout << std::endl << "Against baseline (threshold " << std::fixed << std::setprecision(1)
+                  << thresholdPercent << "%):" << std::endl;
+        int regressions = 0;
+        for (const Result& result : results) {
+            auto it = baseline.find(ResultKey(result.name, result.width, result.height));
+            if (it == baseline.end() || it->second <= 0) continue;
+            double change = (result.medianMicros / it->second - 1.0) * 100.0;
+            bool regressed = change > thresholdPercent;
+            if (regressed) regressions++;
+            std::cout << std::left << std::setw(34) << result.name
+                      << std::setw(11) << (std::to_string(result.width) + "x" + std::to_string(result.height))
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(11) << it->second << " ->" << std::setw(11) << result.medianMicros << " us"
+                      << std::setw(8) << std::showpos << change << std::noshowpos << "%"
+                      << (regressed ? "  REGRESSED" : "") << std::endl;
+        }
+        return regressions;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--resolution" && hasValue) {
+            options.resolutions.clear();
+            std::istringstream list(argv[++i]);
+            std::string text;
+            while (std::getline(list, text, ',')) {
+                std::pair<uint32, uint32> resolution;
+                if (!ParseResolution(text, resolution)) {
+                    std::cerr << "Bad resolution: " << text << std::endl;
+                    return 1;
+                }
+                options.resolutions.push_back(resolution);
+            }
+        } else if (arg == "--min-time" && hasValue) {
+            options.minSeconds = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            options.thresholdPercent = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter text] [--resolution 720p,1080p,1440p,4k,WxH]"
+                      << " [--min-time seconds] [--json file] [--baseline file] [--threshold percent]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baselinePath.empty() && !ReadBaseline(options.baselinePath, baseline)) {
+        std::cerr << "Cannot read baseline " << options.baselinePath << std::endl;
+        return 1;
+    }
+
+    std::cout << "SplashTop Kernel Benchmark" << std::endl;
+    std::cout << "==========================" << std::endl;
+    std::cout << "Best kernel: " << GetPixelKernelName(GetBestPixelKernel())
+              << ", min time: " << options.minSeconds << " s" << std::endl << std::endl;
+
+    Runner runner(options);
+    for (const auto& resolution : options.resolutions) {
+        Images images = MakeImages(resolution.first, resolution.second);
+        BenchmarkPixelConvert(runner, images);
+        BenchmarkYuvConvert(runner, images);
+        BenchmarkTiles(runner, images);
+        BenchmarkEncoders(runner, resolution.first, resolution.second);
+    }
+
+    if (!options.jsonPath.empty() && !WriteJson(options.jsonPath, runner.GetResults())) {
+        std::cerr << "Cannot write " << options.jsonPath << std::endl;
+        return 1;
+    }
+    if (!baseline.empty() && CompareToBaseline(runner.GetResults(), baseline, options.thresholdPercent) > 0) {
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,338 @@
+#include "platform.h"
+#include "splashtop_app.h"
+#include "codec_registry.h"
+#include "synthetic_screen_capture.h"
+#include "frame_trace.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <sys/resource.h>
+
+using namespace SplashTop;
+
+// Throughput of the whole capture -> encode -> send pipeline on synthetic
+// desktops, without a display: the real SplashTopApp stages run with a
+// SyntheticScreenCapture in place of the platform capture. Results are
+// JSON, one object per workload, resolution and codec. Codecs this build
+// does not have are skipped and listed, rather than measured as the raw
+// frames the app would fall back to.
+// Usage: splashtop_bench [--workload static,scroll,drag,video,mixed] [--resolution 1080p,3840x2160]
+//                        [--codec h264,tile] [--fps 60] [--seconds 5] [--warmup 1] [--yuv] [--half-size]
+//                        [--output file]
+
+namespace {
+
+    struct Options {
+        std::vector<SyntheticWorkload> workloads = GetSyntheticWorkloads();
+        std::vector<std::pair<uint32, uint32>> resolutions = {{1920, 1080}};
+        std::vector<std::string> codecs = {"h264"};
+        uint32 fps = 60;
+        double seconds = 5.0;
+        double warmup = 1.0;
+        bool yuvCapture = false;
+        bool halfSize = false;
+        std::string output;
+    };
+
+    // Input is not benchmarked; this keeps the app from opening a display for it
+    class NullInputInjector : public IInputInjector {
+    public:
+        bool Initialize() override { return true; }
+        bool InjectMouseMove(int32 x, int32 y) override { (void)x; (void)y; return true; }
+        bool InjectMouseButton(uint32 button, bool pressed) override { (void)button; (void)pressed; return true; }
+        bool InjectMouseWheel(int32 delta) override { (void)delta; return true; }
+        bool InjectKey(uint32 key, bool pressed) override { (void)key; (void)pressed; return true; }
+        bool InjectText(const std::string& text) override { (void)text; return true; }
+        void SetCoordinateMapping(uint32 sourceWidth, uint32 sourceHeight,
+                                  uint32 targetWidth, uint32 targetHeight) override {
+            (void)sourceWidth; (void)sourceHeight; (void)targetWidth; (void)targetHeight;
+        }
+        InputStats GetStats() override { return InputStats{}; }
+        bool IsAvailable() const override { return true; }
+    };
+
+    // Everything measured at one instant, so a run is the difference of two
+    struct Sample {
+        uint64 micros;
+        uint64 cpuUserMicros;
+        uint64 cpuSystemMicros;
+        uint64 renderMicros;
+        SplashTopApp::AppStats app;
+    };
+
+    uint64 ToMicros(const timeval& time) {
+        return static_cast<uint64>(time.tv_sec) * 1000000 + time.tv_usec;
+    }
+
+    Sample TakeSample(SplashTopApp& app, const SyntheticScreenCapture& capture) {
+        Sample sample;
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        sample.cpuUserMicros = ToMicros(usage.ru_utime);
+        sample.cpuSystemMicros = ToMicros(usage.ru_stime);
+        sample.renderMicros = capture.GetRenderMicros();
+        sample.app = app.GetStats();
+        sample.micros = StatsNowMicros();
+        return sample;
+    }
+
+    std::vector<std::string> SplitList(const std::string& text) {
+        std::vector<std::string> items;
+        std::istringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    bool ParseResolution(const std::string& text, std::pair<uint32, uint32>& resolution) {
+        if (text == "720p") resolution = {1280, 720};
+        else if (text == "1080p") resolution = {1920, 1080};
+        else if (text == "1440p") resolution = {2560, 1440};
+        else if (text == "4k" || text == "2160p") resolution = {3840, 2160};
+        else {
+            unsigned width = 0, height = 0;
+            char separator = 0;
+            std::istringstream stream(text);
+            if (!(stream >> width >> separator >> height) || separator != 'x') return false;
+            resolution = {width, height};
+        }
+        return resolution.first >= 128 && resolution.second >= 128;
+    }
+
+    double Mean(const std::vector<uint64>& values) {
+        if (values.empty()) return 0.0;
+        double sum = 0.0;
+        for (uint64 value : values) sum += static_cast<double>(value);
+        return sum / values.size();
+    }
+
+    uint64 Percentile(std::vector<uint64> values, double q) {
+        if (values.empty()) return 0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(q * values.size()))];
+    }
+
+    double PerItem(uint64 total, uint64 items) {
+        return items ? static_cast<double>(total) / items : 0.0;
+    }
+
+    // Stage times of the frames captured between from and to, from the frame tracer
+    struct Breakdown {
+        std::vector<uint64> capture, convert, encode, send, total;
+    };
+
+    Breakdown GetBreakdown(uint64 fromMicros, uint64 toMicros) {
+        Breakdown breakdown;
+        auto records = FrameTracer::Instance().GetRecords(std::chrono::microseconds(toMicros - fromMicros + 1000000));
+        for (const FrameTraceRecord& record : records) {
+            uint64 start = record.Get(TraceStage::CaptureStart);
+            if (start < fromMicros || start > toMicros) continue;
+
+            uint64 captured = record.Get(TraceStage::CaptureEnd);
+            if (captured >= start) breakdown.capture.push_back(captured - start);
+
+            uint64 encodeStart = record.Get(TraceStage::EncodeStart);
+            uint64 converted = record.Get(TraceStage::Converted);
+            uint64 encodeEnd = record.Get(TraceStage::EncodeEnd);
+            if (encodeStart && encodeEnd >= encodeStart) {
+                // Only encoders that convert themselves mark Converted
+                uint64 encoded = encodeStart;
+                if (converted >= encodeStart && converted <= encodeEnd) {
+                    breakdown.convert.push_back(converted - encodeStart);
+                    encoded = converted;
+                }
+                breakdown.encode.push_back(encodeEnd - encoded);
+            }
+
+            uint64 sendStart = record.Get(TraceStage::SendStart);
+            uint64 sendEnd = record.Get(TraceStage::SendEnd);
+            if (sendStart && sendEnd >= sendStart) {
+                breakdown.send.push_back(sendEnd - sendStart);
+                breakdown.total.push_back(sendEnd - start);
+            }
+        }
+        return breakdown;
+    }
+
+    bool RunWorkload(const Options& options, SyntheticWorkload workload, std::pair<uint32, uint32> resolution,
+                     const std::string& codec, std::ostream& json) {
+        auto capture = std::make_unique<SyntheticScreenCapture>(workload, resolution.first, resolution.second);
+        SyntheticScreenCapture& synthetic = *capture;
+
+        SplashTopApp app;
+        app.SetVideoCodec(codec);
+        app.SetYuvCapture(options.yuvCapture, options.halfSize);
+        app.SetScreenCapture(std::move(capture));
+        app.SetInputInjector(std::make_unique<NullInputInjector>());
+        app.SetStreamingParameters(options.fps, 8000000, 80);
+        if (!app.Initialize() || !app.StartStreaming()) {
+            std::cerr << "splashtop_bench: could not start " << GetSyntheticWorkloadName(workload) << std::endl;
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+        Sample first = TakeSample(app, synthetic);
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+        Sample last = TakeSample(app, synthetic);
+        app.StopStreaming();
+
+        const double seconds = (last.micros - first.micros) / 1e6;
+        const uint64 captured = last.app.capture.framesCaptured - first.app.capture.framesCaptured;
+        const uint64 encoded = last.app.encoder.framesEncoded - first.app.encoder.framesEncoded;
+        const uint64 encodedBytes = last.app.encoder.totalBytes - first.app.encoder.totalBytes;
+        const uint64 sent = last.app.streaming.framesSent - first.app.streaming.framesSent;
+        const uint64 dropped = last.app.frameQueue.dropped - first.app.frameQueue.dropped;
+        const uint64 skipped = last.app.framesSkipped - first.app.framesSkipped;
+        const uint64 cpuMicros = (last.cpuUserMicros - first.cpuUserMicros) + (last.cpuSystemMicros - first.cpuSystemMicros);
+
+        // Each stage has a thread of its own, so the slowest one sets the pace
+        auto busyPerItem = [&](const SplashTopApp::StageStats& from, const SplashTopApp::StageStats& to) {
+            return PerItem(to.busyMicros - from.busyMicros, to.items - from.items);
+        };
+        double captureBusy = busyPerItem(first.app.captureStage, last.app.captureStage);
+        double encodeBusy = busyPerItem(first.app.encodeStage, last.app.encodeStage);
+        double sendBusy = busyPerItem(first.app.sendStage, last.app.sendStage);
+        double slowest = std::max(captureBusy, std::max(encodeBusy, sendBusy));
+
+        Breakdown breakdown = GetBreakdown(first.micros, last.micros);
+
+        json << std::fixed << std::setprecision(1)
+             << "    {\"workload\": \"" << GetSyntheticWorkloadName(workload) << "\""
+             << ", \"width\": " << resolution.first << ", \"height\": " << resolution.second
+             << ", \"codec\": \"" << codec << "\""
+             << ", \"capture\": \"" << synthetic.GetBackendName() << "\""
+             << ", \"targetFps\": " << options.fps << ", \"seconds\": " << seconds << ",\n"
+             << "     \"frames\": {\"captured\": " << captured << ", \"encoded\": " << encoded
+             << ", \"sent\": " << sent << ", \"dropped\": " << dropped << ", \"skipped\": " << skipped << "},\n"
+             << "     \"microsPerFrame\": {\"capture\": " << Mean(breakdown.capture)
+             << ", \"render\": " << PerItem(last.renderMicros - first.renderMicros, captured)
+             << ", \"convert\": " << Mean(breakdown.convert)
+             << ", \"encode\": " << Mean(breakdown.encode)
+             << ", \"send\": " << Mean(breakdown.send) << "},\n"
+             << "     \"stageBusyMicrosPerFrame\": {\"capture\": " << captureBusy
+             << ", \"encode\": " << encodeBusy << ", \"send\": " << sendBusy << "},\n"
+             << "     \"fpsCeiling\": " << (slowest > 0 ? 1e6 / slowest : 0.0)
+             << ", \"fps\": " << (seconds > 0 ? sent / seconds : 0.0)
+             << ", \"bytesPerFrame\": " << PerItem(encodedBytes, encoded)
+             << ", \"bitrate\": " << (seconds > 0 ? encodedBytes * 8.0 / seconds : 0.0) << ",\n"
+             << "     \"latencyMicros\": {\"p50\": " << Percentile(breakdown.total, 0.5)
+             << ", \"p99\": " << Percentile(breakdown.total, 0.99) << "},\n"
+             << "     \"cpu\": {\"userSeconds\": " << std::setprecision(3) << (last.cpuUserMicros - first.cpuUserMicros) / 1e6
+             << ", \"systemSeconds\": " << (last.cpuSystemMicros - first.cpuSystemMicros) / 1e6
+             << ", \"cores\": " << (seconds > 0 ? cpuMicros / 1e6 / seconds : 0.0)
+             << ", \"microsPerFrame\": " << std::setprecision(1) << PerItem(cpuMicros, encoded + skipped) << "}}";
+        return true;
+    }
+
+    void PrintUsage(const char* programName) {
+        std::cout << "Usage: " << programName << " [options]" << std::endl;
+        std::cout << "  --workload <list>     static, scroll, drag, video, mixed (default: all)" << std::endl;
+        std::cout << "  --resolution <list>   720p, 1080p, 1440p, 4k or WxH (default: 1080p)" << std::endl;
+        std::cout << "  --codec <list>        Video codecs to run (default: h264)" << std::endl;
+        std::cout << "  --fps <fps>           Capture rate to offer the pipeline (default: 60)" << std::endl;
+        std::cout << "  --seconds <s>         Measured time per run (default: 5)" << std::endl;
+        std::cout << "  --warmup <s>          Time before measuring (default: 1)" << std::endl;
+        std::cout << "  --yuv, --half-size    Capture straight to YUV420, optionally halved" << std::endl;
+        std::cout << "  --output <file>       Write the JSON there instead of stdout" << std::endl;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else if (arg == "--workload" && hasValue) {
+            options.workloads.clear();
+            for (const std::string& name : SplitList(argv[++i])) {
+                SyntheticWorkload workload;
+                if (!ParseSyntheticWorkload(name, workload)) {
+                    std::cerr << "Unknown workload: " << name << std::endl;
+                    return 1;
+                }
+                options.workloads.push_back(workload);
+            }
+        } else if (arg == "--resolution" && hasValue) {
+            options.resolutions.clear();
+            for (const std::string& text : SplitList(argv[++i])) {
+                std::pair<uint32, uint32> resolution;
+                if (!ParseResolution(text, resolution)) {
+                    std::cerr << "Bad resolution: " << text << std::endl;
+                    return 1;
+                }
+                options.resolutions.push_back(resolution);
+            }
+        } else if (arg == "--codec" && hasValue) {
+            options.codecs = SplitList(argv[++i]);
+        } else if (arg == "--fps" && hasValue) {
+            options.fps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = std::max(0.1, std::atof(argv[++i]));
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--yuv") {
+            options.yuvCapture = true;
+        } else if (arg == "--half-size") {
+            options.halfSize = true;
+        } else if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // The JSON owns stdout; the app's own messages go to stderr
+    std::ostream json(std::cout.rdbuf());
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Cannot write " << options.output << std::endl;
+            return 1;
+        }
+        json.rdbuf(file.rdbuf());
+    }
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    FrameTracer::Instance().SetEnabled(true);
+
+    json << "{\"benchmark\": \"splashtop_bench\", \"threads\": " << std::thread::hardware_concurrency()
+         << ", \"runs\": [\n";
+    bool first = true;
+    int failures = 0;
+    std::vector<std::string> unavailable;
+    for (const std::string& codec : options.codecs) {
+        if (!VideoCodecRegistry::Instance().IsAvailable(codec)) {
+            std::cerr << "splashtop_bench: codec " << codec << " is not available in this build, skipped" << std::endl;
+            unavailable.push_back(codec);
+            continue;
+        }
+        for (const auto& resolution : options.resolutions) {
+            for (SyntheticWorkload workload : options.workloads) {
+                std::ostringstream run;
+                if (!RunWorkload(options, workload, resolution, codec, run)) {
+                    failures++;
+                    continue;
+                }
+                json << (first ? "" : ",\n") << run.str();
+                first = false;
+            }
+        }
+    }
+    json << "\n], \"unavailableCodecs\": [";
+    for (size_t i = 0; i < unavailable.size(); i++) {
+        json << (i ? ", " : "") << "\"" << unavailable[i] << "\"";
+    }
+    json << "]}" << std::endl;
+
+    // Nothing measured is a failure too
+    return failures || first ? 1 : 0;
+}
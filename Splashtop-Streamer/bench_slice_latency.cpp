@@ -0,0 +1,234 @@
+#include "platform.h"
+#include "video_encoder.h"
+#include "splashtop_app.h"
+#include "synthetic_screen_capture.h"
+#include "frame_trace.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+using namespace SplashTop;
+
+// Time-to-first-byte of sliced encoding: how long after EncodePacket()
+// starts the sender gets the first slice, versus the whole frame. Then the
+// same through SplashTopApp's encode and send threads on a synthetic
+// desktop, checking that first slices reach the streamer before their
+// frame has finished encoding; exits with 1 if none do.
+// Usage: bench_slice_latency [iterations]
+
+// Desktop-like content: flat panels, a gradient and some noisy "text" rows,
+// scrolled every frame so the encoder always has work to do
+static void DrawFrame(std::vector<uint8>& buffer, uint32 width, uint32 height, uint32 frameIndex) {
+    std::mt19937 rng(frameIndex);
+    for (uint32 y = 0; y < height; y++) {
+        uint8* row = buffer.data() + static_cast<size_t>(y) * width * 4;
+        uint32 sy = y + frameIndex * 4;
+        bool textRow = (sy / 16) % 3 == 0;
+        for (uint32 x = 0; x < width; x++) {
+            uint8* pixel = row + x * 4;
+            uint8 value = static_cast<uint8>((x + sy) & 0xff);
+            if (textRow && (rng() & 3) == 0) value = 0;
+            pixel[0] = value;
+            pixel[1] = static_cast<uint8>(x < width / 4 ? 0x30 : value);
+            pixel[2] = static_cast<uint8>(sy & 0xff);
+            pixel[3] = 0xff;
+        }
+    }
+}
+
+static void RunBenchmark(const std::string& codec, uint32 width, uint32 height, uint32 slices, int iterations) {
+    auto encoder = CreateVideoEncoder(codec);
+    encoder->SetSliceCount(slices);
+    if (!encoder->Initialize(width, height, 30, 8000000)) {
+        std::cerr << "Failed to initialize " << codec << " encoder" << std::endl;
+        return;
+    }
+
+    std::vector<uint8> buffer(static_cast<size_t>(width) * height * 4);
+    VideoFrame frame;
+    frame.data = buffer.data();
+    frame.width = width;
+    frame.height = height;
+    frame.stride = width * 4;
+    frame.format = 0;
+
+    EncodedPacket packet;
+    std::chrono::nanoseconds firstByteTotal(0), frameTotal(0);
+    uint64 slicesSeen = 0, bytes = 0;
+    int encodedFrames = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        DrawFrame(buffer, width, height, i);
+        frame.sequence = i + 1;
+        frame.timestamp = static_cast<uint64>(i) * 33333;
+
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point firstByte;
+        bool gotSlice = false;
+        bool ok = encoder->EncodePacket(frame, packet, [&](const EncodedSlice& slice) {
+            if (!gotSlice) {
+                firstByte = std::chrono::steady_clock::now();
+                gotSlice = true;
+            }
+            slicesSeen++;
+            bytes += slice.size;
+        });
+        auto end = std::chrono::steady_clock::now();
+
+        // The first frames of a real encoder may be buffered while it warms up
+        if (!ok || !gotSlice) continue;
+        firstByteTotal += firstByte - start;
+        frameTotal += end - start;
+        encodedFrames++;
+    }
+
+    if (encodedFrames == 0) {
+        std::cerr << codec << ": no frames produced" << std::endl;
+        return;
+    }
+
+    double firstByteMs = std::chrono::duration<double, std::milli>(firstByteTotal).count() / encodedFrames;
+    double frameMs = std::chrono::duration<double, std::milli>(frameTotal).count() / encodedFrames;
+
+    std::cout << std::left << std::setw(6) << codec
+              << std::setw(11) << (std::to_string(width) + "x" + std::to_string(height))
+              << std::right << std::setw(3) << slices << " slices"
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << firstByteMs << " ms first byte"
+              << std::setw(10) << frameMs << " ms frame"
+              << std::setw(8) << std::setprecision(1) << static_cast<double>(slicesSeen) / encodedFrames << " slices/frame"
+              << std::setw(10) << std::setprecision(1) << static_cast<double>(bytes) / encodedFrames / 1024.0 << " KiB/frame"
+              << std::endl;
+}
+
+// Notes when the first slice of each frame arrives
+class FirstSliceStreamer : public IWebRTCStreamer {
+public:
+    static constexpr size_t kFrames = FrameTracer::kCapacity;
+
+    bool Initialize() override { return true; }
+    bool StartStreaming(const std::string& signalingServer, uint16 port) override {
+        (void)signalingServer; (void)port;
+        return true;
+    }
+    void StopStreaming() override {}
+    bool SendVideoFrame(const VideoFrame& frame) override { (void)frame; return true; }
+    bool SendVideoSlice(const EncodedSlice& slice) override {
+        if (slice.index == 0) {
+            uint64 now = static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+            m_firstSlice[slice.frameSequence % kFrames] = {slice.frameSequence, now};
+        }
+        return true;
+    }
+    void SetInputCallback(std::function<void(const InputEvent&)> callback) override { (void)callback; }
+    void SetConnectionStateCallback(std::function<void(bool connected)> callback) override { (void)callback; }
+    void SetKeyframeRequestCallback(std::function<void()> callback) override { (void)callback; }
+    StreamingStats GetStats() override { return StreamingStats{}; }
+    void SetBitrate(uint32 bitrate) override { (void)bitrate; }
+    void SetFPS(uint32 fps) override { (void)fps; }
+    void SetQuality(uint32 quality) override { (void)quality; }
+
+    // Arrival of the frame's first slice, 0 if it has not been seen.
+    // Only once streaming has stopped.
+    uint64 GetFirstSliceMicros(uint64 frameSequence) const {
+        const Arrival& arrival = m_firstSlice[frameSequence % kFrames];
+        return arrival.frameSequence == frameSequence ? arrival.micros : 0;
+    }
+
+private:
+    struct Arrival {
+        uint64 frameSequence = 0;
+        uint64 micros = 0;
+    };
+    std::vector<Arrival> m_firstSlice = std::vector<Arrival>(kFrames);
+};
+
+class NullInputInjector : public IInputInjector {
+public:
+    bool Initialize() override { return true; }
+    bool InjectMouseMove(int32 x, int32 y) override { (void)x; (void)y; return true; }
+    bool InjectMouseButton(uint32 button, bool pressed) override { (void)button; (void)pressed; return true; }
+    bool InjectMouseWheel(int32 delta) override { (void)delta; return true; }
+    bool InjectKey(uint32 key, bool pressed) override { (void)key; (void)pressed; return true; }
+    bool InjectText(const std::string& text) override { (void)text; return true; }
+    void SetCoordinateMapping(uint32 sourceWidth, uint32 sourceHeight,
+                              uint32 targetWidth, uint32 targetHeight) override {
+        (void)sourceWidth; (void)sourceHeight; (void)targetWidth; (void)targetHeight;
+    }
+    InputStats GetStats() override { return InputStats{}; }
+    bool IsAvailable() const override { return true; }
+};
+
+// Returns false if no frame's first slice beat its EncodeEnd
+static bool RunPipeline(const std::string& codec, uint32 width, uint32 height, uint32 slices) {
+    auto streamer = std::make_unique<FirstSliceStreamer>();
+    const FirstSliceStreamer& arrivals = *streamer;
+
+    SplashTopApp app;
+    app.SetVideoCodec(codec);
+    app.SetScreenCapture(std::make_unique<SyntheticScreenCapture>(SyntheticWorkload::ScrollingText, width, height));
+    app.SetInputInjector(std::make_unique<NullInputInjector>());
+    app.SetWebRTCStreamer(std::move(streamer));
+    app.SetStreamingParameters(30, 8000000, 80);
+    app.SetSliceCount(slices);
+
+    // App messages would break up the table
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    bool started = app.Initialize() && app.StartStreaming();
+    auto begin = std::chrono::steady_clock::now();
+    if (started) std::this_thread::sleep_for(std::chrono::seconds(2));
+    app.StopStreaming();
+
+    uint32 frames = 0, early = 0;
+    double leadMicros = 0.0;
+    auto window = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    for (const FrameTraceRecord& record : FrameTracer::Instance().GetRecords(window)) {
+        uint64 encodeEnd = record.Get(TraceStage::EncodeEnd);
+        uint64 firstSlice = arrivals.GetFirstSliceMicros(record.frameId);
+        if (!encodeEnd || !firstSlice) continue;
+        frames++;
+        if (firstSlice < encodeEnd) {
+            early++;
+            leadMicros += static_cast<double>(encodeEnd - firstSlice);
+        }
+    }
+    app.Shutdown();
+    std::cout.rdbuf(out);
+    if (!started) {
+        std::cerr << codec << ": pipeline did not start" << std::endl;
+        return false;
+    }
+
+    std::cout << std::left << std::setw(6) << codec
+              << std::setw(11) << (std::to_string(width) + "x" + std::to_string(height))
+              << std::right << std::setw(3) << slices << " slices"
+              << std::setw(6) << early << "/" << frames << " frames sent before encode end"
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << (early ? leadMicros / early / 1000.0 : 0.0) << " ms ahead" << std::endl;
+    return early > 0;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 60;
+
+    std::cout << "SplashTop Slice Latency Benchmark" << std::endl;
+    std::cout << "=================================" << std::endl;
+    std::cout << "Iterations: " << iterations << std::endl << std::endl;
+
+    const uint32 resolutions[][2] = {{1920, 1080}, {3840, 2160}};
+    for (const auto& codec : GetAvailableVideoCodecs()) {
+        for (const auto& resolution : resolutions) {
+            for (uint32 slices : {1u, 2u, 4u, 8u}) {
+                RunBenchmark(codec, resolution[0], resolution[1], slices, iterations);
+            }
+        }
+    }
+
+    std::cout << std::endl << "Through the pipeline" << std::endl;
+    FrameTracer::Instance().SetEnabled(true);
+    bool pipelined = RunPipeline("tile", 1920, 1080, 8);
+
+    return pipelined ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include "platform.h"
+#include "tile_change_detector.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+using namespace SplashTop;
+
+// Microbenchmark for TileChangeDetector at 1080p and 4K.
+// Usage: bench_tile_change [iterations]
+
+struct Scenario {
+    const char* name;
+    double changedFraction; // Fraction of tiles touched between frames
+};
+
+static void FillRandom(std::vector<uint8>& buffer, uint32 seed) {
+    std::mt19937 rng(seed);
+    uint32* words = reinterpret_cast<uint32*>(buffer.data());
+    for (size_t i = 0; i < buffer.size() / 4; i++) words[i] = rng();
+}
+
+// Flip one pixel in a fraction of tiles so the detector has work to find
+static void TouchTiles(VideoFrame& frame, uint32 tileSize, double fraction, std::mt19937& rng) {
+    uint32 tilesX = (frame.width + tileSize - 1) / tileSize;
+    uint32 tilesY = (frame.height + tileSize - 1) / tileSize;
+    uint32 count = static_cast<uint32>(tilesX * tilesY * fraction);
+    for (uint32 i = 0; i < count; i++) {
+        uint32 tx = rng() % tilesX;
+        uint32 ty = rng() % tilesY;
+        uint32 x = std::min<uint32>(tx * tileSize + rng() % tileSize, frame.width - 1);
+        uint32 y = std::min<uint32>(ty * tileSize + rng() % tileSize, frame.height - 1);
+        frame.data[static_cast<size_t>(y) * frame.stride + x * 4] ^= 0x5A;
+    }
+}
+
+static void RunBenchmark(uint32 width, uint32 height, PixelKernel kernel, const Scenario& scenario, int iterations) {
+    std::vector<uint8> buffer(static_cast<size_t>(width) * height * 4);
+    FillRandom(buffer, width ^ height);
+
+    VideoFrame frame;
+    frame.data = buffer.data();
+    frame.width = width;
+    frame.height = height;
+    frame.stride = width * 4;
+    frame.timestamp = 0;
+    frame.format = 0;
+
+    TileChangeDetector detector(64);
+    detector.SetKernel(kernel);
+    DirtyTileMap dirtyTiles;
+    detector.Detect(frame, dirtyTiles); // Prime previous hashes
+
+    std::mt19937 rng(1234);
+    uint64 dirtyTotal = 0;
+    std::chrono::nanoseconds elapsed(0);
+
+    for (int i = 0; i < iterations; i++) {
+        TouchTiles(frame, 64, scenario.changedFraction, rng);
+
+        auto start = std::chrono::steady_clock::now();
+        dirtyTotal += detector.Detect(frame, dirtyTiles);
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    double msPerFrame = std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    double gbPerSecond = (static_cast<double>(buffer.size()) / 1e9) / (msPerFrame / 1000.0);
+
+    std::cout << std::left << std::setw(10) << (std::to_string(width) + "x" + std::to_string(height))
+              << std::setw(8) << GetPixelKernelName(kernel)
+              << std::setw(12) << scenario.name
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << msPerFrame << " ms/frame"
+              << std::setw(10) << std::setprecision(2) << gbPerSecond << " GB/s"
+              << std::setw(10) << std::setprecision(1) << static_cast<double>(dirtyTotal) / iterations << " dirty tiles"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+    std::cout << "SplashTop Tile Change Detector Benchmark" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Tile size: 64x64, iterations: " << iterations << std::endl << std::endl;
+
+    const uint32 resolutions[][2] = {{1920, 1080}, {3840, 2160}};
+    const Scenario scenarios[] = {{"static", 0.0}, {"10% tiles", 0.1}, {"all tiles", 1.0}};
+
+    for (const auto& resolution : resolutions) {
+        for (PixelKernel kernel : {PixelKernel::Scalar, PixelKernel::SSE2, PixelKernel::AVX2}) {
+            if (!IsPixelKernelAvailable(kernel)) continue;
+            for (const auto& scenario : scenarios) {
+                RunBenchmark(resolution[0], resolution[1], kernel, scenario, iterations);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "platform.h"
+#include "yuv_convert.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+using namespace SplashTop;
+
+// Throughput of BGRA to 4:2:0 conversion at 1080p and 4K, per kernel and
+// thread count, and converting to half size in the same pass. GB/s counts
+// the BGRA bytes read.
+// Usage: bench_yuv_convert [iterations]
+
+static void RunBenchmark(uint32 width, uint32 height, PixelKernel kernel, YuvLayout layout, uint32 threads,
+                         int iterations, bool halfSize = false) {
+    std::vector<uint8> src(static_cast<size_t>(width) * height * 4);
+    std::mt19937 rng(width ^ height);
+    uint32* words = reinterpret_cast<uint32*>(src.data());
+    for (size_t i = 0; i < src.size() / 4; i++) words[i] = rng();
+
+    const uint32 outWidth = halfSize ? (width + 1) / 2 : width;
+    const uint32 outHeight = halfSize ? (height + 1) / 2 : height;
+    const uint32 chromaWidth = (outWidth + 1) / 2;
+    const uint32 chromaHeight = (outHeight + 1) / 2;
+    std::vector<uint8> y(static_cast<size_t>(outWidth) * outHeight);
+    std::vector<uint8> u(static_cast<size_t>(chromaWidth) * 2 * chromaHeight);
+    std::vector<uint8> v(static_cast<size_t>(chromaWidth) * chromaHeight);
+
+    YuvImage image;
+    image.layout = layout;
+    image.y = y.data();
+    image.u = u.data();
+    image.v = v.data();
+    image.yStride = outWidth;
+    image.uStride = layout == YuvLayout::NV12 ? chromaWidth * 2 : chromaWidth;
+    image.vStride = chromaWidth;
+
+    YuvConverter converter(threads);
+    converter.SetKernel(kernel);
+    converter.SetHalfSize(halfSize);
+    converter.Convert(src.data(), width * 4, width, height, image); // Warm up caches and workers
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        converter.Convert(src.data(), width * 4, width, height, image);
+    }
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+
+    double msPerFrame = std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    double gbPerSecond = (static_cast<double>(src.size()) / 1e9) / (msPerFrame / 1000.0);
+
+    std::cout << std::left << std::setw(10) << (std::to_string(width) + "x" + std::to_string(height))
+              << std::setw(8) << GetPixelKernelName(kernel)
+              << std::setw(9) << (std::string(layout == YuvLayout::NV12 ? "nv12" : "i420") + (halfSize ? " /2" : ""))
+              << std::setw(2) << converter.GetThreadCount() << " threads "
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << msPerFrame << " ms/frame"
+              << std::setw(10) << std::setprecision(2) << gbPerSecond << " GB/s"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100;
+
+    std::cout << "SplashTop YUV Conversion Benchmark" << std::endl;
+    std::cout << "==================================" << std::endl;
+    std::cout << "BT.709 limited range, iterations: " << iterations << std::endl << std::endl;
+
+    const uint32 resolutions[][2] = {{1920, 1080}, {3840, 2160}};
+
+    for (const auto& resolution : resolutions) {
+        for (PixelKernel kernel : {PixelKernel::Scalar, PixelKernel::SSE2, PixelKernel::AVX2}) {
+            if (!IsPixelKernelAvailable(kernel)) continue;
+            for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12}) {
+                RunBenchmark(resolution[0], resolution[1], kernel, layout, 1, iterations);
+            }
+        }
+        RunBenchmark(resolution[0], resolution[1], GetBestPixelKernel(), YuvLayout::I420, 0, iterations);
+        RunBenchmark(resolution[0], resolution[1], GetBestPixelKernel(), YuvLayout::I420, 1, iterations, true);
+    }
+
+    return 0;
+}
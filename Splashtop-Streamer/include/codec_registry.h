@@ -0,0 +1,63 @@
+#pragma once
+
+#include "platform.h"
+#include "video_encoder.h"
+
+namespace SplashTop {
+
+    // What a registered video codec backend can do
+    struct VideoCodecInfo {
+        std::string name;            // Name used with CreateVideoEncoder / --codec
+        std::string description;
+        int preference = 100;        // Lower is listed (and preferred) first
+        bool hardware = false;       // Encodes on a GPU or fixed-function block
+        bool lossless = false;       // Decoded frames match the capture exactly
+        bool slices = false;         // Frames split into independently sent slices
+        bool routesByContent = false; // Needs VideoFrame::naturalTiles from a ContentClassifier
+        bool yuvInput = false;       // Also encodes YUV420 frames (VideoFrame::format 2)
+    };
+
+    // Table of video encoder backends. Each backend registers itself from
+    // its own source file with a static VideoCodecRegistration, so adding a
+    // codec does not touch the factory. Registration happens during static
+    // initialization; afterwards the registry is only read.
+    class VideoCodecRegistry {
+    public:
+        using Factory = std::function<std::unique_ptr<IVideoEncoder>()>;
+        using Probe = std::function<bool()>; // Can the backend run on this machine?
+
+        static VideoCodecRegistry& Instance();
+
+        // Returns false if the name is already taken
+        bool Register(const VideoCodecInfo& info, Factory factory, Probe probe = nullptr);
+
+        // Create an encoder for a registered, available codec (nullptr otherwise)
+        std::unique_ptr<IVideoEncoder> Create(const std::string& name) const;
+
+        // Registered codec by name, available or not (nullptr if unknown)
+        const VideoCodecInfo* Find(const std::string& name) const;
+
+        bool IsAvailable(const std::string& name) const;
+
+        // Codecs that can run on this machine, most preferred first
+        std::vector<VideoCodecInfo> GetAvailable() const;
+
+    private:
+        struct Entry {
+            VideoCodecInfo info;
+            Factory factory;
+            Probe probe;
+        };
+
+        std::vector<Entry> m_entries;
+    };
+
+    // Registers a backend when its translation unit is initialized
+    struct VideoCodecRegistration {
+        VideoCodecRegistration(const VideoCodecInfo& info, VideoCodecRegistry::Factory factory,
+                               VideoCodecRegistry::Probe probe = nullptr) {
+            VideoCodecRegistry::Instance().Register(info, std::move(factory), std::move(probe));
+        }
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "platform.h"
+#include "pixel_convert.h"
+#include "tile_change_detector.h"
+#include "tile_video_encoder.h"
+
+namespace SplashTop {
+
+    // Per-tile measurements the classifier decides on
+    struct TileFeatures {
+        uint32 colors;       // Distinct colors, TilePalette::kMaxColors + 1 if more
+        float runFraction;   // Color runs per pixel (1 = every pixel differs from its neighbour)
+        float sharpEdges;    // Fraction of color transitions that are high-contrast
+    };
+
+    // Splits a frame into synthetic content (text, UI, flat graphics), which
+    // is best sent by the lossless tile codec, and natural video, which is
+    // best left to a video codec. A tile is natural when it has many colors,
+    // mostly soft edges and keeps changing; the decision needs a couple of
+    // agreeing frames so tiles do not flip between codecs on every update.
+    class ContentClassifier {
+    public:
+        explicit ContentClassifier(uint32 tileSize = 64);
+
+        // Classify the frame and store the result in frame.naturalTiles.
+        // Only changed tiles are measured; the others keep their class and
+        // fall back to synthetic once they stop changing. Returns the number
+        // of natural tiles.
+        uint32 Classify(VideoFrame& frame);
+
+        // Forget all history
+        void Reset();
+
+        // Force an analysis kernel (benchmarks/tests); falls back to scalar if unavailable
+        void SetKernel(PixelKernel kernel);
+
+        uint32 GetTileSize() const { return m_tileSize; }
+
+    private:
+        struct TileState {
+            float changeRate = 0.0f; // Moving average of "changed this frame"
+            int8 votes = 0;          // Positive leans natural, negative synthetic
+            bool natural = false;
+        };
+
+        uint32 m_tileSize;
+        uint32 m_width = 0;
+        uint32 m_height = 0;
+        PixelKernel m_kernel;
+        TileChangeDetector m_detector;
+        DirtyTileMap m_changed;
+        TilePalette m_palette;
+        std::vector<TileState> m_tiles;
+    };
+
+    // Measure one width x height block of BGRA pixels
+    TileFeatures MeasureTile(PixelKernel kernel, const uint8* data, uint32 stride, uint32 width, uint32 height,
+                             TilePalette& palette);
+
+} // namespace SplashTop
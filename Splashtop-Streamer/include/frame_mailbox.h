@@ -0,0 +1,69 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Lock-free triple buffer holding the most recent value published by one
+    // writer thread for one reader thread. The writer never blocks and the
+    // reader always sees the newest complete value; values published while
+    // the reader was busy are simply replaced.
+    template <typename T>
+    class LatestValueMailbox {
+    public:
+        LatestValueMailbox() : m_middle(1), m_back(0), m_front(2), m_generation(0) {}
+
+        // Writer: slot to fill before calling Publish()
+        T& BackSlot() { return m_slots[m_back].value; }
+
+        // Writer: make the back slot visible to the reader. Returns the new generation.
+        uint64 Publish() {
+            uint64 generation = m_generation.load(std::memory_order_relaxed) + 1;
+            m_slots[m_back].generation = generation;
+            m_generation.store(generation, std::memory_order_relaxed);
+            m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+            return generation;
+        }
+
+        // Writer: true if the reader has not yet taken the last published value
+        bool HasUnreadValue() const {
+            return (m_middle.load(std::memory_order_acquire) & kFresh) != 0;
+        }
+
+        // Reader: switch to the newest published value. Returns false if
+        // nothing was published since the last call (the front is a repeat).
+        bool Fetch() {
+            if (!(m_middle.load(std::memory_order_relaxed) & kFresh)) {
+                return false;
+            }
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+            return true;
+        }
+
+        // Reader: value taken by the last successful Fetch()
+        const T& Front() const { return m_slots[m_front].value; }
+
+        // Reader: generation of Front(), 0 if nothing was fetched yet
+        uint64 FrontGeneration() const { return m_slots[m_front].generation; }
+
+        // Number of values published so far (any thread)
+        uint64 GetGeneration() const { return m_generation.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint32 kIndexMask = 3;
+        static constexpr uint32 kFresh = 4;
+
+        struct Slot {
+            T value{};
+            uint64 generation = 0;
+        };
+
+        // Keep the writer- and reader-owned indices off each other's cache line
+        Slot m_slots[3];
+        std::atomic<uint32> m_middle;
+        alignas(64) uint32 m_back;
+        alignas(64) uint32 m_front;
+        alignas(64) std::atomic<uint64> m_generation;
+    };
+
+} // namespace SplashTop
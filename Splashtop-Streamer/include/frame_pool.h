@@ -0,0 +1,42 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // A VideoFrame whose pixel storage is owned by a FramePool
+    struct PooledFrame : VideoFrame {
+        std::vector<uint8> storage;
+
+        // Producer-defined version of the pixel contents (0 = undefined).
+        // Lets a producer bring a recycled frame up to date incrementally.
+        uint64 contentGeneration = 0;
+    };
+
+    // Fixed set of preallocated frames shared through reference counting.
+    // A frame goes back to the pool as soon as the last shared_ptr held
+    // outside the pool is released, so the steady state allocates nothing.
+    // Acquire() must only be called from one thread; frames can be released
+    // from any thread.
+    class FramePool {
+    public:
+        explicit FramePool(size_t maxFrames = 8);
+
+        // Get an unused frame with at least `bytes` of storage. Frames are
+        // created on demand up to maxFrames; returns nullptr when all of
+        // them are still referenced by consumers.
+        std::shared_ptr<PooledFrame> Acquire(size_t bytes);
+
+        // Number of frames created so far
+        size_t GetAllocatedFrames() const { return m_frames.size(); }
+
+        // Number of frames not referenced outside the pool
+        size_t GetFreeFrames() const;
+
+    private:
+        std::vector<std::shared_ptr<PooledFrame>> m_frames;
+        size_t m_maxFrames;
+        size_t m_next;
+    };
+
+} // namespace SplashTop
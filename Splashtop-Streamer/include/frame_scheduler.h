@@ -0,0 +1,93 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Recent timing of a FrameScheduler. Jitter is how far the time between
+    // two ticks strayed from the frame interval; lateness is how long after
+    // its deadline a tick woke up.
+    struct FrameTimingStats {
+        uint64 ticks = 0;
+        uint64 missed = 0;             // Deadlines skipped because the loop fell behind
+        double intervalMicros = 0.0;   // Nominal frame interval
+        double jitterP50Micros = 0.0;
+        double jitterP95Micros = 0.0;
+        double jitterP99Micros = 0.0;
+        double jitterMaxMicros = 0.0;
+        double latenessP99Micros = 0.0;
+    };
+
+    // Paces a loop to a frame rate with absolute deadlines, so the time a
+    // frame takes does not push the following ones back. Deadlines lie on a
+    // grid of whole intervals counted from the steady_clock epoch, shifted
+    // by a phase: two schedulers at the same rate tick in a fixed relation
+    // without talking to each other, and a consumer can place its ticks
+    // just after a producer's (see AlignTo).
+    //
+    // On Linux the wait is clock_nanosleep on CLOCK_MONOTONIC with
+    // TIMER_ABSTIME, which wakes within tens of microseconds of the deadline.
+    // Everything but GetStats belongs to the paced thread.
+    class FrameScheduler {
+    public:
+        // What to do with deadlines that passed while the loop was busy
+        enum class Policy {
+            Skip,   // Drop them and tick once for the most recent
+            CatchUp // Tick right away for up to maxCatchUp of them, then skip
+        };
+
+        explicit FrameScheduler(uint32 fps = 30, Policy policy = Policy::Skip, uint32 maxCatchUp = 2);
+
+        // Both take effect at the next wait and keep the tick grid
+        void SetFPS(uint32 fps);
+        void SetPhase(std::chrono::nanoseconds phase);
+
+        // Move the phase towards lead after the phase of a producer's
+        // timestamps (steady_clock microseconds, as in VideoFrame), smoothed
+        // over a few calls so a noisy producer does not make the ticks jitter
+        void AlignTo(uint64 producerTimestampMicros, std::chrono::microseconds lead);
+
+        // Sleep until the next deadline. Returns the number of deadlines
+        // skipped since the previous tick.
+        uint32 WaitForNextFrame();
+
+        // Deadline of the last tick
+        std::chrono::steady_clock::time_point GetDeadline() const { return m_deadline; }
+        uint32 GetFPS() const { return m_fps; }
+        std::chrono::nanoseconds GetInterval() const { return m_interval; }
+        std::chrono::nanoseconds GetPhase() const { return m_phase; }
+
+        // Forget the statistics and start a new grid at the next wait
+        void Reset();
+
+        // Safe to call from any thread
+        FrameTimingStats GetStats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        // First deadline on the grid after time
+        Clock::time_point NextGridPoint(Clock::time_point time) const;
+        static void SleepUntil(Clock::time_point deadline);
+
+        uint32 m_fps;
+        Policy m_policy;
+        uint32 m_maxCatchUp;
+        std::chrono::nanoseconds m_interval;  // Written under m_statsMutex
+        std::chrono::nanoseconds m_phase{0};
+        Clock::time_point m_deadline;       // Deadline of the last tick
+        Clock::time_point m_lastWake;       // When the last tick woke
+        bool m_started = false;
+        uint32 m_caughtUp = 0;              // Consecutive late ticks let through
+
+        // Recent samples for the percentiles
+        static constexpr size_t kSampleCount = 512;
+        mutable std::mutex m_statsMutex;
+        std::vector<uint32> m_jitter;       // Microseconds, ring of kSampleCount
+        std::vector<uint32> m_lateness;
+        size_t m_nextSample = 0;
+        uint64 m_ticks = 0;
+        uint64 m_missed = 0;
+    };
+
+} // namespace SplashTop
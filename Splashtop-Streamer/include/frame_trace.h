@@ -0,0 +1,84 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Points in a frame's life, in the order it passes them
+    enum class TraceStage : uint32 {
+        CaptureStart, // Capture tick that grabbed the frame
+        CaptureEnd,   // Published by the capture (YUV capture converts before this)
+        Queued,       // Queued for the encoder by the capture stage
+        EncodeStart,
+        Converted,    // Converted to the encoder's input format
+        EncodeEnd,    // Encoded and split into the packet's slices
+        SendStart,    // First slice handed to the streamer, often before EncodeEnd
+        SendEnd,      // Last slice handed to the streamer
+        Dropped,      // Evicted from the frame queue, never encoded
+        Count
+    };
+
+    const char* GetTraceStageName(TraceStage stage);
+
+    // Stage times of one frame, in steady_clock microseconds (0 = not reached)
+    struct FrameTraceRecord {
+        uint64 frameId = 0; // VideoFrame::sequence
+        uint64 times[static_cast<size_t>(TraceStage::Count)] = {};
+
+        uint64 Get(TraceStage stage) const { return times[static_cast<size_t>(stage)]; }
+    };
+
+    // Records when each frame passes each stage, for finding out where the
+    // time between the screen and the wire goes. Records live in a ring
+    // indexed by frame ID, large enough for about a minute at 60 fps; every
+    // thread writes its own stages without locking, and a frame sent again
+    // (keepalive, refinement) keeps only its latest pass.
+    //
+    // Tracing is off by default and then costs one relaxed load per mark.
+    class FrameTracer {
+    public:
+        static FrameTracer& Instance();
+
+        // The first enable allocates the ring
+        void SetEnabled(bool enabled);
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_acquire); }
+
+        // Start the record of a new frame, replacing whatever held its slot.
+        // Capture thread only.
+        void BeginFrame(uint64 frameId, uint64 captureStartMicros);
+
+        // Record a stage of a frame started with BeginFrame; ignored for
+        // frames no longer in the ring (or 0, not numbered)
+        void Mark(uint64 frameId, TraceStage stage);
+        void Mark(uint64 frameId, TraceStage stage, uint64 micros);
+
+        // Records whose capture started within window of the newest one,
+        // oldest first. Frames still in flight may lack later stages.
+        std::vector<FrameTraceRecord> GetRecords(std::chrono::microseconds window) const;
+
+        // Write records as Chrome trace-event JSON, which Perfetto and
+        // chrome://tracing load: one track per pipeline thread, and one
+        // async slice per frame with its queue waits nested inside
+        static void WriteChromeTrace(std::ostream& out, const std::vector<FrameTraceRecord>& records);
+
+        // Write the last window of records to path; false if it cannot be written
+        bool ExportChromeTrace(const std::string& path,
+                               std::chrono::microseconds window = std::chrono::seconds(30)) const;
+
+        static constexpr size_t kCapacity = 4096; // Frames, a power of two
+
+    private:
+        FrameTracer() = default;
+
+        struct alignas(64) Slot {
+            std::atomic<uint64> frameId{0}; // 0 while being reset
+            std::atomic<uint64> times[static_cast<size_t>(TraceStage::Count)] = {};
+        };
+
+        std::atomic<bool> m_enabled{false};
+        std::atomic<Slot*> m_slots{nullptr}; // Set once, by the first enable
+        std::unique_ptr<Slot[]> m_storage;
+        std::mutex m_enableMutex;
+    };
+
+} // namespace SplashTop
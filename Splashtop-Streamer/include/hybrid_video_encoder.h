@@ -0,0 +1,75 @@
+#pragma once
+
+#include "platform.h"
+#include "tile_video_encoder.h"
+#include "video_encoder.h"
+
+namespace SplashTop {
+
+    // Sends synthetic content through the lossless tile codec and the tiles
+    // classified as natural video (VideoFrame::naturalTiles, filled in by the
+    // ContentClassifier) through a video codec. Synthetic tiles are never
+    // copied into the video layer, so they stay static there and cost the
+    // video codec almost nothing. Unclassified frames go entirely to the tile
+    // codec.
+    //
+    // Message layout (little-endian):
+    //   u32 magic 'STH1', u16 tiles across, u16 tiles down,
+    //   natural tile bitmap ((across * down + 7) / 8 bytes, row-major, LSB first),
+    //   u32 tile message size, tile message (see TileVideoEncoder),
+    //   u32 video size, video bitstream (empty if no natural tile changed)
+    // The receiver shows the video layer on natural tiles and the tile layer
+    // everywhere else. Tiles leaving the video layer are resent losslessly.
+    // When the video codec produces nothing for a frame, its changed and
+    // newly natural tiles go through the tile codec instead, and only tiles
+    // whose video the receiver already has stay natural.
+    class HybridVideoEncoder : public IVideoEncoder {
+    public:
+        explicit HybridVideoEncoder(const std::string& videoCodec = "h264");
+        explicit HybridVideoEncoder(std::unique_ptr<IVideoEncoder> video); // E.g. a test double
+
+        bool Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) override;
+        bool EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) override;
+
+        // The two layers must arrive together, so a frame is one slice
+        bool EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) override;
+
+        EncoderStats GetStats() override;
+
+        bool IsHardwareAccelerated() const override { return m_video->IsHardwareAccelerated(); }
+        void SetBitrate(uint32 bitrate) override { m_video->SetBitrate(bitrate); }
+        void SetFPS(uint32 fps) override;
+        void SetQuality(uint32 quality) override;
+        void SetKeyframeInterval(uint32 frames) override;
+        void SetSliceCount(uint32 slices) override { (void)slices; }
+        void RequestKeyframe() override;
+        void SetIntraRefresh(bool enabled) override;
+        std::vector<std::string> GetSupportedCodecs() const override;
+
+        // Bytes each layer produced so far
+        uint64 GetTileLayerBytes() const { return m_tileBytes; }
+        uint64 GetVideoLayerBytes() const { return m_videoBytes; }
+
+    private:
+        // Copy the natural tiles set in mask into the video layer image
+        void CopyTiles(const VideoFrame& frame, const DirtyTileMap& mask);
+
+        TileVideoEncoder m_tiles;
+        std::unique_ptr<IVideoEncoder> m_video;
+        bool m_initialized = false;
+        bool m_lastKeyframe = false;
+
+        DirtyTileMap m_tileMask;   // Tiles for the tile codec this frame
+        DirtyTileMap m_videoMask;  // Natural tiles to refresh in the video layer
+        DirtyTileMap m_wasNatural; // Classification the receiver was last sent
+        DirtyTileMap m_isNatural;  // This frame's, until the video layer is encoded
+        std::vector<uint8> m_videoImage;
+        VideoFrame m_videoFrame = {};
+        std::vector<uint8> m_videoMessage;
+
+        ThroughputMeter m_encoded; // Read by GetStats from other threads
+        uint64 m_tileBytes = 0;
+        uint64 m_videoBytes = 0;
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "platform.h"
+#include "stats.h"
+
+namespace SplashTop {
+
+    // Builds a Prometheus text exposition (format 0.0.4). Declare each
+    // metric family once, then add its samples.
+    class PrometheusWriter {
+    public:
+        // type is "counter", "gauge" or "histogram"
+        void Family(const char* name, const char* type, const char* help);
+
+        // labels without braces, e.g. stage="encode"
+        void Sample(const char* name, double value, const std::string& labels = std::string());
+
+        // Buckets, sum and count of a histogram family, in seconds
+        void Histogram(const char* name, const LatencyHistogram::Snapshot& snapshot,
+                       const std::string& labels = std::string());
+
+        const std::string& GetText() const { return m_text; }
+
+    private:
+        std::string m_text;
+    };
+
+} // namespace SplashTop
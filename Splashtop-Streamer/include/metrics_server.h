@@ -0,0 +1,40 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Minimal HTTP server for Prometheus scrapes: GET /metrics answers with
+    // whatever the handler renders, anything else with 404. One connection
+    // at a time on its own thread, which is plenty for a scraper. POSIX
+    // sockets only; Start fails on Windows.
+    class MetricsServer {
+    public:
+        using Handler = std::function<std::string()>;
+
+        MetricsServer() = default;
+        ~MetricsServer();
+
+        MetricsServer(const MetricsServer&) = delete;
+        MetricsServer& operator=(const MetricsServer&) = delete;
+
+        // Listen on address:port (port 0 picks a free one, see GetPort).
+        // Keep address on loopback unless the metrics may be public.
+        bool Start(const std::string& address, uint16 port, Handler handler);
+        void Stop();
+
+        bool IsRunning() const { return m_running; }
+        uint16 GetPort() const { return m_port; }
+
+    private:
+        void ServeLoop();
+        void ServeConnection(int connection);
+
+        Handler m_handler;
+        int m_socket = -1;
+        uint16 m_port = 0;
+        std::atomic<bool> m_running{false};
+        std::thread m_thread;
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Fixed set of reusable encoder output packets shared through reference
+    // counting, the bitstream counterpart of FramePool. A packet goes back to
+    // the pool when the last shared_ptr held outside the pool is released;
+    // its buffers keep their capacity, so the steady state allocates nothing.
+    // Acquire() must only be called from one thread; packets can be released
+    // from any thread.
+    class PacketPool {
+    public:
+        explicit PacketPool(size_t maxPackets = 4);
+
+        // Get an unused packet. Packets are created on demand up to
+        // maxPackets; returns nullptr when all of them are still referenced.
+        std::shared_ptr<EncodedPacket> Acquire();
+
+        // Like Acquire(), but when all packets are referenced waits up to
+        // timeout for a holder to release one and call NotifyReleased()
+        std::shared_ptr<EncodedPacket> Acquire(std::chrono::microseconds timeout);
+
+        // Wake a thread waiting in Acquire(timeout). Call after dropping a
+        // reference that may have been the last one outside the pool; only
+        // locks when someone is waiting.
+        void NotifyReleased();
+
+        // Number of packets created so far
+        size_t GetAllocatedPackets() const { return m_packets.size(); }
+
+        // Number of packets not referenced outside the pool
+        size_t GetFreePackets() const;
+
+    private:
+        std::vector<std::shared_ptr<EncodedPacket>> m_packets;
+        size_t m_maxPackets;
+        size_t m_next;
+
+        std::mutex m_waitMutex;
+        std::condition_variable m_released;
+        std::atomic<uint32> m_waiters{0};
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Memory layout of a packed source pixel, as described by an XImage
+    struct PixelLayout {
+        uint32 bitsPerPixel; // 16, 24 or 32
+        uint32 redMask;
+        uint32 greenMask;
+        uint32 blueMask;
+        bool msbFirst;       // Byte order of the pixel value in memory
+    };
+
+    // Conversion kernels, ordered from slowest to fastest
+    enum class PixelKernel {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Convert a width x height block of packed pixels to BGRA (alpha = 0xFF),
+    // using the fastest kernel the CPU supports for this layout
+    void ConvertToBGRA(const uint8* src, uint32 srcStride, const PixelLayout& layout,
+                       uint8* dst, uint32 dstStride, uint32 width, uint32 height);
+
+    // Same as ConvertToBGRA but forces a specific kernel. Returns false if the
+    // kernel is not supported by the CPU or cannot handle the layout.
+    bool ConvertToBGRAWithKernel(PixelKernel kernel, const uint8* src, uint32 srcStride,
+                                 const PixelLayout& layout, uint8* dst, uint32 dstStride,
+                                 uint32 width, uint32 height);
+
+    // Check whether a kernel can be used on this CPU for the given layout
+    bool IsPixelKernelSupported(PixelKernel kernel, const PixelLayout& layout);
+
+    // Check whether the CPU can run a kernel's instruction set
+    bool IsPixelKernelAvailable(PixelKernel kernel);
+
+    // Fastest kernel available on this CPU (ignoring layout restrictions)
+    PixelKernel GetBestPixelKernel();
+
+    const char* GetPixelKernelName(PixelKernel kernel);
+
+} // namespace SplashTop
@@ -53,10 +53,7 @@
 #ifdef HAVE_FFMPEG
 extern "C" {
     #include <libavcodec/avcodec.h>
-    #include <libavformat/avformat.h>
     #include <libavutil/avutil.h>
-    #include <libswscale/swscale.h>
-    #include <libswresample/swresample.h>
 }
 #endif
 
@@ -97,7 +94,81 @@ namespace SplashTop {
     using int32 = std::int32_t;
     using int64 = std::int64_t;
 
-    // Video frame structure
+    // Rectangle in frame coordinates
+    struct Rect {
+        int32 x, y;
+        uint32 width, height;
+    };
+
+    // Area to encode at a different quality than the rest of the frame.
+    // qpOffset runs from -1 (much better) to 1 (much worse), as in
+    // libavcodec's AVRegionOfInterest.
+    struct RegionOfInterest {
+        Rect rect;
+        float qpOffset;
+    };
+
+    // One bit per fixed-size tile, set when the tile changed
+    struct DirtyTileMap {
+        uint32 tileSize = 0;
+        uint32 tilesX = 0;
+        uint32 tilesY = 0;
+        std::vector<uint64> bits; // Row-major tile index
+
+        void Resize(uint32 frameWidth, uint32 frameHeight, uint32 size) {
+            tileSize = size;
+            tilesX = (frameWidth + size - 1) / size;
+            tilesY = (frameHeight + size - 1) / size;
+            bits.assign((static_cast<size_t>(tilesX) * tilesY + 63) / 64, 0);
+        }
+
+        bool IsValid() const { return tileSize != 0; }
+
+        bool IsDirty(uint32 tx, uint32 ty) const {
+            size_t index = static_cast<size_t>(ty) * tilesX + tx;
+            return (bits[index / 64] >> (index % 64)) & 1;
+        }
+
+        void SetDirty(uint32 tx, uint32 ty) {
+            size_t index = static_cast<size_t>(ty) * tilesX + tx;
+            bits[index / 64] |= uint64(1) << (index % 64);
+        }
+
+        void MarkRect(const Rect& rect) {
+            if (rect.width == 0 || rect.height == 0) return;
+            uint32 tx0 = static_cast<uint32>(std::max<int32>(rect.x, 0)) / tileSize;
+            uint32 ty0 = static_cast<uint32>(std::max<int32>(rect.y, 0)) / tileSize;
+            uint32 tx1 = std::min((rect.x + rect.width - 1) / tileSize, tilesX - 1);
+            uint32 ty1 = std::min((rect.y + rect.height - 1) / tileSize, tilesY - 1);
+            for (uint32 ty = ty0; ty <= ty1; ty++) {
+                for (uint32 tx = tx0; tx <= tx1; tx++) SetDirty(tx, ty);
+            }
+        }
+
+        void SetAll() {
+            std::fill(bits.begin(), bits.end(), ~uint64(0));
+            size_t count = static_cast<size_t>(tilesX) * tilesY;
+            if (count % 64) bits.back() = (uint64(1) << (count % 64)) - 1;
+        }
+
+        void Clear() { std::fill(bits.begin(), bits.end(), 0); }
+
+        // OR another map of the same geometry into this one
+        void Merge(const DirtyTileMap& other) {
+            for (size_t i = 0; i < bits.size() && i < other.bits.size(); i++) bits[i] |= other.bits[i];
+        }
+
+        uint32 CountDirty() const {
+            uint32 count = 0;
+            for (uint64 word : bits) {
+                for (; word; word &= word - 1) count++;
+            }
+            return count;
+        }
+    };
+
+    // Video frame structure. The pixels are owned by the producer (usually a
+    // FramePool); consumers must never free data, only drop their reference.
     struct VideoFrame {
         uint8* data;
         uint32 width;
@@ -105,6 +176,126 @@ namespace SplashTop {
         uint32 stride;
         uint64 timestamp;
         uint32 format; // 0 = BGRA, 1 = RGBA, 2 = YUV420
+
+        // YUV420 frames hold BT.709 limited range I420 planes back to back:
+        // Y with stride bytes per row, then U and V with stride / 2 bytes per
+        // row and (height + 1) / 2 rows each. stride is even and at least
+        // width rounded up to even.
+        uint8* GetUPlane() const { return data + static_cast<size_t>(stride) * height; }
+        uint8* GetVPlane() const { return GetUPlane() + static_cast<size_t>(stride / 2) * ((height + 1) / 2); }
+        static size_t GetYuv420Size(uint32 stride, uint32 height) {
+            return static_cast<size_t>(stride) * height + static_cast<size_t>(stride / 2) * ((height + 1) / 2) * 2;
+        }
+
+        // Increases by one for every new frame a capture publishes, so a
+        // consumer can tell a new frame from a repeat (0 = not numbered)
+        uint64 sequence = 0;
+
+        // Regions changed since the previous frame handed to the consumer.
+        // Only valid if hasDamageInfo is set; an empty list then means the
+        // frame is identical to the previous one.
+        std::vector<Rect> dirtyRects;
+        bool hasDamageInfo = false;
+
+        // Tiles whose content changed since the previous frame handed to the
+        // consumer (not valid if the capture has no change detection)
+        DirtyTileMap dirtyTiles;
+
+        // Tiles holding natural video (playback, camera) rather than
+        // synthetic UI, set by the ContentClassifier (not valid if the frame
+        // was not classified)
+        DirtyTileMap naturalTiles;
+
+        // Areas the user is working in (around the pointer, recent edits),
+        // set by the RegionOfInterestTracker. Where regions overlap the
+        // first one wins; empty means uniform quality.
+        std::vector<RegionOfInterest> regionsOfInterest;
+
+        // Most dirty rects merged frames carry before they report the whole
+        // frame instead, as the captures cap their pending damage
+        static constexpr size_t kMaxMergedRects = 256;
+
+        // Take over the changes of a frame dropped before encoding, so
+        // encoders that only look at changed areas still send them. Keeps
+        // the vectors' capacity, so a steady stream of drops allocates
+        // nothing.
+        void MergeDroppedFrame(const VideoFrame& dropped) {
+            hasDamageInfo = hasDamageInfo && dropped.hasDamageInfo;
+            if (dirtyRects.size() + dropped.dirtyRects.size() > kMaxMergedRects) {
+                dirtyRects.assign(1, Rect{0, 0, width, height});
+            } else {
+                dirtyRects.insert(dirtyRects.end(), dropped.dirtyRects.begin(), dropped.dirtyRects.end());
+            }
+
+            const DirtyTileMap& droppedTiles = dropped.dirtyTiles;
+            if (dirtyTiles.IsValid() && droppedTiles.tileSize == dirtyTiles.tileSize &&
+                droppedTiles.tilesX == dirtyTiles.tilesX && droppedTiles.tilesY == dirtyTiles.tilesY) {
+                dirtyTiles.Merge(droppedTiles);
+            } else {
+                dirtyTiles.tileSize = 0; // Let the encoder find the changes itself
+            }
+        }
+    };
+
+    // Independently decodable part of an encoded frame, handed to the sender
+    // as soon as it is ready. data points into the EncodedPacket and stays
+    // valid until that packet is next encoded into, so it may be kept past
+    // the callback as long as the packet is.
+    struct EncodedSlice {
+        const uint8* data = nullptr;
+        size_t size = 0;
+        uint32 index = 0;          // Slice number within the frame
+        uint32 count = 1;          // Slices in the frame
+        uint64 frameSequence = 0;  // VideoFrame::sequence of the source frame
+        uint64 timestamp = 0;      // Capture time of the source frame
+        bool keyframe = false;
+
+        bool IsLastInFrame() const { return index + 1 == count; }
+    };
+
+    // One encoded frame in caller-provided storage. Encoders replace the
+    // contents but the buffers keep their capacity, so a reused packet (see
+    // PacketPool) stops allocating once it has grown to the stream's size.
+    struct EncodedPacket {
+        std::vector<uint8> data;
+        std::vector<size_t> sliceEnds; // Offset just past each slice in data
+        uint64 frameSequence = 0;      // VideoFrame::sequence of the source frame
+        uint64 timestamp = 0;          // Capture time of the source frame, used as PTS
+        bool keyframe = false;
+
+        // Empty the packet for a new frame
+        void Reset(const VideoFrame& frame) {
+            data.clear();
+            sliceEnds.clear();
+            frameSequence = frame.sequence;
+            timestamp = frame.timestamp;
+            keyframe = false;
+        }
+
+        // Make data up to end the next of count slices and return a view of it
+        EncodedSlice AddSlice(size_t end, uint32 count) {
+            sliceEnds.push_back(end);
+            return GetSlice(static_cast<uint32>(sliceEnds.size() - 1), count);
+        }
+
+        uint32 GetSliceCount() const { return static_cast<uint32>(sliceEnds.size()); }
+
+        // View of one slice, valid until the packet changes
+        EncodedSlice GetSlice(uint32 index) const { return GetSlice(index, GetSliceCount()); }
+
+    private:
+        EncodedSlice GetSlice(uint32 index, uint32 count) const {
+            EncodedSlice slice;
+            size_t begin = index ? sliceEnds[index - 1] : 0;
+            slice.data = data.data() + begin;
+            slice.size = sliceEnds[index] - begin;
+            slice.index = index;
+            slice.count = count;
+            slice.frameSequence = frameSequence;
+            slice.timestamp = timestamp;
+            slice.keyframe = keyframe;
+            return slice;
+        }
     };
 
     // Input event structure
@@ -126,6 +317,9 @@ namespace SplashTop {
     };
 
     // Statistics structures
+    // Rates (averageFPS, averageBitrate, ...) are rolling averages over
+    // the last couple of seconds, not since start. Times are steady clock
+    // milliseconds, 0 until the first frame or event.
     struct CaptureStats {
         uint64 framesCaptured;
         uint64 totalBytes;
@@ -139,6 +333,7 @@ namespace SplashTop {
         double averageBitrate;
         double averageFPS;
         uint64 lastFrameTime;
+        double averageQP = 0.0; // Recent frames; 0 if the encoder does not report it
     };
 
     struct StreamingStats {
@@ -154,6 +349,7 @@ namespace SplashTop {
         uint64 mouseEvents;
         uint64 keyboardEvents;
         uint64 lastEventTime;
+        double eventsPerSecond = 0.0;
     };
 
 } // namespace SplashTop
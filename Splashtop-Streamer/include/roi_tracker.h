@@ -0,0 +1,49 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Where RegionOfInterestTracker asks for better quality, and how much
+    struct RoiSettings {
+        uint32 pointerRadius = 128;    // Half the side of the square around the pointer
+        float pointerQpOffset = -0.5f;
+        uint32 pointerHoldMs = 3000;   // Keep the boost this long after the pointer stops
+        float damageQpOffset = -0.25f;
+        uint32 damageHoldMs = 500;     // Keep recently damaged rectangles this long
+        uint32 maxRegions = 16;        // Including the pointer region
+    };
+
+    // Builds each frame's regions of interest from the pointer position
+    // (reported by the input path) and the capture's recent damage, so a
+    // lossy encoder spends its bits where the user is looking.
+    class RegionOfInterestTracker {
+    public:
+        explicit RegionOfInterestTracker(const RoiSettings& settings = RoiSettings());
+
+        // Record a pointer position in frame coordinates. Safe to call from
+        // any thread.
+        void OnPointerMoved(int32 x, int32 y, std::chrono::steady_clock::time_point now);
+
+        // Replace frame.regionsOfInterest: the pointer region first, then the
+        // damaged rectangles still within their hold time. Full-screen
+        // repaints are ignored since they favour nothing. Returns the number
+        // of regions. Processing thread only.
+        uint32 Apply(VideoFrame& frame, std::chrono::steady_clock::time_point now);
+
+        void SetSettings(const RoiSettings& settings);
+        const RoiSettings& GetSettings() const { return m_settings; }
+
+    private:
+        struct DamagedRect {
+            Rect rect;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        RoiSettings m_settings;
+        std::atomic<uint64> m_pointer{0};     // x in the low, y in the high 32 bits
+        std::atomic<int64> m_pointerTime{0};  // steady_clock ticks of the last move (0 = never)
+        std::vector<DamagedRect> m_damage;    // Oldest first
+    };
+
+} // namespace SplashTop
@@ -17,12 +17,25 @@ namespace SplashTop {
         // Stop capturing
         virtual void StopCapture() = 0;
         
-        // Get the latest frame
+        // Get the latest frame (from a single consumer thread). Returns the
+        // same frame again if nothing new was captured; compare sequence.
         virtual std::shared_ptr<VideoFrame> GetLatestFrame() = 0;
         
         // Get monitor information
         virtual std::vector<std::pair<uint32, uint32>> GetMonitorResolutions() = 0;
         
+        // Choose the frames GetLatestFrame returns: format 0 (BGRA) or 2
+        // (YUV420, converted straight from the captured image), optionally
+        // halved in both dimensions in the same pass. Call before
+        // StartCapture; returns false if the backend cannot produce it.
+        virtual bool SetOutputFormat(uint32 format, bool halfSize = false) = 0;
+        
+        // Rate at which a backend with its own capture thread grabs the
+        // screen, on the FrameScheduler grid with phase 0. Returns false for
+        // backends that capture inside GetLatestFrame and ignore the rate;
+        // only the others have frame timestamps worth aligning to.
+        virtual bool SetFrameRate(uint32 fps) = 0;
+        
         // Set capture region (optional)
         virtual void SetCaptureRegion(uint32 x, uint32 y, uint32 width, uint32 height) = 0;
         
@@ -31,6 +44,9 @@ namespace SplashTop {
         
         // Check if hardware acceleration is available
         virtual bool IsHardwareAccelerated() const = 0;
+        
+        // Get the name of the active capture backend (valid after Initialize)
+        virtual std::string GetBackendName() const = 0;
     };
 
     // Factory function to create platform-specific screen capture
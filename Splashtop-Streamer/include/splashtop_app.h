@@ -3,11 +3,21 @@
 #include "platform.h"
 #include "screen_capture.h"
 #include "video_encoder.h"
+#include "content_classifier.h"
+#include "packet_pool.h"
+#include "stage_queue.h"
+#include "frame_scheduler.h"
+#include "frame_trace.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "static_screen_detector.h"
+#include "roi_tracker.h"
 #include "input_injector.h"
 #include "webrtc_streamer.h"
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <mutex>
 
 namespace SplashTop {
 
@@ -16,6 +26,24 @@ namespace SplashTop {
         SplashTopApp();
         ~SplashTopApp();
         
+        // Choose the video codec (see GetAvailableVideoCodecs); call before Initialize
+        void SetVideoCodec(const std::string& codec) { m_videoCodec = codec; }
+        
+        // Have the capture convert straight to YUV420 (optionally at half
+        // size) when the codec accepts it; call before Initialize. Otherwise
+        // the capture hands out BGRA and the encoder converts.
+        void SetYuvCapture(bool enabled, bool halfSize = false) {
+            m_yuvCapture = enabled || halfSize;
+            m_halfSizeCapture = halfSize;
+        }
+        
+        // Use these instead of the platform's capture, input injection and
+        // streamer, e.g. a SyntheticScreenCapture to benchmark without a
+        // display; call before Initialize
+        void SetScreenCapture(std::unique_ptr<IScreenCapture> capture) { m_screenCapture = std::move(capture); }
+        void SetInputInjector(std::unique_ptr<IInputInjector> injector) { m_inputInjector = std::move(injector); }
+        void SetWebRTCStreamer(std::unique_ptr<IWebRTCStreamer> streamer) { m_webrtcStreamer = std::move(streamer); }
+        
         // Initialize the application
         bool Initialize();
         
@@ -25,8 +53,29 @@ namespace SplashTop {
         // Stop the streaming service
         void StopStreaming();
         
-        // Set streaming parameters
+        // Set streaming parameters. Safe to call from any thread, before or
+        // while streaming; each pipeline stage applies them together before
+        // its next frame.
         void SetStreamingParameters(uint32 fps = 30, uint32 bitrate = 5000000, uint32 quality = 80);
+        void SetKeyframeInterval(uint32 frames); // 0 = encoder default
+        void SetSliceCount(uint32 slices); // 1 = send whole frames
+        void SetIntraRefresh(bool enabled); // Rolling intra refresh instead of periodic keyframes
+        
+        // Send a keyframe as soon as possible, even if the screen is
+        // unchanged. Safe to call from any thread.
+        void RequestKeyframe() { m_keyframeRequested = true; }
+        
+        // How an unchanged screen is handled; call before StartStreaming.
+        // Refinement is switched off for lossless codecs.
+        void SetIdleSettings(const StaticScreenSettings& settings) { m_idleSettings = settings; }
+        
+        // Work done by one pipeline stage, and time it spent waiting for
+        // its neighbours (empty input queue or full output queue)
+        struct StageStats {
+            uint64 items;
+            uint64 busyMicros;
+            uint64 waitMicros;
+        };
         
         // Get application statistics
         struct AppStats {
@@ -34,11 +83,29 @@ namespace SplashTop {
             EncoderStats encoder;
             StreamingStats streaming;
             InputStats input;
+            uint64 framesSkipped; // Unchanged frames not encoded
+            StageStats captureStage;
+            StageStats encodeStage;
+            StageStats sendStage;
+            StageQueueStats frameQueue;  // Capture to encode
+            StageQueueStats packetQueue; // Encode to send, one item per slice
+            FrameTimingStats pacing;     // Capture stage ticks
+            LatencyHistogram::Snapshot latency; // Capture to send of new frames
             bool isStreaming;
         };
         
         AppStats GetStats();
         
+        // Prometheus text exposition of the pipeline: stage latency
+        // histograms, frame, byte and input counters, rolling frame rates
+        // and bitrates, queue depths and the encoder's QP. Stage threads
+        // only ever do relaxed atomic adds for these, so scrapes never hold
+        // up streaming.
+        std::string GetMetrics();
+        
+        // Serve GetMetrics over HTTP at address:port/metrics
+        bool StartMetricsServer(const std::string& address, uint16 port);
+        
         // Check if application is running
         bool IsRunning() const { return m_isRunning; }
         
@@ -46,8 +113,54 @@ namespace SplashTop {
         void Shutdown();
 
     private:
-        // Main processing loop
-        void ProcessingLoop();
+        // Frame on its way from the capture stage to the encode stage
+        struct FrameJob {
+            std::shared_ptr<VideoFrame> frame;
+            bool keyframe = false; // Requested by the viewer, never dropped
+            std::chrono::steady_clock::time_point queuedAt;
+            uint64 capturedMicros = 0; // Capture time of a new frame, 0 for a repeat
+        };
+        
+        // Encoded slice on its way from the encode stage to the send stage,
+        // queued as soon as the encoder has it. The slices of a frame share
+        // its pooled packet, which goes back to the pool once the send stage
+        // lets go of the last one.
+        struct PacketJob {
+            std::shared_ptr<EncodedPacket> packet;
+            EncodedSlice slice; // Into packet->data, which stays put until the packet is reused
+            std::chrono::steady_clock::time_point queuedAt;
+            uint64 capturedMicros = 0;
+        };
+        
+        struct StreamingParameters {
+            uint32 fps;
+            uint32 bitrate;
+            uint32 quality;
+            uint32 keyframeInterval;
+            uint32 sliceCount;
+            bool intraRefresh;
+        };
+        
+        struct StageCounters {
+            std::atomic<uint64> items{0};
+            std::atomic<uint64> busyMicros{0};
+        };
+        
+        // Pipeline stages, each on its own thread. Capture paces the stream,
+        // drops unchanged frames and annotates the rest; encode turns frames
+        // into packets, passing each slice on as it is done; send hands the
+        // slices to the streamer while later ones are still being encoded.
+        // Throughput is set by the slowest stage: raw frames waiting for the
+        // encoder are dropped oldest first, encoded slices are never dropped.
+        void CaptureStage();
+        void EncodeStage();
+        void SendStage();
+        
+        StreamingParameters GetStreamingParameters();
+        
+        // Slices waiting for the send stage: room for a couple of frames
+        // at the largest slice count encoders use
+        static constexpr size_t kPacketQueueSlices = 32;
         
         // Handle input events from WebRTC
         void OnInputEvent(const InputEvent& event);
@@ -57,25 +170,58 @@ namespace SplashTop {
         
         // Components
         std::unique_ptr<IScreenCapture> m_screenCapture;
+        std::unique_ptr<ContentClassifier> m_contentClassifier; // Only for codecs that route by content
         std::unique_ptr<IVideoEncoder> m_videoEncoder;
+        PacketPool m_packetPool; // Encoder output, reused every frame (acquired by the encode stage only)
+        StaticScreenDetector m_staticScreen; // Capture stage only
+        FrameScheduler m_frameScheduler;     // Capture stage only, apart from GetStats
+        RegionOfInterestTracker m_roiTracker; // Pointer from the input path, regions from the capture stage
+        bool m_useRegionsOfInterest = false;  // Lossy codecs only
         std::unique_ptr<IInputInjector> m_inputInjector;
         std::unique_ptr<IWebRTCStreamer> m_webrtcStreamer;
         
         // Threading
-        std::thread m_processingThread;
+        std::thread m_captureThread;
+        std::thread m_encodeThread;
+        std::thread m_sendThread;
+        StageQueue<FrameJob> m_frameQueue;
+        StageQueue<PacketJob> m_packetQueue;
+        std::atomic<uint64> m_framesReleased; // Jobs encoded or dropped, see CaptureStage
+        StageCounters m_captureCounters;
+        StageCounters m_encodeCounters;
+        StageCounters m_sendCounters;
         std::atomic<bool> m_isRunning;
         std::atomic<bool> m_isStreaming;
         
         // Configuration
-        uint32 m_fps;
-        uint32 m_bitrate;
-        uint32 m_quality;
+        std::string m_videoCodec = "h264";
+        bool m_yuvCapture = false;
+        bool m_halfSizeCapture = false;
+        StaticScreenSettings m_idleSettings;
+        std::mutex m_parametersMutex;
+        StreamingParameters m_parameters;
+        std::atomic<uint64> m_parametersVersion; // Bumped for every change of m_parameters
+        std::atomic<bool> m_keyframeRequested; // Set until the capture stage queues a keyframe
         uint32 m_captureWidth;
         uint32 m_captureHeight;
         
         // Statistics
         std::chrono::steady_clock::time_point m_startTime;
-        uint64 m_totalFramesProcessed;
+        std::atomic<uint64> m_totalFramesProcessed;
+        std::atomic<uint64> m_framesCaptured{0};  // New frames seen by the capture stage
+        std::atomic<uint64> m_bytesSent{0};
+        std::atomic<uint64> m_mouseEvents{0};
+        std::atomic<uint64> m_keyboardEvents{0};
+        
+        // Stage latencies: capture to pickup, frame queue, encode, packet
+        // queue and send (per slice), and capture to the last slice sent
+        LatencyHistogram m_pickupLatency;
+        LatencyHistogram m_frameQueueLatency;
+        LatencyHistogram m_encodeLatency;
+        LatencyHistogram m_packetQueueLatency;
+        LatencyHistogram m_sendLatency;
+        LatencyHistogram m_totalLatency;
+        MetricsServer m_metricsServer;
     };
 
 } // namespace SplashTop
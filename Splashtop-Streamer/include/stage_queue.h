@@ -0,0 +1,224 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Snapshot of a StageQueue, readable from any thread
+    struct StageQueueStats {
+        uint32 capacity = 0;
+        uint32 depth = 0;              // Items queued right now
+        double averageDepth = 0.0;     // Items already queued when an item was pushed
+        uint64 pushed = 0;
+        uint64 dropped = 0;            // Evicted under DropOldest
+        uint64 producerWaitMicros = 0; // Producer waiting for room
+        uint64 consumerWaitMicros = 0; // Consumer waiting for an item
+    };
+
+    // Bounded queue between two pipeline stages: one producer thread, one
+    // consumer thread. Items pass through a ring of cells with a sequence
+    // number each, so neither side takes a lock unless the queue is empty
+    // or full and it has to sleep.
+    //
+    // When the queue is full, Block makes the producer wait for room.
+    // DropOldest evicts the oldest item instead, unless that item was
+    // pushed as not droppable (a keyframe), in which case the producer
+    // waits as with Block. Eviction makes the producer a second consumer
+    // of the oldest cell, which is why taking an item is a CAS.
+    template <typename T>
+    class StageQueue {
+    public:
+        enum class Policy {
+            Block,
+            DropOldest
+        };
+
+        // capacity is rounded up to a power of two
+        StageQueue(size_t capacity, Policy policy) : m_policy(policy) {
+            size_t size = 1;
+            while (size < capacity) size *= 2;
+            m_cells = std::make_unique<Cell[]>(size);
+            m_mask = size - 1;
+            Reset();
+        }
+
+        StageQueue(const StageQueue&) = delete;
+        StageQueue& operator=(const StageQueue&) = delete;
+
+        // Producer: append an item. Returns false (and drops the item) once
+        // the queue is closed.
+        bool Push(T item, bool droppable = true) {
+            return Push(std::move(item), droppable, [](T&, T&) {});
+        }
+
+        // As above; an item evicted to make room is passed to
+        // onEvict(evicted, item) before the new item is queued, so the
+        // caller can fold what it carried into the new one
+        template <typename OnEvict>
+        bool Push(T item, bool droppable, OnEvict onEvict) {
+            if (m_closed.load(std::memory_order_acquire)) return false;
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            m_depthSum.fetch_add(head - m_tail.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            Cell* cell = &m_cells[head & m_mask];
+            while (cell->sequence.load(std::memory_order_acquire) != head) {
+                if (m_closed.load(std::memory_order_acquire)) return false;
+
+                // Full: the cell still holds the item from one lap ago
+                T evicted;
+                if (m_policy == Policy::DropOldest && Take(evicted, true)) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    onEvict(evicted, item);
+                    continue;
+                }
+                Sleep(m_producerWaitMicros, [&] {
+                    return cell->sequence.load(std::memory_order_acquire) == head;
+                }, std::chrono::milliseconds(10));
+            }
+
+            cell->value = std::move(item);
+            cell->droppable = droppable;
+            cell->sequence.store(head + 1, std::memory_order_release);
+            m_head.store(head + 1, std::memory_order_relaxed);
+            m_pushed.fetch_add(1, std::memory_order_relaxed);
+            WakeSleepers();
+            return true;
+        }
+
+        // Consumer: take the oldest item, waiting up to timeout for one.
+        // Returns false on timeout, or when the queue is closed and empty.
+        bool Pop(T& item, std::chrono::microseconds timeout) {
+            if (TryPop(item)) return true;
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!m_closed.load(std::memory_order_acquire)) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) return false;
+                Sleep(m_consumerWaitMicros, [this] { return !IsEmpty(); }, deadline - now);
+                if (TryPop(item)) return true;
+            }
+            return TryPop(item);
+        }
+
+        // Consumer: take the oldest item if there is one
+        bool TryPop(T& item) {
+            if (!Take(item, false)) return false;
+            WakeSleepers();
+            return true;
+        }
+
+        // Make Push fail and wake both sides; Pop still drains what is queued
+        void Close() {
+            m_closed.store(true, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_all();
+        }
+
+        // Empty and reopen the queue. No thread may be using it.
+        void Reset() {
+            for (size_t i = 0; i <= m_mask; i++) {
+                m_cells[i].value = T();
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            m_head.store(0, std::memory_order_relaxed);
+            m_tail.store(0, std::memory_order_relaxed);
+            m_closed.store(false, std::memory_order_release);
+        }
+
+        size_t GetCapacity() const { return m_mask + 1; }
+
+        StageQueueStats GetStats() const {
+            StageQueueStats stats;
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            size_t head = m_head.load(std::memory_order_relaxed);
+            stats.capacity = static_cast<uint32>(GetCapacity());
+            stats.depth = static_cast<uint32>(std::min(head - std::min(head, tail), GetCapacity()));
+            stats.pushed = m_pushed.load(std::memory_order_relaxed);
+            stats.dropped = m_dropped.load(std::memory_order_relaxed);
+            stats.averageDepth = stats.pushed ? static_cast<double>(m_depthSum.load(std::memory_order_relaxed)) / stats.pushed : 0.0;
+            stats.producerWaitMicros = m_producerWaitMicros.load(std::memory_order_relaxed);
+            stats.consumerWaitMicros = m_consumerWaitMicros.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+        struct alignas(64) Cell {
+            std::atomic<size_t> sequence{0}; // position (free), position + 1 (full)
+            bool droppable = true;
+            T value{};
+        };
+
+        bool IsEmpty() const {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            return m_cells[tail & m_mask].sequence.load(std::memory_order_acquire) != tail + 1;
+        }
+
+        // Claim the oldest cell. The CAS settles a race between the consumer
+        // and an evicting producer; the loser sees the next cell.
+        bool Take(T& item, bool onlyDroppable) {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            while (true) {
+                Cell* cell = &m_cells[tail & m_mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                if (sequence != tail + 1) {
+                    if (sequence < tail + 1) return false; // Empty
+                    tail = m_tail.load(std::memory_order_relaxed); // Taken by the other side
+                    continue;
+                }
+                // Evicting: only from a full queue, and never a non-droppable
+                // item (only the producer writes droppable, and it is the caller)
+                if (onlyDroppable && (tail + m_mask + 1 != m_head.load(std::memory_order_relaxed) || !cell->droppable)) {
+                    return false;
+                }
+                if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell->value);
+                    cell->value = T();
+                    cell->sequence.store(tail + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+
+        // Sleep until ready() or the timeout, adding the time spent to waitMicros
+        template <typename Ready, typename Duration>
+        void Sleep(std::atomic<uint64>& waitMicros, Ready ready, Duration timeout) {
+            auto start = std::chrono::steady_clock::now();
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                m_wake.wait_for(lock, timeout, [&] { return ready() || m_closed.load(std::memory_order_acquire); });
+                m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+            }
+            waitMicros.fetch_add(static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count()), std::memory_order_relaxed);
+        }
+
+        // Called after every change; only locks if the other side is asleep
+        void WakeSleepers() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleepers.load(std::memory_order_relaxed) == 0) return;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wake.notify_all();
+        }
+
+        Policy m_policy;
+        std::unique_ptr<Cell[]> m_cells;
+        size_t m_mask = 0;
+        std::atomic<bool> m_closed{false};
+
+        // Producer- and consumer-side positions on their own cache lines
+        alignas(64) std::atomic<size_t> m_head{0};
+        alignas(64) std::atomic<size_t> m_tail{0};
+
+        alignas(64) std::atomic<uint64> m_pushed{0};
+        std::atomic<uint64> m_dropped{0};
+        std::atomic<uint64> m_depthSum{0};
+        std::atomic<uint64> m_producerWaitMicros{0};
+        std::atomic<uint64> m_consumerWaitMicros{0};
+
+        std::atomic<uint32> m_sleepers{0};
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+    };
+
+} // namespace SplashTop
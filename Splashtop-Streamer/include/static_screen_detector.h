@@ -0,0 +1,58 @@
+#pragma once
+
+#include "platform.h"
+#include "tile_change_detector.h"
+
+namespace SplashTop {
+
+    // How StaticScreenDetector treats an unchanged screen
+    struct StaticScreenSettings {
+        uint32 keepaliveMs = 1000;  // 0 = never send unchanged frames
+        uint32 refineDelayMs = 250; // Quiet time before refining
+        uint32 refineFrames = 2;    // 0 = no refinement (lossless codecs)
+    };
+
+    // Decides on every tick of the processing loop whether the captured
+    // frame is worth encoding. Unchanged frames are skipped, except for a
+    // low-rate keepalive and, once the screen has settled, a few refinement
+    // frames that let a lossy encoder sharpen the static image.
+    class StaticScreenDetector {
+    public:
+        enum class Action {
+            Skip,      // Nothing changed; do not encode or send
+            Encode,    // New content
+            Keepalive, // Nothing changed, but the stream needs a frame
+            Refine     // Nothing changed since the screen settled; re-encode to improve quality
+        };
+
+        explicit StaticScreenDetector(const StaticScreenSettings& settings = StaticScreenSettings());
+
+        // Classify the frame. Change is taken from, in order: a repeated
+        // sequence number, the capture's tile map, its damage rectangles, or
+        // a hash of the frame. For Keepalive and Refine the frame's change
+        // info is cleared so the encoder sends it as unchanged.
+        Action Update(VideoFrame& frame, std::chrono::steady_clock::time_point now);
+
+        // Start over: the next frame is encoded whatever it contains
+        void Reset();
+
+        void SetSettings(const StaticScreenSettings& settings) { m_settings = settings; }
+        const StaticScreenSettings& GetSettings() const { return m_settings; }
+
+        uint64 GetSkippedFrames() const { return m_skippedFrames; }
+
+    private:
+        bool HasChanged(const VideoFrame& frame);
+
+        StaticScreenSettings m_settings;
+        TileChangeDetector m_detector;
+        DirtyTileMap m_changed;
+        bool m_first = true;
+        uint64 m_lastSequence = 0;
+        uint32 m_refinesLeft = 0;
+        std::chrono::steady_clock::time_point m_lastChange;
+        std::chrono::steady_clock::time_point m_lastSent;
+        std::atomic<uint64> m_skippedFrames{0}; // Read by stats from other threads
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "platform.h"
+
+namespace SplashTop {
+
+    // Counters written on hot paths are padded to this, so two of them
+    // never share a cache line
+    constexpr size_t kCacheLineSize = 64;
+
+    // Steady clock in microseconds, the time base of everything below
+    uint64 StatsNowMicros();
+
+    // Monotonic event counter. Each thread adds to its own cache-line-sized
+    // shard with a relaxed atomic add, so counting never takes a lock and
+    // threads sharing a counter do not bounce its line between cores. Get
+    // sums the shards and may miss adds that happen meanwhile.
+    class StatCounter {
+    public:
+        static constexpr size_t kShardCount = 8;
+
+        void Add(uint64 amount = 1) {
+            m_shards[ThreadShard()].value.fetch_add(amount, std::memory_order_relaxed);
+        }
+        uint64 Get() const;
+        void Reset();
+
+    private:
+        struct alignas(kCacheLineSize) Shard {
+            std::atomic<uint64> value{0};
+        };
+
+        // Threads get shards round robin on their first add
+        static size_t ThreadShard();
+
+        Shard m_shards[kShardCount];
+    };
+
+    // Rolling rate of a monotonic total, e.g. frames per second from a
+    // StatCounter, as an exponentially weighted moving average over about
+    // window seconds. Readers call Update, so the counting thread only
+    // pays for its add; updates closer together than kMinIntervalMicros
+    // return the current rate rather than a noisy instant one.
+    class RateEstimator {
+    public:
+        static constexpr uint64 kMinIntervalMicros = 50000;
+
+        explicit RateEstimator(double windowSeconds = 2.0);
+
+        // Fold in the total as of nowMicros; returns the rate per second
+        double Update(uint64 total, uint64 nowMicros);
+        double Get() const;
+        void Reset();
+
+    private:
+        mutable std::mutex m_mutex; // Between readers only
+        double m_windowMicros;
+        uint64 m_lastTotal = 0;
+        uint64 m_lastMicros = 0;
+        bool m_hasSample = false;
+        bool m_hasRate = false;
+        double m_rate = 0.0;
+    };
+
+    // Items (frames, events) and their bytes through a component, with
+    // rolling rates for its GetStats. Record is wait-free; the rates are
+    // worked out when asked for.
+    class ThroughputMeter {
+    public:
+        struct Rates {
+            double itemsPerSecond = 0.0;
+            double bitsPerSecond = 0.0;
+        };
+
+        explicit ThroughputMeter(double windowSeconds = 2.0);
+
+        // items may be 0 for part of an item, e.g. a slice of a frame
+        void Record(uint64 bytes = 0, uint64 items = 1);
+
+        uint64 GetItems() const { return m_items.Get(); }
+        uint64 GetBytes() const { return m_bytes.Get(); }
+        uint64 GetLastMillis() const { return m_lastMicros.load(std::memory_order_relaxed) / 1000; } // 0 = nothing yet
+        Rates GetRates();
+
+        void Reset();
+
+    private:
+        StatCounter m_items;
+        StatCounter m_bytes;
+        alignas(kCacheLineSize) std::atomic<uint64> m_lastMicros{0};
+        RateEstimator m_itemRate;
+        RateEstimator m_byteRate;
+    };
+
+    // Latency distribution over fixed buckets. Observe is a couple of
+    // relaxed atomic adds, so the thread being measured never waits for a
+    // reader; a snapshot taken meanwhile may be off by the odd sample.
+    class alignas(kCacheLineSize) LatencyHistogram {
+    public:
+        static constexpr size_t kBucketCount = 13;
+        static const uint64 kBucketBoundsMicros[kBucketCount]; // Inclusive upper bounds
+
+        struct Snapshot {
+            uint64 counts[kBucketCount + 1] = {}; // Per bucket, the last one above every bound
+            uint64 count = 0;
+            uint64 sumMicros = 0;
+
+            // Upper bound of the bucket holding quantile q (0..1); samples
+            // above every bound report the largest one. 0 when empty.
+            uint64 GetPercentileMicros(double q) const;
+        };
+
+        void Observe(uint64 micros);
+        Snapshot GetSnapshot() const;
+
+    private:
+        std::atomic<uint64> m_counts[kBucketCount + 1] = {};
+        std::atomic<uint64> m_sumMicros{0};
+    };
+
+} // namespace SplashTop
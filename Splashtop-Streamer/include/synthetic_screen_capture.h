@@ -0,0 +1,120 @@
+#pragma once
+
+#include "platform.h"
+#include "screen_capture.h"
+#include "frame_pool.h"
+#include "stats.h"
+
+namespace SplashTop {
+
+    class YuvConverter;
+
+    // Reproducible desktop activity for benchmarks
+    enum class SyntheticWorkload {
+        Static,        // Desktop with a few windows, never changing
+        ScrollingText, // Document window scrolling smoothly, a few rows per frame
+        WindowDrag,    // Window dragged across the desktop
+        VideoNoise,    // Full-screen video where every pixel changes every frame
+        Mixed          // Scrolling text next to a video in one corner
+    };
+
+    const char* GetSyntheticWorkloadName(SyntheticWorkload workload);
+    bool ParseSyntheticWorkload(const std::string& name, SyntheticWorkload& workload);
+    std::vector<SyntheticWorkload> GetSyntheticWorkloads();
+
+    // Draws a workload into a BGRA image, one step per frame. The same
+    // workload, size and seed always give the same frames.
+    class SyntheticDesktop {
+    public:
+        SyntheticDesktop(SyntheticWorkload workload, uint32 width, uint32 height, uint32 seed = 1);
+
+        // Advance one frame and return the screen rectangles that changed
+        // (the whole screen on the first step, nothing for a static desktop)
+        const std::vector<Rect>& Step();
+
+        // The current image, BGRA
+        VideoFrame GetFrame();
+        const uint8* GetPixels() const { return m_pixels.data(); }
+        uint32 GetWidth() const { return m_width; }
+        uint32 GetHeight() const { return m_height; }
+        uint32 GetStride() const { return m_width * 4; }
+        SyntheticWorkload GetWorkload() const { return m_workload; }
+
+    private:
+        void DrawDesktop();
+        void ScrollText(const Rect& area);
+        void DrawVideo(const Rect& area);
+        void DragWindow();
+        void Restore(const Rect& rect); // From the background
+
+        SyntheticWorkload m_workload;
+        uint32 m_width, m_height;
+        uint32 m_seed;
+        uint64 m_step = 0;
+        std::vector<uint8> m_pixels;
+        std::vector<uint8> m_background; // Desktop without the moving parts
+        std::vector<Rect> m_changed;
+
+        Rect m_textArea = {};   // Scrolled region
+        uint64 m_scrolled = 0;  // Document rows scrolled out of view
+        Rect m_videoArea = {};
+        std::vector<uint8> m_noise; // Video texture: one row per screen row, with slack to shift
+        Rect m_dragWindow = {};
+        std::vector<uint8> m_dragImage;
+    };
+
+    // IScreenCapture over a SyntheticDesktop, for measuring the pipeline
+    // without a display. Like a real backend it hands out pooled frames
+    // with damage rectangles and dirty tiles, in BGRA or YUV420 (optionally
+    // at half size), and converts only what changed. The desktop advances
+    // one step per GetLatestFrame, so the workload runs at the caller's
+    // pace and SetFrameRate returns false.
+    class SyntheticScreenCapture : public IScreenCapture {
+    public:
+        SyntheticScreenCapture(SyntheticWorkload workload, uint32 width, uint32 height, uint32 seed = 1);
+        ~SyntheticScreenCapture() override;
+
+        bool Initialize() override;
+        bool StartCapture(uint32 monitorIndex = 0) override;
+        void StopCapture() override;
+        std::shared_ptr<VideoFrame> GetLatestFrame() override;
+        std::vector<std::pair<uint32, uint32>> GetMonitorResolutions() override;
+        bool SetOutputFormat(uint32 format, bool halfSize = false) override;
+        bool SetFrameRate(uint32 fps) override;
+        void SetCaptureRegion(uint32 x, uint32 y, uint32 width, uint32 height) override;
+        CaptureStats GetStats() override;
+        bool IsHardwareAccelerated() const override { return false; }
+        std::string GetBackendName() const override;
+
+        // Time spent drawing the workload, included in capture time but
+        // not something a real backend pays for
+        uint64 GetRenderMicros() const { return m_renderMicros.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr size_t kMaxPendingRects = 256;
+        static constexpr uint32 kTileSize = 64;
+
+        void ConfigureOutput();
+        Rect AlignToChromaBlocks(const Rect& rect) const;
+        Rect ToFrameRect(const Rect& rect) const;
+        void ConvertRect(const Rect& rect);
+
+        SyntheticDesktop m_desktop;
+        uint32 m_format = 0;
+        uint32 m_scale = 1;
+        uint32 m_frameWidth = 0, m_frameHeight = 0, m_frameStride = 0;
+        std::vector<uint8> m_frameBuffer; // YUV420 output, kept up to date rectangle by rectangle
+        std::unique_ptr<YuvConverter> m_yuvConverter;
+        std::atomic<bool> m_capturing{false};
+
+        // Published frames are never written again while a consumer holds them
+        FramePool m_framePool{8};
+        std::shared_ptr<PooledFrame> m_latest;
+        std::vector<Rect> m_pendingRects; // Changed since m_latest, in frame coordinates
+        uint64 m_sequence = 0;
+
+        ThroughputMeter m_captured;
+        std::atomic<uint64> m_renderMicros{0};
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "platform.h"
+#include "pixel_convert.h"
+
+namespace SplashTop {
+
+    // Finds changed tiles of a BGRA or YUV420 frame by hashing each tile and
+    // comparing against the hashes of the previous frame
+    class TileChangeDetector {
+    public:
+        explicit TileChangeDetector(uint32 tileSize = 64);
+
+        // Hash the frame and mark tiles that differ from the previous call in
+        // dirtyTiles. If the frame carries damage info, only damaged tiles are
+        // hashed. The first frame (or a size change) marks every tile dirty,
+        // as does every YUV420 frame whose stride is not a multiple of 8.
+        // Returns the number of dirty tiles.
+        uint32 Detect(const VideoFrame& frame, DirtyTileMap& dirtyTiles);
+
+        // Forget the previous frame so the next Detect marks everything dirty
+        void Reset();
+
+        // Force a hash kernel (benchmarks/tests); falls back to scalar if unavailable
+        void SetKernel(PixelKernel kernel);
+        PixelKernel GetKernel() const { return m_kernel; }
+
+        uint32 GetTileSize() const { return m_tileSize; }
+
+    private:
+        uint32 m_tileSize;
+        uint32 m_width;
+        uint32 m_height;
+        PixelKernel m_kernel;
+        std::vector<uint64> m_hashes;
+        DirtyTileMap m_candidates;
+    };
+
+    // Hash a width x height block of 32-bit pixels. Every kernel returns the same value.
+    uint64 HashTile(PixelKernel kernel, const uint8* data, uint32 stride, uint32 width, uint32 height);
+
+} // namespace SplashTop
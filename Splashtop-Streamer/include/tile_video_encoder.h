@@ -0,0 +1,164 @@
+#pragma once
+
+#include "platform.h"
+#include "pixel_convert.h"
+#include "tile_change_detector.h"
+#include "video_encoder.h"
+#include "stats.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#elif defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace SplashTop {
+
+    // Lossless tile codec for desktop content, in the spirit of VNC Tight/ZRLE.
+    //
+    // Every message (a frame, or one slice of it) is a 28-byte header followed
+    // by the tile records, optionally compressed as a whole:
+    //   u32 magic 'STT1', u8 flags (1 = keyframe), u8 TileCompression,
+    //   u16 tile size, u32 width, u32 height, u32 tile count,
+    //   u32 uncompressed size, u32 payload size
+    // Each tile record is u16 tile x, u16 tile y, u8 TileEncoding and the tile
+    // data. Colors are stored as 3 bytes (B, G, R); alpha is not transmitted.
+    // Run lengths are stored ZRLE-style as (length - 1) in bytes of 255 plus
+    // a final byte below 255. All values are little-endian.
+    enum class TileEncoding : uint8 {
+        Solid = 0,         // One color
+        PackedPalette = 1, // 2-16 colors, 1/2/4-bit indices, rows padded to a byte
+        PaletteRLE = 2,    // Up to 127 colors; index, or index | 0x80 followed by a run length
+        PlainRLE = 3,      // Color followed by a run length
+        Raw = 4            // Color per pixel
+    };
+
+    enum class TileCompression : uint8 {
+        Stored = 0,
+        Zlib = 1,
+        Zstd = 2
+    };
+
+    // Distinct colors (alpha ignored) and color runs of a tile
+    struct TilePalette {
+        static constexpr uint32 kMaxColors = 127;
+
+        alignas(32) uint32 colors[kMaxColors + 1]; // Unused entries hold kUnusedColor
+        uint32 count = 0; // kMaxColors + 1 if the tile has more colors
+        uint32 runs = 0;  // Runs of equal pixels in row-major order
+
+        static constexpr uint32 kUnusedColor = 0xFFFFFFFF;
+
+        bool HasPalette() const { return count <= kMaxColors; }
+
+        void Reset() {
+            std::fill(colors, colors + kMaxColors + 1, kUnusedColor);
+            count = 0;
+            runs = 0;
+        }
+    };
+
+    // Count the colors and runs of a width x height block of BGRA pixels.
+    // Every kernel gives the same result.
+    void AnalyzeTile(PixelKernel kernel, const uint8* data, uint32 stride, uint32 width, uint32 height,
+                     TilePalette& palette);
+
+    // Append the smallest encoding of one tile (encoding byte and data) to out.
+    // Returns the encoding that was chosen.
+    TileEncoding EncodeTile(const uint8* data, uint32 stride, uint32 width, uint32 height,
+                            const TilePalette& palette, std::vector<uint8>& out);
+
+    // Lossless encoder that only sends changed tiles
+    class TileVideoEncoder : public IVideoEncoder {
+    public:
+        explicit TileVideoEncoder(uint32 tileSize = 64);
+        ~TileVideoEncoder();
+
+        bool Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) override;
+        bool EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) override;
+        bool EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) override;
+        EncoderStats GetStats() override;
+
+        bool IsHardwareAccelerated() const override { return false; }
+        void SetBitrate(uint32 bitrate) override { m_bitrate = bitrate; }
+        void SetFPS(uint32 fps) override { m_fps = fps; }
+        void SetQuality(uint32 quality) override;
+        void SetKeyframeInterval(uint32 frames) override { m_keyframeInterval = frames; }
+        void SetSliceCount(uint32 slices) override { m_sliceCount = std::max<uint32>(1, slices); }
+        void RequestKeyframe() override { m_keyframeRequested = true; }
+
+        // Every tile is intra coded, so refreshing resends a band of tile
+        // columns each frame, covering the screen once per keyframe interval
+        // (two seconds if none is set)
+        void SetIntraRefresh(bool enabled) override { m_intraRefresh = enabled; }
+        std::vector<std::string> GetSupportedCodecs() const override;
+
+        // Force an analysis kernel (benchmarks/tests); falls back to scalar if unavailable
+        void SetKernel(PixelKernel kernel);
+
+        // Find the tiles that changed since the last frame, from the frame's
+        // own map or by hashing, plus this frame's intra refresh columns.
+        // Returns true if the frame must be a keyframe, in which case every
+        // tile is marked.
+        bool FindChangedTiles(const VideoFrame& frame);
+        const DirtyTileMap& GetChangedTiles() const { return m_dirtyTiles; }
+
+        // Append the tiles of rows [tileY0, tileY1) that are set in tiles to
+        // out as one message. Used by encoders that send part of a frame this way.
+        void EncodeTiles(const VideoFrame& frame, const DirtyTileMap& tiles, uint32 tileY0, uint32 tileY1,
+                         bool keyframe, std::vector<uint8>& out);
+
+    private:
+
+        // Append m_tileData to out, compressed if that makes it smaller
+        TileCompression Compress(std::vector<uint8>& out);
+
+        uint32 m_tileSize;
+        uint32 m_width = 0, m_height = 0, m_fps = 30, m_bitrate = 0, m_quality = 80;
+        uint32 m_keyframeInterval = 0; // 0 = only when needed
+        uint32 m_sliceCount = 1;
+        uint32 m_framesSinceKeyframe = 0;
+        bool m_initialized = false;
+        bool m_needsKeyframe = true;
+        std::atomic<bool> m_keyframeRequested{false};
+        bool m_intraRefresh = false;
+        uint32 m_refreshColumn = 0; // First tile column of the next refresh band
+        PixelKernel m_kernel;
+
+        TileChangeDetector m_detector;
+        DirtyTileMap m_dirtyTiles;
+        TilePalette m_palette;
+        std::vector<uint8> m_tileData;
+        int m_compressionLevel = 1; // zstd level
+#ifdef HAVE_ZSTD
+        ZSTD_CCtx* m_zstd = nullptr;
+#elif defined(HAVE_ZLIB)
+        z_stream m_zlib = {};
+        bool m_zlibReady = false;
+#endif
+
+        ThroughputMeter m_encoded; // Read by GetStats from other threads
+    };
+
+    // Rebuilds the BGRA image from TileVideoEncoder messages
+    class TileFrameDecoder {
+    public:
+        // Apply one message. Returns false if it is malformed or does not
+        // fit the current image (a keyframe is needed first).
+        bool Decode(const uint8* data, size_t size);
+
+        const std::vector<uint8>& GetImage() const { return m_image; }
+        uint32 GetWidth() const { return m_width; }
+        uint32 GetHeight() const { return m_height; }
+        uint32 GetStride() const { return m_width * 4; }
+
+    private:
+        bool DecodeTiles(const uint8* data, size_t size, uint32 tileSize, uint32 tileCount);
+
+        std::vector<uint8> m_image;
+        std::vector<uint8> m_payload;
+        uint32 m_width = 0;
+        uint32 m_height = 0;
+    };
+
+} // namespace SplashTop
@@ -6,6 +6,8 @@ namespace SplashTop {
 
     class IVideoEncoder {
     public:
+        using SliceCallback = std::function<void(const EncodedSlice& slice)>;
+
         virtual ~IVideoEncoder() = default;
         
         // Initialize the encoder
@@ -14,6 +16,16 @@ namespace SplashTop {
         // Encode a frame
         virtual bool EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) = 0;
         
+        // Encode a frame into packet, replacing its contents, as
+        // SetSliceCount() slices. If onSlice is set it is called from this
+        // thread for each slice in order, as soon as it is in the packet.
+        // A slice's bytes stay where they are until the packet is next
+        // encoded into, so another thread may send a slice while later ones
+        // are still being encoded. Nothing is allocated once the packet has
+        // grown to the frame size.
+        virtual bool EncodePacket(const VideoFrame& frame, EncodedPacket& packet,
+                                  const SliceCallback& onSlice = nullptr) = 0;
+        
         // Get encoder statistics
         virtual EncoderStats GetStats() = 0;
         
@@ -24,12 +36,27 @@ namespace SplashTop {
         virtual void SetBitrate(uint32 bitrate) = 0;
         virtual void SetFPS(uint32 fps) = 0;
         virtual void SetQuality(uint32 quality) = 0; // 0-100
+        virtual void SetKeyframeInterval(uint32 frames) = 0; // 0 = encoder default
+        virtual void SetSliceCount(uint32 slices) = 0; // 1 = whole frame
+        
+        // Make the next encoded frame a keyframe, e.g. because the viewer
+        // lost a frame. Safe to call from any thread.
+        virtual void RequestKeyframe() = 0;
         
-        // Get supported codecs
+        // Refresh the picture a column at a time over each keyframe interval
+        // instead of with periodic keyframes, so the bitrate stays flat and
+        // a lost frame heals within one interval. Encoders that cannot
+        // keep sending keyframes.
+        virtual void SetIntraRefresh(bool enabled) = 0;
+        
+        // Get the codecs CreateVideoEncoder can provide on this machine
         virtual std::vector<std::string> GetSupportedCodecs() const = 0;
     };
 
     // Factory function to create encoder
     std::unique_ptr<IVideoEncoder> CreateVideoEncoder(const std::string& codec = "h264");
 
+    // Codecs CreateVideoEncoder can provide on this machine
+    std::vector<std::string> GetAvailableVideoCodecs();
+
 } // namespace SplashTop
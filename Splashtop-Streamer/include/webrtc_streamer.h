@@ -21,12 +21,20 @@ namespace SplashTop {
         // Send video frame
         virtual bool SendVideoFrame(const VideoFrame& frame) = 0;
         
+        // Send one slice of an encoded frame; the frame counts as sent
+        // once its last slice went out
+        virtual bool SendVideoSlice(const EncodedSlice& slice) = 0;
+        
         // Set callbacks for input events
         virtual void SetInputCallback(std::function<void(const InputEvent&)> callback) = 0;
         
         // Set connection state callback
         virtual void SetConnectionStateCallback(std::function<void(bool connected)> callback) = 0;
         
+        // Set the callback run when the viewer asks for a keyframe (picture
+        // loss or a new decoder), from the streamer's thread
+        virtual void SetKeyframeRequestCallback(std::function<void()> callback) = 0;
+        
         // Get streaming statistics
         virtual StreamingStats GetStats() = 0;
         
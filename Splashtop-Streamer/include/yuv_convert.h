@@ -0,0 +1,123 @@
+#pragma once
+
+#include "platform.h"
+#include "pixel_convert.h"
+
+namespace SplashTop {
+
+    // Matrix used to derive Y'CbCr from R'G'B'
+    enum class YuvMatrix {
+        BT601,
+        BT709
+    };
+
+    // Limited range puts Y in 16-235 and chroma in 16-240, full range uses 0-255
+    enum class YuvRange {
+        Limited,
+        Full
+    };
+
+    // 4:2:0 plane layouts: I420 has separate U and V planes, NV12 one
+    // interleaved UV plane
+    enum class YuvLayout {
+        I420,
+        NV12
+    };
+
+    struct YuvFormat {
+        YuvMatrix matrix = YuvMatrix::BT709;
+        YuvRange range = YuvRange::Limited;
+    };
+
+    // Destination image, owned by the caller. The chroma planes are
+    // (width + 1) / 2 samples wide (pairs of bytes for NV12) and
+    // (height + 1) / 2 rows high.
+    struct YuvImage {
+        YuvLayout layout = YuvLayout::I420;
+        uint8* y = nullptr;
+        uint8* u = nullptr; // UV plane for NV12
+        uint8* v = nullptr; // Unused for NV12
+        uint32 yStride = 0;
+        uint32 uStride = 0;
+        uint32 vStride = 0;
+    };
+
+    // Convert a width x height BGRA image to 4:2:0 on the calling thread,
+    // using the fastest kernel the CPU supports. Each chroma sample comes
+    // from the average of its 2x2 block (edges are replicated).
+    void ConvertBGRAToYuv(const uint8* src, uint32 srcStride, uint32 width, uint32 height,
+                          const YuvImage& dst, const YuvFormat& format = YuvFormat());
+
+    // Same as ConvertBGRAToYuv but forces a specific kernel. Every kernel
+    // gives the same result. Returns false if the CPU cannot run the kernel.
+    bool ConvertBGRAToYuvWithKernel(PixelKernel kernel, const uint8* src, uint32 srcStride,
+                                    uint32 width, uint32 height, const YuvImage& dst,
+                                    const YuvFormat& format = YuvFormat());
+
+    // Convert and halve the size in one pass: each output pixel is the
+    // rounded average of a 2x2 source block, so dst is (width + 1) / 2 x
+    // (height + 1) / 2. The source is only read once and no full-size
+    // intermediate image is written.
+    void ConvertBGRAToYuvHalfSize(const uint8* src, uint32 srcStride, uint32 width, uint32 height,
+                                  const YuvImage& dst, const YuvFormat& format = YuvFormat());
+
+    // Planes of a YUV420 VideoFrame (see VideoFrame::GetUPlane)
+    YuvImage GetYuv420Planes(const VideoFrame& frame);
+
+    // Converts large frames in bands of rows on worker threads, with the
+    // calling thread taking the first band. Frames too small to gain from
+    // threads are converted on the calling thread only.
+    class YuvConverter {
+    public:
+        explicit YuvConverter(uint32 threads = 0); // 0 = one per core, at most 8
+        ~YuvConverter();
+
+        YuvConverter(const YuvConverter&) = delete;
+        YuvConverter& operator=(const YuvConverter&) = delete;
+
+        void SetFormat(const YuvFormat& format) { m_format = format; }
+        const YuvFormat& GetFormat() const { return m_format; }
+
+        // Force a kernel (benchmarks/tests); falls back to scalar if unavailable
+        void SetKernel(PixelKernel kernel);
+        PixelKernel GetKernel() const { return m_kernel; }
+
+        // Halve the image while converting (see ConvertBGRAToYuvHalfSize)
+        void SetHalfSize(bool enabled) { m_halfSize = enabled; }
+        bool GetHalfSize() const { return m_halfSize; }
+
+        uint32 GetThreadCount() const { return static_cast<uint32>(m_workers.size()) + 1; }
+
+        // Not thread-safe: one conversion at a time. width and height are
+        // those of the source.
+        void Convert(const uint8* src, uint32 srcStride, uint32 width, uint32 height, const YuvImage& dst);
+
+    private:
+        struct Job {
+            const uint8* src;
+            uint32 srcStride;
+            uint32 width;
+            uint32 height;
+            YuvImage dst;
+            uint32 bandRows; // Output rows, even so bands never split a chroma row
+        };
+
+        void WorkerLoop(uint32 band);
+        void ConvertBand(const Job& job, uint32 band);
+
+        YuvFormat m_format;
+        PixelKernel m_kernel;
+        bool m_halfSize = false;
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        Job m_job = {};
+        uint32 m_bands = 0;        // Bands in the current job
+        uint32 m_pending = 0;      // Worker bands still running
+        uint64 m_generation = 0;   // Bumped for every job
+        bool m_stop = false;
+    };
+
+} // namespace SplashTop
@@ -0,0 +1,71 @@
+#include "codec_registry.h"
+
+namespace SplashTop {
+
+    VideoCodecRegistry& VideoCodecRegistry::Instance() {
+        static VideoCodecRegistry registry;
+        return registry;
+    }
+
+    bool VideoCodecRegistry::Register(const VideoCodecInfo& info, Factory factory, Probe probe) {
+        if (Find(info.name)) {
+            std::cerr << "Video codec '" << info.name << "' registered twice" << std::endl;
+            return false;
+        }
+        m_entries.push_back({info, std::move(factory), std::move(probe)});
+        return true;
+    }
+
+    std::unique_ptr<IVideoEncoder> VideoCodecRegistry::Create(const std::string& name) const {
+        for (const auto& entry : m_entries) {
+            if (entry.info.name == name) {
+                if (entry.probe && !entry.probe()) return nullptr;
+                return entry.factory();
+            }
+        }
+        return nullptr;
+    }
+
+    const VideoCodecInfo* VideoCodecRegistry::Find(const std::string& name) const {
+        for (const auto& entry : m_entries) {
+            if (entry.info.name == name) return &entry.info;
+        }
+        return nullptr;
+    }
+
+    bool VideoCodecRegistry::IsAvailable(const std::string& name) const {
+        for (const auto& entry : m_entries) {
+            if (entry.info.name == name) return !entry.probe || entry.probe();
+        }
+        return false;
+    }
+
+    std::vector<VideoCodecInfo> VideoCodecRegistry::GetAvailable() const {
+        std::vector<VideoCodecInfo> codecs;
+        for (const auto& entry : m_entries) {
+            if (!entry.probe || entry.probe()) codecs.push_back(entry.info);
+        }
+        std::stable_sort(codecs.begin(), codecs.end(), [](const VideoCodecInfo& a, const VideoCodecInfo& b) {
+            return a.preference < b.preference;
+        });
+        return codecs;
+    }
+
+    std::unique_ptr<IVideoEncoder> CreateVideoEncoder(const std::string& codec) {
+        if (auto encoder = VideoCodecRegistry::Instance().Create(codec)) {
+            return encoder;
+        }
+
+        std::cerr << "Video encoder: '" << codec << "' not available, sending raw frames" << std::endl;
+        return VideoCodecRegistry::Instance().Create("raw");
+    }
+
+    std::vector<std::string> GetAvailableVideoCodecs() {
+        std::vector<std::string> names;
+        for (const auto& info : VideoCodecRegistry::Instance().GetAvailable()) {
+            names.push_back(info.name);
+        }
+        return names;
+    }
+
+} // namespace SplashTop
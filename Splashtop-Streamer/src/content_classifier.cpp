@@ -0,0 +1,142 @@
+#include "content_classifier.h"
+#include <cstring>
+
+namespace SplashTop {
+
+    namespace {
+
+        // Thresholds, tuned on desktop captures: text and UI either fit a
+        // palette or consist mostly of hard edges, video and photos have
+        // many colors and soft gradients
+        constexpr float kNaturalRunFraction = 0.3f;
+        constexpr float kNaturalMaxSharpEdges = 0.4f;
+        constexpr uint32 kSharpLumaStep = 64;
+
+        // Change rate is an exponential moving average over frames
+        constexpr float kChangeWeight = 0.125f;
+        constexpr float kEnterChangeRate = 0.25f; // Must keep changing to be treated as video
+        constexpr float kLeaveChangeRate = 0.1f;  // Settled content goes back to the tile codec
+        constexpr int8 kVoteLimit = 2;
+
+        inline uint32 Luma(uint32 pixel) {
+            uint32 b = pixel & 0xFF;
+            uint32 g = (pixel >> 8) & 0xFF;
+            uint32 r = (pixel >> 16) & 0xFF;
+            return (r * 2 + g * 5 + b) >> 3;
+        }
+
+    } // namespace
+
+    TileFeatures MeasureTile(PixelKernel kernel, const uint8* data, uint32 stride, uint32 width, uint32 height,
+                             TilePalette& palette) {
+        AnalyzeTile(kernel, data, stride, width, height, palette);
+
+        TileFeatures features;
+        features.colors = palette.count;
+        features.runFraction = static_cast<float>(palette.runs) / (static_cast<float>(width) * height);
+        features.sharpEdges = 1.0f;
+
+        // Content that fits a palette is synthetic whatever its edges look
+        // like, so only measure edges when it matters (every other row)
+        if (palette.HasPalette() || width < 2) return features;
+
+        uint32 transitions = 0;
+        uint32 sharp = 0;
+        for (uint32 y = 0; y < height; y += 2) {
+            const uint8* row = data + static_cast<size_t>(y) * stride;
+            uint32 left;
+            std::memcpy(&left, row, 4);
+            uint32 leftLuma = Luma(left);
+            for (uint32 x = 1; x < width; x++) {
+                uint32 pixel;
+                std::memcpy(&pixel, row + x * 4, 4);
+                if (((pixel ^ left) & 0x00FFFFFF) == 0) continue;
+
+                uint32 luma = Luma(pixel);
+                transitions++;
+                if (luma > leftLuma + kSharpLumaStep || leftLuma > luma + kSharpLumaStep) sharp++;
+                left = pixel;
+                leftLuma = luma;
+            }
+        }
+
+        features.sharpEdges = transitions ? static_cast<float>(sharp) / transitions : 1.0f;
+        return features;
+    }
+
+    ContentClassifier::ContentClassifier(uint32 tileSize)
+        : m_tileSize(tileSize), m_kernel(GetBestPixelKernel()), m_detector(tileSize) {
+    }
+
+    void ContentClassifier::Reset() {
+        m_width = 0;
+        m_height = 0;
+        m_tiles.clear();
+        m_detector.Reset();
+    }
+
+    void ContentClassifier::SetKernel(PixelKernel kernel) {
+        m_kernel = IsPixelKernelAvailable(kernel) ? kernel : PixelKernel::Scalar;
+        m_detector.SetKernel(m_kernel);
+    }
+
+    uint32 ContentClassifier::Classify(VideoFrame& frame) {
+        const uint32 tilesX = (frame.width + m_tileSize - 1) / m_tileSize;
+        const uint32 tilesY = (frame.height + m_tileSize - 1) / m_tileSize;
+
+        if (frame.width != m_width || frame.height != m_height) {
+            m_width = frame.width;
+            m_height = frame.height;
+            m_tiles.assign(static_cast<size_t>(tilesX) * tilesY, TileState());
+            m_detector.Reset();
+        }
+
+        frame.naturalTiles.Resize(frame.width, frame.height, m_tileSize);
+        if (frame.format == 2 || !frame.data) return 0;
+
+        // Use the capture's change map when it has our geometry
+        const DirtyTileMap* changed = &frame.dirtyTiles;
+        if (!changed->IsValid() || changed->tileSize != m_tileSize ||
+            changed->tilesX != tilesX || changed->tilesY != tilesY) {
+            m_detector.Detect(frame, m_changed);
+            changed = &m_changed;
+        }
+
+        uint32 naturalCount = 0;
+        for (uint32 ty = 0; ty < tilesY; ty++) {
+            for (uint32 tx = 0; tx < tilesX; tx++) {
+                TileState& state = m_tiles[static_cast<size_t>(ty) * tilesX + tx];
+                bool isChanged = changed->IsDirty(tx, ty);
+
+                state.changeRate = state.changeRate * (1.0f - kChangeWeight) + (isChanged ? kChangeWeight : 0.0f);
+
+                if (isChanged) {
+                    uint32 x = tx * m_tileSize;
+                    uint32 y = ty * m_tileSize;
+                    TileFeatures features = MeasureTile(m_kernel, frame.data + static_cast<size_t>(y) * frame.stride + x * 4,
+                                                        frame.stride, std::min(m_tileSize, frame.width - x),
+                                                        std::min(m_tileSize, frame.height - y), m_palette);
+                    bool looksNatural = features.colors > TilePalette::kMaxColors &&
+                                        features.runFraction > kNaturalRunFraction &&
+                                        features.sharpEdges < kNaturalMaxSharpEdges;
+                    state.votes = static_cast<int8>(std::max<int>(-kVoteLimit, std::min<int>(kVoteLimit,
+                                                     state.votes + (looksNatural ? 1 : -1))));
+                }
+
+                if (state.natural) {
+                    state.natural = state.votes > -kVoteLimit && state.changeRate >= kLeaveChangeRate;
+                } else {
+                    state.natural = state.votes >= kVoteLimit && state.changeRate >= kEnterChangeRate;
+                }
+
+                if (state.natural) {
+                    frame.naturalTiles.SetDirty(tx, ty);
+                    naturalCount++;
+                }
+            }
+        }
+
+        return naturalCount;
+    }
+
+} // namespace SplashTop
@@ -1,14 +1,26 @@
 #include "platform.h"
 #include "video_encoder.h"
+#include "codec_registry.h"
+#include "yuv_convert.h"
+#include "frame_trace.h"
+#include "stats.h"
 #include <cstring>
 
+#ifdef HAVE_FFMPEG
+extern "C" {
+    #include <libavutil/frame.h>
+    #include <libavutil/opt.h>
+}
+#endif
+
 namespace SplashTop {
 
-    class FFmpegVideoEncoder : public IVideoEncoder {
+    // Uncompressed passthrough, used when no real encoder is available
+    class RawVideoEncoder : public IVideoEncoder {
     public:
-        FFmpegVideoEncoder(const std::string& codec) : m_codec(codec), m_initialized(false) {}
-        ~FFmpegVideoEncoder() = default;
-        
+        RawVideoEncoder() : m_initialized(false) {}
+        ~RawVideoEncoder() = default;
+
         bool Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) override {
             m_width = width;
             m_height = height;
@@ -17,43 +29,570 @@ namespace SplashTop {
             m_initialized = true;
             return true;
         }
-        
+
         bool EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) override {
-            if (!m_initialized) return false;
-            
-            // Simple placeholder - just copy frame data
-            size_t frameSize = frame.width * frame.height * 4; // BGRA
-            encodedData.resize(frameSize);
-            memcpy(encodedData.data(), frame.data, frameSize);
-            
-            m_framesEncoded++;
-            m_totalBytes += frameSize;
+            if (!m_initialized || frame.format == 2) return false;
+
+            encodedData.resize(static_cast<size_t>(frame.width) * frame.height * 4);
+            CopyRows(frame, 0, frame.height, encodedData.data());
+            m_encoded.Record(encodedData.size());
+            return true;
+        }
+
+        bool EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) override {
+            if (!m_initialized || frame.format == 2) return false;
+
+            packet.Reset(frame);
+            packet.keyframe = true;
+            packet.data.resize(static_cast<size_t>(frame.width) * frame.height * 4);
+
+            // Each slice is a band of rows, sent before the next band is copied
+            uint32 count = std::max<uint32>(1, std::min(m_sliceCount, frame.height));
+            for (uint32 i = 0; i < count; i++) {
+                uint32 y0 = static_cast<uint32>(static_cast<uint64>(frame.height) * i / count);
+                uint32 y1 = static_cast<uint32>(static_cast<uint64>(frame.height) * (i + 1) / count);
+                CopyRows(frame, y0, y1, packet.data.data() + static_cast<size_t>(frame.width) * 4 * y0);
+
+                EncodedSlice slice = packet.AddSlice(static_cast<size_t>(frame.width) * 4 * y1, count);
+                if (onSlice) onSlice(slice);
+            }
+
+            m_encoded.Record(packet.data.size());
             return true;
         }
-        
+
         EncoderStats GetStats() override {
-            return {m_framesEncoded, m_totalBytes, 0.0, 0.0, 0};
+            ThroughputMeter::Rates rates = m_encoded.GetRates();
+            EncoderStats stats = {m_encoded.GetItems(), m_encoded.GetBytes(), rates.bitsPerSecond,
+                                  rates.itemsPerSecond, m_encoded.GetLastMillis()};
+            return stats;
         }
-        
+
         bool IsHardwareAccelerated() const override { return false; }
         void SetBitrate(uint32 bitrate) override { m_bitrate = bitrate; }
         void SetFPS(uint32 fps) override { m_fps = fps; }
         void SetQuality(uint32 quality) override { m_quality = quality; }
-        
+        void SetKeyframeInterval(uint32 frames) override { (void)frames; } // Every frame is a keyframe
+        void SetSliceCount(uint32 slices) override { m_sliceCount = std::max<uint32>(1, slices); }
+        void RequestKeyframe() override {}
+        void SetIntraRefresh(bool enabled) override { (void)enabled; }
+
         std::vector<std::string> GetSupportedCodecs() const override {
-            return {"h264", "h265", "vp9"};
+            return GetAvailableVideoCodecs();
         }
-        
+
     private:
-        std::string m_codec;
-        uint32 m_width, m_height, m_fps, m_bitrate, m_quality;
+        // Copy rows so padded strides produce a tightly packed BGRA image
+        static void CopyRows(const VideoFrame& frame, uint32 y0, uint32 y1, uint8* out) {
+            size_t rowSize = static_cast<size_t>(frame.width) * 4;
+            for (uint32 y = y0; y < y1; y++) {
+                memcpy(out + (y - y0) * rowSize, frame.data + static_cast<size_t>(y) * frame.stride, rowSize);
+            }
+        }
+
+        uint32 m_width = 0, m_height = 0, m_fps = 0, m_bitrate = 0, m_quality = 80;
+        uint32 m_sliceCount = 1;
         bool m_initialized;
-        uint64 m_framesEncoded = 0;
-        uint64 m_totalBytes = 0;
+        ThroughputMeter m_encoded; // Read by GetStats from other threads
     };
 
-    std::unique_ptr<IVideoEncoder> CreateVideoEncoder(const std::string& codec) {
-        return std::make_unique<FFmpegVideoEncoder>(codec);
+#ifdef HAVE_FFMPEG
+
+    namespace {
+        // libavcodec encoder behind each codec name
+        struct FFmpegCodec {
+            const char* name;
+            const char* encoder;  // Preferred libavcodec encoder
+            AVCodecID fallbackId; // Any encoder for this ID if the preferred one is missing
+            bool annexB;          // Bitstream is H.264 Annex B, so slices can be split out
+        };
+
+        const FFmpegCodec kFFmpegCodecs[] = {
+            {"h264", "libx264", AV_CODEC_ID_H264, true},
+            {"vp8", "libvpx", AV_CODEC_ID_NONE, false},
+            {"vp9", "libvpx-vp9", AV_CODEC_ID_NONE, false},
+            {"av1", "libsvtav1", AV_CODEC_ID_NONE, false},
+        };
+
+        const FFmpegCodec* FindFFmpegCodec(const std::string& name) {
+            for (const auto& codec : kFFmpegCodecs) {
+                if (name == codec.name) return &codec;
+            }
+            return nullptr;
+        }
+
+        const AVCodec* FindEncoder(const FFmpegCodec& codec) {
+            const AVCodec* encoder = avcodec_find_encoder_by_name(codec.encoder);
+            if (!encoder && codec.fallbackId != AV_CODEC_ID_NONE) encoder = avcodec_find_encoder(codec.fallbackId);
+            return encoder;
+        }
+
+        // Offsets just past each slice in an Annex B stream. A slice ends
+        // after a VCL NAL unit; parameter sets and SEI travel with the
+        // slice that follows them.
+        void FindSliceEnds(const uint8* data, size_t size, std::vector<size_t>& ends) {
+            ends.clear();
+            bool pendingVcl = false;
+            for (size_t i = 0; i + 3 <= size; i++) {
+                if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) continue;
+
+                // The previous NAL unit ends where this start code begins
+                size_t begin = (i > 0 && data[i - 1] == 0) ? i - 1 : i;
+                if (pendingVcl) ends.push_back(begin);
+
+                uint8 nalType = i + 3 < size ? (data[i + 3] & 0x1f) : 0;
+                pendingVcl = nalType == 1 || nalType == 5; // Non-IDR / IDR slice
+                i += 2;
+            }
+
+            // Anything after the last VCL unit belongs to the last slice
+            if (pendingVcl || ends.empty()) {
+                ends.push_back(size);
+            } else {
+                ends.back() = size;
+            }
+        }
+
+        std::string AVErrorString(int error) {
+            char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+            av_strerror(error, buffer, sizeof(buffer));
+            return buffer;
+        }
     }
 
+    // H.264, VP8, VP9 or AV1 through libavcodec, configured for low latency
+    class FFmpegVideoEncoder : public IVideoEncoder {
+    public:
+        explicit FFmpegVideoEncoder(const FFmpegCodec& codec) : m_codec(codec), m_initialized(false) {}
+
+        ~FFmpegVideoEncoder() {
+            Cleanup();
+        }
+
+        bool Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) override {
+            Cleanup();
+
+            m_width = width;
+            m_height = height;
+            m_fps = fps ? fps : 30;
+            m_bitrate = bitrate;
+
+            const AVCodec* codec = FindEncoder(m_codec);
+            if (!codec) {
+                std::cerr << "FFmpeg: No " << m_codec.name << " encoder available" << std::endl;
+                return false;
+            }
+
+            m_context = avcodec_alloc_context3(codec);
+            if (!m_context) return false;
+
+            // Timestamps are capture microseconds
+            m_context->width = width;
+            m_context->height = height;
+            m_context->time_base = AVRational{1, 1000000};
+            m_context->framerate = AVRational{static_cast<int>(m_fps), 1};
+            m_context->pix_fmt = AV_PIX_FMT_YUV420P;
+            m_context->colorspace = AVCOL_SPC_BT709; // What YuvConverter produces
+            m_context->color_range = AVCOL_RANGE_MPEG;
+            m_context->color_primaries = AVCOL_PRI_BT709;
+            m_context->color_trc = AVCOL_TRC_BT709;
+            m_context->bit_rate = bitrate;
+            m_context->rc_max_rate = bitrate;
+            m_context->rc_buffer_size = static_cast<int>(bitrate / m_fps * 2); // About two frames of VBV
+            m_context->gop_size = m_keyframeInterval ? static_cast<int>(m_keyframeInterval) : static_cast<int>(m_fps * 2);
+            m_context->max_b_frames = 0;
+
+            // H.264 slices, encoded in parallel by sliced threads
+            if (m_codec.annexB && m_sliceCount > 1) {
+                m_context->slices = static_cast<int>(m_sliceCount);
+                m_context->thread_type = FF_THREAD_SLICE;
+            }
+
+            ConfigureEncoder(codec->name);
+
+            int result = avcodec_open2(m_context, codec, nullptr);
+            if (result < 0) {
+                std::cerr << "FFmpeg: Failed to open " << codec->name << ": " << AVErrorString(result) << std::endl;
+                Cleanup();
+                return false;
+            }
+
+            m_frame = av_frame_alloc();
+            m_packet = av_packet_alloc();
+            if (!m_frame || !m_packet) {
+                Cleanup();
+                return false;
+            }
+
+            m_frame->format = AV_PIX_FMT_YUV420P;
+            m_frame->width = width;
+            m_frame->height = height;
+            if (av_frame_get_buffer(m_frame, 32) < 0) {
+                Cleanup();
+                return false;
+            }
+
+            m_lastPts = -1;
+            m_openFps = m_fps;
+            m_framesSinceKeyframe = 0;
+            m_rateInPlace = strcmp(codec->name, "libx264") == 0;
+            m_needsReopen = false;
+            m_initialized = true;
+            std::cout << "FFmpeg: " << codec->name << " " << width << "x" << height << " @ " << m_fps
+                      << " fps, " << bitrate << " bps, GOP " << m_context->gop_size << std::endl;
+            return true;
+        }
+
+        bool EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) override {
+            if (!m_initialized) return false;
+
+            // A new resolution re-opens the codec right away. Other settings
+            // that need a re-open wait for the next scheduled or requested
+            // keyframe, so changing them does not add an IDR frame to the
+            // stream. With intra refresh nothing is scheduled, so they wait
+            // one refresh period.
+            bool keyframeRequested = m_keyframeRequested.exchange(false);
+            bool keyframeDue = keyframeRequested || m_framesSinceKeyframe == 0 ||
+                               m_framesSinceKeyframe >= static_cast<uint32>(m_context->gop_size);
+
+            // The first regions of interest may need settings the codec was
+            // not opened with (adaptive quantization on libx264's fastest preset)
+            if (!frame.regionsOfInterest.empty() && !m_regionsOfInterest) {
+                m_regionsOfInterest = true;
+                m_needsReopen = m_needsReopen || !m_regionsApplied;
+            }
+            if ((m_needsReopen && keyframeDue) || frame.width != m_width || frame.height != m_height) {
+                if (!Initialize(frame.width, frame.height, m_fps, m_bitrate)) return false;
+            }
+
+            // The encoder has released the previous frame, so this does not copy
+            if (av_frame_make_writable(m_frame) < 0) return false;
+
+            YuvImage yuv;
+            yuv.y = m_frame->data[0];
+            yuv.u = m_frame->data[1];
+            yuv.v = m_frame->data[2];
+            yuv.yStride = static_cast<uint32>(m_frame->linesize[0]);
+            yuv.uStride = static_cast<uint32>(m_frame->linesize[1]);
+            yuv.vStride = static_cast<uint32>(m_frame->linesize[2]);
+            if (frame.format == 2) {
+                // Already converted by the capture, in the same BT.709 limited range
+                CopyYuv420(frame, yuv);
+            } else {
+                m_yuvConverter.Convert(frame.data, frame.stride, frame.width, frame.height, yuv);
+            }
+            FrameTracer::Instance().Mark(frame.sequence, TraceStage::Converted);
+            SetRegionsOfInterest(frame);
+
+            // A freshly opened codec starts with a keyframe anyway
+            bool forceKeyframe = keyframeRequested && m_framesSinceKeyframe > 0;
+            m_frame->pict_type = forceKeyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+            // PTS must be strictly increasing even if a frame is sent twice
+            int64_t pts = static_cast<int64_t>(frame.timestamp);
+            m_frame->pts = pts > m_lastPts ? pts : m_lastPts + 1;
+            m_lastPts = m_frame->pts;
+
+            int result = avcodec_send_frame(m_context, m_frame);
+            if (result < 0) {
+                std::cerr << "FFmpeg: send_frame failed: " << AVErrorString(result) << std::endl;
+                return false;
+            }
+
+            encodedData.clear();
+            m_lastKeyframe = false;
+            while ((result = avcodec_receive_packet(m_context, m_packet)) == 0) {
+                m_lastKeyframe |= (m_packet->flags & AV_PKT_FLAG_KEY) != 0;
+                UpdateQP();
+                size_t offset = encodedData.size();
+                encodedData.resize(offset + m_packet->size);
+                memcpy(encodedData.data() + offset, m_packet->data, m_packet->size);
+                av_packet_unref(m_packet);
+            }
+
+            if (result != AVERROR(EAGAIN) && result != AVERROR_EOF) {
+                std::cerr << "FFmpeg: receive_packet failed: " << AVErrorString(result) << std::endl;
+                return false;
+            }
+
+            m_framesSinceKeyframe = m_lastKeyframe ? 1 : m_framesSinceKeyframe + 1;
+            if (encodedData.empty()) return false;
+
+            m_encoded.Record(encodedData.size());
+            return true;
+        }
+
+        // libavcodec returns whole access units, so the slices of a frame
+        // become available together; splitting them still lets the sender
+        // and the receiver's decoder start on the first slice right away
+        bool EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) override {
+            packet.Reset(frame);
+            if (!EncodeFrame(frame, packet.data)) return false;
+            packet.keyframe = m_lastKeyframe;
+
+            // Only H.264 slices can be sent on their own; other codecs send
+            // the frame as one slice
+            if (m_codec.annexB) {
+                FindSliceEnds(packet.data.data(), packet.data.size(), packet.sliceEnds);
+            } else {
+                packet.sliceEnds.push_back(packet.data.size());
+            }
+            if (onSlice) {
+                for (uint32 i = 0; i < packet.GetSliceCount(); i++) onSlice(packet.GetSlice(i));
+            }
+            return true;
+        }
+
+        EncoderStats GetStats() override {
+            ThroughputMeter::Rates rates = m_encoded.GetRates();
+            EncoderStats stats = {m_encoded.GetItems(), m_encoded.GetBytes(), rates.bitsPerSecond,
+                                  rates.itemsPerSecond, m_encoded.GetLastMillis()};
+            stats.averageQP = m_averageQP.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        bool IsHardwareAccelerated() const override { return false; }
+
+        // Once streaming, libx264 picks up new rate control targets on the
+        // open context at the next frame. Settings it cannot change in place,
+        // and rate changes on other encoders, re-open the codec at the next
+        // keyframe (straight away if nothing was encoded since opening).
+        void SetBitrate(uint32 bitrate) override {
+            if (m_initialized && m_rateInPlace && m_framesSinceKeyframe > 0) {
+                m_bitrate = bitrate;
+                UpdateRateControl();
+            } else {
+                Update(m_bitrate, bitrate);
+            }
+        }
+
+        void SetFPS(uint32 fps) override {
+            fps = std::max<uint32>(1, fps);
+            if (m_initialized && m_rateInPlace && m_framesSinceKeyframe > 0) {
+                m_fps = fps;
+                UpdateRateControl();
+            } else {
+                Update(m_fps, fps);
+            }
+        }
+
+        void SetQuality(uint32 quality) override { Update(m_quality, quality); }
+        void SetKeyframeInterval(uint32 frames) override { Update(m_keyframeInterval, frames); }
+        void SetSliceCount(uint32 slices) override { Update(m_sliceCount, std::max<uint32>(1, slices)); }
+        void RequestKeyframe() override { m_keyframeRequested = true; }
+
+        void SetIntraRefresh(bool enabled) override {
+            if (m_intraRefresh == enabled) return;
+            m_intraRefresh = enabled;
+            m_needsReopen = m_initialized;
+        }
+
+        std::vector<std::string> GetSupportedCodecs() const override {
+            return GetAvailableVideoCodecs();
+        }
+
+    private:
+        void Update(uint32& setting, uint32 value) {
+            if (setting == value) return;
+            setting = value;
+            m_needsReopen = m_initialized;
+        }
+
+        // The encoder budgets bitrate / (frame rate it was opened with) per
+        // frame, so a new frame rate is folded into the bitrate it is given
+        void UpdateRateControl() {
+            uint64 target = static_cast<uint64>(m_bitrate) * m_openFps / m_fps;
+            m_context->bit_rate = static_cast<int64_t>(target);
+            m_context->rc_max_rate = static_cast<int64_t>(target);
+            m_context->rc_buffer_size = static_cast<int>(target / m_openFps * 2);
+        }
+
+        static void CopyYuv420(const VideoFrame& frame, const YuvImage& dst) {
+            const YuvImage src = GetYuv420Planes(frame);
+            const uint32 chromaWidth = (frame.width + 1) / 2;
+            for (uint32 y = 0; y < frame.height; y++) {
+                memcpy(dst.y + static_cast<size_t>(y) * dst.yStride, src.y + static_cast<size_t>(y) * src.yStride, frame.width);
+            }
+            for (uint32 y = 0; y < (frame.height + 1) / 2; y++) {
+                memcpy(dst.u + static_cast<size_t>(y) * dst.uStride, src.u + static_cast<size_t>(y) * src.uStride, chromaWidth);
+                memcpy(dst.v + static_cast<size_t>(y) * dst.vStride, src.v + static_cast<size_t>(y) * src.vStride, chromaWidth);
+            }
+        }
+
+        // Attach the frame's regions of interest as side data, which libx264
+        // (with adaptive quantization) and libvpx turn into per-block quant
+        // offsets. Replaces the previous frame's regions. The side data
+        // stays attached to m_frame and is rewritten in place while the
+        // regions fit in m_roiBuffer; the encoder has read the previous
+        // frame's regions by the time its packets have been received.
+        void SetRegionsOfInterest(const VideoFrame& frame) {
+            AVFrameSideData* sideData = av_frame_get_side_data(m_frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+            if (frame.regionsOfInterest.empty()) {
+                if (sideData) av_frame_remove_side_data(m_frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+                return;
+            }
+
+            const size_t size = frame.regionsOfInterest.size() * sizeof(AVRegionOfInterest);
+            if (!m_roiBuffer || static_cast<size_t>(m_roiBuffer->size) < size) {
+                av_frame_remove_side_data(m_frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+                sideData = nullptr;
+                av_buffer_unref(&m_roiBuffer);
+                m_roiBuffer = av_buffer_alloc(std::max(size, kRegionsOfInterestReserved * sizeof(AVRegionOfInterest)));
+                if (!m_roiBuffer) return;
+            }
+            if (!sideData) {
+                AVBufferRef* buffer = av_buffer_ref(m_roiBuffer);
+                if (!buffer) return;
+                sideData = av_frame_new_side_data_from_buf(m_frame, AV_FRAME_DATA_REGIONS_OF_INTEREST, buffer);
+                if (!sideData) {
+                    av_buffer_unref(&buffer);
+                    return;
+                }
+            }
+            sideData->size = size;
+
+            AVRegionOfInterest* regions = reinterpret_cast<AVRegionOfInterest*>(sideData->data);
+            for (const RegionOfInterest& roi : frame.regionsOfInterest) {
+                AVRegionOfInterest& region = *regions++;
+                region.self_size = sizeof(AVRegionOfInterest);
+                region.top = roi.rect.y;
+                region.bottom = roi.rect.y + static_cast<int>(roi.rect.height);
+                region.left = roi.rect.x;
+                region.right = roi.rect.x + static_cast<int>(roi.rect.width);
+                region.qoffset = AVRational{static_cast<int>(std::max(-1.0f, std::min(1.0f, roi.qpOffset)) * 1000), 1000};
+            }
+        }
+
+        // Low-latency settings of each encoder. Quality (0-100) picks a
+        // speed from the fast end of the encoder's range.
+        void ConfigureEncoder(const char* encoder) {
+            const int speedStep = m_quality < 34 ? 2 : (m_quality < 67 ? 1 : 0);
+            void* options = m_context->priv_data;
+            m_regionsApplied = false;
+
+            if (strcmp(encoder, "libx264") == 0) {
+                static const char* const kPresets[] = {"veryfast", "superfast", "ultrafast"};
+                av_opt_set(options, "preset", kPresets[speedStep], 0);
+                av_opt_set(options, "tune", "zerolatency", 0);
+                av_opt_set_int(options, "forced-idr", 1, 0); // Requested keyframes are IDR frames
+                if (m_intraRefresh) {
+                    // Rolling intra columns over each GOP; only the first frame is IDR
+                    av_opt_set_int(options, "intra-refresh", 1, 0);
+                }
+                if (m_regionsOfInterest && speedStep == 2) {
+                    // ultrafast switches adaptive quantization off, and
+                    // libx264 only applies regions of interest through it
+                    av_opt_set_int(options, "aq-mode", 1, 0); // Variance AQ
+                }
+                m_regionsApplied = true;
+            } else if (strcmp(encoder, "libvpx") == 0 || strcmp(encoder, "libvpx-vp9") == 0) {
+                // Realtime deadline, no lookahead and CBR, as for WebRTC
+                av_opt_set(options, "deadline", "realtime", 0);
+                av_opt_set_int(options, "cpu-used", 6 + speedStep, 0);
+                av_opt_set_int(options, "lag-in-frames", 0, 0);
+                m_regionsApplied = true;
+                m_context->rc_min_rate = m_context->bit_rate;
+                m_context->thread_count = 0; // One thread per core
+                if (strcmp(encoder, "libvpx-vp9") == 0) {
+                    av_opt_set_int(options, "row-mt", 1, 0);
+                    av_opt_set(options, "tune-content", "screen", 0);
+                }
+            } else if (strcmp(encoder, "libsvtav1") == 0) {
+                // Low-delay prediction (no reordering) with screen content
+                // tools switched on when the encoder detects them
+                av_opt_set_int(options, "preset", 10 + speedStep, 0);
+                av_opt_set(options, "svtav1-params", "pred-struct=1:scm=2", 0);
+            }
+
+            if (m_intraRefresh && strcmp(encoder, "libx264") != 0) {
+                std::cout << "FFmpeg: " << encoder << " has no intra refresh, using keyframes" << std::endl;
+            }
+            if (m_regionsOfInterest && !m_regionsApplied) {
+                std::cout << "FFmpeg: " << encoder << " ignores regions of interest, using uniform quality" << std::endl;
+            }
+        }
+
+        // Encoders that report it (libx264, SVT-AV1) attach the frame's
+        // quality as a lambda; keep a running average of the QP
+        void UpdateQP() {
+#if LIBAVCODEC_VERSION_MAJOR >= 59
+            size_t size = 0;
+#else
+            int size = 0;
+#endif
+            const uint8_t* stats = av_packet_get_side_data(m_packet, AV_PKT_DATA_QUALITY_STATS, &size);
+            if (!stats || size < 4) return;
+            uint32 lambda = stats[0] | (stats[1] << 8) | (stats[2] << 16) | (static_cast<uint32>(stats[3]) << 24);
+            double qp = static_cast<double>(lambda) / FF_QP2LAMBDA;
+            double average = m_averageQP.load(std::memory_order_relaxed);
+            m_averageQP.store(average > 0.0 ? average + (qp - average) * 0.1 : qp, std::memory_order_relaxed);
+        }
+
+        void Cleanup() {
+            av_frame_free(&m_frame);
+            av_buffer_unref(&m_roiBuffer);
+            av_packet_free(&m_packet);
+            avcodec_free_context(&m_context);
+            m_initialized = false;
+        }
+
+        // Regions of interest the side data buffer starts with room for,
+        // as many as RegionOfInterestTracker hands out by default
+        static constexpr size_t kRegionsOfInterestReserved = 16;
+
+        const FFmpegCodec& m_codec;
+        AVCodecContext* m_context = nullptr;
+        AVFrame* m_frame = nullptr;
+        AVPacket* m_packet = nullptr;
+        AVBufferRef* m_roiBuffer = nullptr; // Regions of interest side data, reused every frame
+        YuvConverter m_yuvConverter; // BT.709 limited range, threaded for large frames
+        int64_t m_lastPts = -1;
+
+        uint32 m_width = 0, m_height = 0, m_fps = 30, m_bitrate = 5000000, m_quality = 80;
+        uint32 m_keyframeInterval = 0; // 0 = two seconds
+        uint32 m_sliceCount = 1;
+        bool m_lastKeyframe = false;
+        uint32 m_openFps = 30;             // Frame rate the codec was opened with
+        uint32 m_framesSinceKeyframe = 0;  // Including the keyframe (0 = none since opening)
+        bool m_rateInPlace = false;        // Bitrate and frame rate change without a re-open
+        bool m_initialized;
+        bool m_needsReopen = false;
+        bool m_intraRefresh = false;
+        bool m_regionsOfInterest = false; // Frames have carried regions of interest
+        bool m_regionsApplied = false;    // The open codec turns them into quant offsets
+        std::atomic<bool> m_keyframeRequested{false};
+        ThroughputMeter m_encoded; // Read by GetStats from other threads
+        std::atomic<double> m_averageQP{0.0}; // Read by GetStats from other threads
+    };
+
+#endif // HAVE_FFMPEG
+
+    namespace {
+
+        const VideoCodecRegistration kRawRegistration(
+            {"raw", "Uncompressed BGRA", 1000, false, true, true},
+            [] { return std::make_unique<RawVideoEncoder>(); });
+
+#ifdef HAVE_FFMPEG
+        VideoCodecRegistration RegisterFFmpegCodec(const char* name, const char* description, int preference,
+                                                   bool slices) {
+            const FFmpegCodec& codec = *FindFFmpegCodec(name);
+            return VideoCodecRegistration(
+                {name, description, preference, false, false, slices, false, true},
+                [&codec] { return std::make_unique<FFmpegVideoEncoder>(codec); },
+                [&codec] { return FindEncoder(codec) != nullptr; });
+        }
+
+        const VideoCodecRegistration kH264Registration =
+            RegisterFFmpegCodec("h264", "H.264 (libx264 zerolatency)", 0, true);
+        const VideoCodecRegistration kVP9Registration =
+            RegisterFFmpegCodec("vp9", "VP9 (libvpx realtime, screen tuning)", 20, false);
+        const VideoCodecRegistration kAV1Registration =
+            RegisterFFmpegCodec("av1", "AV1 (SVT-AV1 low delay, screen content tools)", 30, false);
+        const VideoCodecRegistration kVP8Registration =
+            RegisterFFmpegCodec("vp8", "VP8 (libvpx realtime)", 40, false);
+#endif
+
+    } // namespace
+
 } // namespace SplashTop
@@ -0,0 +1,58 @@
+#include "frame_pool.h"
+
+namespace SplashTop {
+
+    namespace {
+        // A frame is free once the pool holds the only reference. The acquire
+        // fence pairs with the release done by the last consumer's shared_ptr
+        // destructor, so its reads of the pixels finish before we overwrite them.
+        bool IsFree(const std::shared_ptr<PooledFrame>& frame) {
+            if (frame.use_count() != 1) return false;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+    }
+
+    FramePool::FramePool(size_t maxFrames) : m_maxFrames(maxFrames), m_next(0) {
+        m_frames.reserve(maxFrames);
+    }
+
+    std::shared_ptr<PooledFrame> FramePool::Acquire(size_t bytes) {
+        std::shared_ptr<PooledFrame> frame;
+
+        // Round-robin so frames are reused in a stable order
+        for (size_t i = 0; i < m_frames.size(); i++) {
+            size_t index = (m_next + i) % m_frames.size();
+            if (IsFree(m_frames[index])) {
+                frame = m_frames[index];
+                m_next = index + 1;
+                break;
+            }
+        }
+
+        if (!frame) {
+            if (m_frames.size() >= m_maxFrames) {
+                return nullptr;
+            }
+            m_frames.push_back(std::make_shared<PooledFrame>());
+            frame = m_frames.back();
+            m_next = m_frames.size();
+        }
+
+        if (frame->storage.size() < bytes) {
+            frame->storage.resize(bytes);
+            frame->contentGeneration = 0;
+        }
+        frame->data = frame->storage.data();
+        return frame;
+    }
+
+    size_t FramePool::GetFreeFrames() const {
+        size_t count = 0;
+        for (const auto& frame : m_frames) {
+            if (frame.use_count() == 1) count++;
+        }
+        return count;
+    }
+
+} // namespace SplashTop
@@ -0,0 +1,175 @@
+#include "frame_scheduler.h"
+
+#ifdef PLATFORM_LINUX
+    #include <time.h>
+    #include <cerrno>
+#endif
+
+namespace SplashTop {
+
+    namespace {
+
+        std::chrono::nanoseconds IntervalForFPS(uint32 fps) {
+            return std::chrono::nanoseconds(1000000000 / std::max<uint32>(fps, 1));
+        }
+
+        uint32 ToMicros(std::chrono::nanoseconds duration) {
+            int64 micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+            return static_cast<uint32>(std::min<int64>(std::max<int64>(micros, 0), UINT32_MAX));
+        }
+
+        // Value below which the given fraction of the samples lie
+        double Percentile(const std::vector<uint32>& sorted, double fraction) {
+            if (sorted.empty()) return 0.0;
+            size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+            return sorted[std::min(index, sorted.size() - 1)];
+        }
+
+    } // namespace
+
+    FrameScheduler::FrameScheduler(uint32 fps, Policy policy, uint32 maxCatchUp)
+        : m_fps(std::max<uint32>(fps, 1))
+        , m_policy(policy)
+        , m_maxCatchUp(maxCatchUp)
+        , m_interval(IntervalForFPS(fps)) {
+        m_jitter.reserve(kSampleCount);
+        m_lateness.reserve(kSampleCount);
+    }
+
+    void FrameScheduler::SetFPS(uint32 fps) {
+        m_fps = std::max<uint32>(fps, 1);
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_interval = IntervalForFPS(m_fps);
+        }
+        m_phase = m_phase % m_interval;
+    }
+
+    void FrameScheduler::SetPhase(std::chrono::nanoseconds phase) {
+        m_phase = phase % m_interval;
+        if (m_phase.count() < 0) m_phase += m_interval;
+    }
+
+    void FrameScheduler::AlignTo(uint64 producerTimestampMicros, std::chrono::microseconds lead) {
+        auto producerPhase = std::chrono::nanoseconds(static_cast<int64>(producerTimestampMicros) * 1000) % m_interval;
+        auto target = (producerPhase + lead) % m_interval;
+
+        // Shortest way round the interval from the current phase
+        auto difference = (target - m_phase) % m_interval;
+        if (difference > m_interval / 2) difference -= m_interval;
+        if (difference < -m_interval / 2) difference += m_interval;
+
+        // Far off (first call, changed rate): jump; close: ease in
+        SetPhase(std::chrono::abs(difference) > m_interval / 4 ? target : m_phase + difference / 4);
+    }
+
+    FrameScheduler::Clock::time_point FrameScheduler::NextGridPoint(Clock::time_point time) const {
+        auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()) - m_phase;
+        auto index = sinceEpoch / m_interval + 1;
+        return Clock::time_point(std::chrono::duration_cast<Clock::duration>(index * m_interval + m_phase));
+    }
+
+    uint32 FrameScheduler::WaitForNextFrame() {
+        Clock::time_point now = Clock::now();
+        if (!m_started) {
+            m_started = true;
+            m_deadline = NextGridPoint(now);
+            SleepUntil(m_deadline);
+            m_lastWake = Clock::now();
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_ticks++;
+            return 0;
+        }
+
+        // Half an interval on from the last deadline, so a changed rate or
+        // phase neither repeats a tick nor leaves a gap
+        Clock::time_point next = NextGridPoint(m_deadline + m_interval / 2);
+
+        // Deadlines already behind us, counting next
+        int64 behind = now < next ? 0 : (now - next) / m_interval + 1;
+        uint32 missed = 0;
+        if (behind <= 1) {
+            m_caughtUp = 0;
+        } else if (m_policy == Policy::CatchUp && m_caughtUp < m_maxCatchUp) {
+            m_caughtUp++;
+        } else {
+            // Tick once for the most recent deadline
+            missed = static_cast<uint32>(behind - 1);
+            next += (behind - 1) * std::chrono::duration_cast<Clock::duration>(m_interval);
+            m_caughtUp = 0;
+        }
+
+        Clock::time_point lastDeadline = m_deadline;
+        m_deadline = next;
+        SleepUntil(next);
+
+        Clock::time_point wake = Clock::now();
+        auto jitter = (wake - m_lastWake) - (m_deadline - lastDeadline);
+        m_lastWake = wake;
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            uint32 jitterMicros = ToMicros(std::chrono::abs(std::chrono::duration_cast<std::chrono::nanoseconds>(jitter)));
+            uint32 latenessMicros = ToMicros(std::chrono::duration_cast<std::chrono::nanoseconds>(wake - m_deadline));
+            if (m_jitter.size() < kSampleCount) {
+                m_jitter.push_back(jitterMicros);
+                m_lateness.push_back(latenessMicros);
+            } else {
+                m_jitter[m_nextSample] = jitterMicros;
+                m_lateness[m_nextSample] = latenessMicros;
+            }
+            m_nextSample = (m_nextSample + 1) % kSampleCount;
+            m_ticks++;
+            m_missed += missed;
+        }
+        return missed;
+    }
+
+    void FrameScheduler::SleepUntil(Clock::time_point deadline) {
+#ifdef PLATFORM_LINUX
+        // steady_clock is CLOCK_MONOTONIC in both libstdc++ and libc++
+        int64 nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        timespec time;
+        time.tv_sec = static_cast<time_t>(nanos / 1000000000);
+        time.tv_nsec = static_cast<long>(nanos % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) == EINTR) {
+        }
+#else
+        std::this_thread::sleep_until(deadline);
+#endif
+    }
+
+    void FrameScheduler::Reset() {
+        m_started = false;
+        m_caughtUp = 0;
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_jitter.clear();
+        m_lateness.clear();
+        m_nextSample = 0;
+        m_ticks = 0;
+        m_missed = 0;
+    }
+
+    FrameTimingStats FrameScheduler::GetStats() const {
+        FrameTimingStats stats;
+        std::vector<uint32> jitter;
+        std::vector<uint32> lateness;
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            stats.ticks = m_ticks;
+            stats.missed = m_missed;
+            jitter = m_jitter;
+            lateness = m_lateness;
+            stats.intervalMicros = std::chrono::duration<double, std::micro>(m_interval).count();
+        }
+
+        std::sort(jitter.begin(), jitter.end());
+        std::sort(lateness.begin(), lateness.end());
+        stats.jitterP50Micros = Percentile(jitter, 0.50);
+        stats.jitterP95Micros = Percentile(jitter, 0.95);
+        stats.jitterP99Micros = Percentile(jitter, 0.99);
+        stats.jitterMaxMicros = jitter.empty() ? 0.0 : jitter.back();
+        stats.latenessP99Micros = Percentile(lateness, 0.99);
+        return stats;
+    }
+
+} // namespace SplashTop
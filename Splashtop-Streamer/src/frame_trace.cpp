@@ -0,0 +1,200 @@
+#include "frame_trace.h"
+
+namespace SplashTop {
+
+    namespace {
+
+        const size_t kStageCount = static_cast<size_t>(TraceStage::Count);
+
+        // Chrome trace thread IDs of the pipeline threads
+        enum TraceThread {
+            kCaptureThread = 1,
+            kEncodeThread = 2,
+            kSendThread = 3,
+            kFramesThread = 4
+        };
+
+        uint64 NowMicros() {
+            return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Writes events separated by commas
+        class TraceWriter {
+        public:
+            explicit TraceWriter(std::ostream& out) : m_out(out) {}
+
+            void ThreadName(int tid, const char* name) {
+                Begin();
+                m_out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid
+                      << ",\"args\":{\"name\":\"" << name << "\"}}";
+            }
+
+            // Slice on a thread's track, if both ends were reached
+            void Complete(int tid, const char* name, uint64 frameId, uint64 start, uint64 end) {
+                if (!start || !end || end < start) return;
+                Begin();
+                m_out << "{\"ph\":\"X\",\"name\":\"" << name << "\",\"pid\":1,\"tid\":" << tid
+                      << ",\"ts\":" << start << ",\"dur\":" << end - start
+                      << ",\"args\":{\"frame\":" << frameId << "}}";
+            }
+
+            // Slice on the frame's own async track; slices of one frame nest
+            void Async(const char* name, uint64 frameId, uint64 start, uint64 end) {
+                if (!start || !end || end < start) return;
+                Begin();
+                m_out << "{\"ph\":\"b\",\"cat\":\"frame\",\"name\":\"" << name << "\",\"id\":" << frameId
+                      << ",\"pid\":1,\"tid\":" << kFramesThread << ",\"ts\":" << start << "}";
+                Begin();
+                m_out << "{\"ph\":\"e\",\"cat\":\"frame\",\"name\":\"" << name << "\",\"id\":" << frameId
+                      << ",\"pid\":1,\"tid\":" << kFramesThread << ",\"ts\":" << end << "}";
+            }
+
+        private:
+            void Begin() {
+                if (m_count++) m_out << ",";
+                m_out << "\n";
+            }
+
+            std::ostream& m_out;
+            size_t m_count = 0;
+        };
+
+    } // namespace
+
+    const char* GetTraceStageName(TraceStage stage) {
+        switch (stage) {
+            case TraceStage::CaptureStart: return "capture start";
+            case TraceStage::CaptureEnd: return "capture end";
+            case TraceStage::Queued: return "queued";
+            case TraceStage::EncodeStart: return "encode start";
+            case TraceStage::Converted: return "converted";
+            case TraceStage::EncodeEnd: return "encode end";
+            case TraceStage::SendStart: return "send start";
+            case TraceStage::SendEnd: return "send end";
+            case TraceStage::Dropped: return "dropped";
+            default: return "unknown";
+        }
+    }
+
+    FrameTracer& FrameTracer::Instance() {
+        static FrameTracer tracer;
+        return tracer;
+    }
+
+    void FrameTracer::SetEnabled(bool enabled) {
+        std::lock_guard<std::mutex> lock(m_enableMutex);
+        if (enabled && !m_storage) {
+            m_storage = std::make_unique<Slot[]>(kCapacity);
+            m_slots.store(m_storage.get(), std::memory_order_release);
+        }
+        m_enabled.store(enabled, std::memory_order_release);
+    }
+
+    void FrameTracer::BeginFrame(uint64 frameId, uint64 captureStartMicros) {
+        if (!frameId || !IsEnabled()) return;
+        Slot& slot = m_slots.load(std::memory_order_relaxed)[frameId & (kCapacity - 1)];
+
+        // Readers skip the slot while it holds no ID
+        slot.frameId.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kStageCount; i++) slot.times[i].store(0, std::memory_order_relaxed);
+        slot.times[static_cast<size_t>(TraceStage::CaptureStart)].store(captureStartMicros, std::memory_order_relaxed);
+        slot.frameId.store(frameId, std::memory_order_release);
+    }
+
+    void FrameTracer::Mark(uint64 frameId, TraceStage stage) {
+        if (!frameId || !IsEnabled()) return;
+        Mark(frameId, stage, NowMicros());
+    }
+
+    void FrameTracer::Mark(uint64 frameId, TraceStage stage, uint64 micros) {
+        if (!frameId || !IsEnabled()) return;
+        Slot& slot = m_slots.load(std::memory_order_relaxed)[frameId & (kCapacity - 1)];
+        if (slot.frameId.load(std::memory_order_acquire) != frameId) return;
+        slot.times[static_cast<size_t>(stage)].store(micros, std::memory_order_relaxed);
+    }
+
+    std::vector<FrameTraceRecord> FrameTracer::GetRecords(std::chrono::microseconds window) const {
+        std::vector<FrameTraceRecord> records;
+        const Slot* slots = m_slots.load(std::memory_order_acquire);
+        if (!slots) return records;
+
+        records.reserve(kCapacity);
+        for (size_t i = 0; i < kCapacity; i++) {
+            const Slot& slot = slots[i];
+            FrameTraceRecord record;
+            record.frameId = slot.frameId.load(std::memory_order_acquire);
+            if (!record.frameId) continue;
+            for (size_t stage = 0; stage < kStageCount; stage++) {
+                record.times[stage] = slot.times[stage].load(std::memory_order_relaxed);
+            }
+            // Skip a slot the capture thread reused while it was being read
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.frameId.load(std::memory_order_relaxed) != record.frameId) continue;
+            if (!record.Get(TraceStage::CaptureStart)) continue;
+            records.push_back(record);
+        }
+
+        std::sort(records.begin(), records.end(), [](const FrameTraceRecord& a, const FrameTraceRecord& b) {
+            return a.Get(TraceStage::CaptureStart) < b.Get(TraceStage::CaptureStart);
+        });
+        if (!records.empty()) {
+            uint64 newest = records.back().Get(TraceStage::CaptureStart);
+            uint64 windowMicros = static_cast<uint64>(window.count());
+            uint64 oldest = newest > windowMicros ? newest - windowMicros : 0;
+            records.erase(records.begin(), std::find_if(records.begin(), records.end(),
+                [oldest](const FrameTraceRecord& record) { return record.Get(TraceStage::CaptureStart) >= oldest; }));
+        }
+        return records;
+    }
+
+    void FrameTracer::WriteChromeTrace(std::ostream& out, const std::vector<FrameTraceRecord>& records) {
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        TraceWriter writer(out);
+        writer.ThreadName(kCaptureThread, "capture");
+        writer.ThreadName(kEncodeThread, "encode");
+        writer.ThreadName(kSendThread, "send");
+        writer.ThreadName(kFramesThread, "frames");
+
+        for (const auto& record : records) {
+            uint64 id = record.frameId;
+            uint64 encodeStart = record.Get(TraceStage::EncodeStart);
+            uint64 converted = record.Get(TraceStage::Converted);
+            uint64 encodeEnd = record.Get(TraceStage::EncodeEnd);
+
+            writer.Complete(kCaptureThread, "capture", id, record.Get(TraceStage::CaptureStart), record.Get(TraceStage::CaptureEnd));
+            writer.Complete(kEncodeThread, "encode", id, encodeStart, encodeEnd);
+            writer.Complete(kEncodeThread, "convert", id, encodeStart, converted);
+            writer.Complete(kSendThread, "send", id, record.Get(TraceStage::SendStart), record.Get(TraceStage::SendEnd));
+
+            // The frame from the screen to the wire, and where it waited
+            uint64 end = record.Get(TraceStage::SendEnd);
+            if (!end) end = record.Get(TraceStage::Dropped);
+            std::string name = "frame " + std::to_string(id);
+            writer.Async(name.c_str(), id, record.Get(TraceStage::CaptureStart), end);
+            writer.Async("wait for capture stage", id, record.Get(TraceStage::CaptureEnd), record.Get(TraceStage::Queued));
+            writer.Async("frame queue", id, record.Get(TraceStage::Queued), encodeStart);
+            writer.Async("dropped", id, record.Get(TraceStage::Queued), record.Get(TraceStage::Dropped));
+            writer.Async("packet queue", id, encodeEnd, record.Get(TraceStage::SendStart));
+        }
+        out << "\n]}\n";
+    }
+
+    bool FrameTracer::ExportChromeTrace(const std::string& path, std::chrono::microseconds window) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Cannot write frame trace to " << path << std::endl;
+            return false;
+        }
+        std::vector<FrameTraceRecord> records = GetRecords(window);
+        WriteChromeTrace(file, records);
+        if (!file) {
+            std::cerr << "Failed writing frame trace to " << path << std::endl;
+            return false;
+        }
+        std::cout << "Wrote " << records.size() << " frames to " << path << std::endl;
+        return true;
+    }
+
+} // namespace SplashTop
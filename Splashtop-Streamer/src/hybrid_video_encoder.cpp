@@ -0,0 +1,209 @@
+#include "hybrid_video_encoder.h"
+#include "codec_registry.h"
+#include <cstring>
+
+namespace SplashTop {
+
+    namespace {
+
+        constexpr uint32 kHybridMagic = 0x31485453; // "STH1"
+
+        const VideoCodecRegistration kHybridRegistration(
+            {"hybrid", "Tile codec for UI, H.264 for video regions", 10, false, false, false, true},
+            [] { return std::make_unique<HybridVideoEncoder>("h264"); },
+            [] { return VideoCodecRegistry::Instance().IsAvailable("h264"); });
+
+        inline void PutU16(std::vector<uint8>& out, uint32 value) {
+            out.push_back(static_cast<uint8>(value));
+            out.push_back(static_cast<uint8>(value >> 8));
+        }
+
+        inline void PutU32(std::vector<uint8>& out, uint32 value) {
+            PutU16(out, value & 0xFFFF);
+            PutU16(out, value >> 16);
+        }
+
+        inline void StoreU32(uint8* out, uint32 value) {
+            for (int i = 0; i < 4; i++) out[i] = static_cast<uint8>(value >> (8 * i));
+        }
+
+        inline bool SameGeometry(const DirtyTileMap& a, const DirtyTileMap& b) {
+            return a.tileSize == b.tileSize && a.tilesX == b.tilesX && a.tilesY == b.tilesY;
+        }
+
+        inline void CopyGeometry(DirtyTileMap& map, const DirtyTileMap& from) {
+            map.tileSize = from.tileSize;
+            map.tilesX = from.tilesX;
+            map.tilesY = from.tilesY;
+            map.bits.resize(from.bits.size());
+        }
+
+    } // namespace
+
+    HybridVideoEncoder::HybridVideoEncoder(const std::string& videoCodec)
+        : m_video(CreateVideoEncoder(videoCodec)) {
+    }
+    
+    HybridVideoEncoder::HybridVideoEncoder(std::unique_ptr<IVideoEncoder> video)
+        : m_video(std::move(video)) {
+    }
+
+    bool HybridVideoEncoder::Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) {
+        if (!m_tiles.Initialize(width, height, fps, bitrate)) return false;
+        if (!m_video->Initialize(width, height, fps, bitrate)) return false;
+        m_wasNatural = DirtyTileMap();
+        m_initialized = true;
+        return true;
+    }
+
+    void HybridVideoEncoder::SetFPS(uint32 fps) {
+        m_tiles.SetFPS(fps);
+        m_video->SetFPS(fps);
+    }
+
+    void HybridVideoEncoder::SetQuality(uint32 quality) {
+        m_tiles.SetQuality(quality);
+        m_video->SetQuality(quality);
+    }
+
+    void HybridVideoEncoder::SetKeyframeInterval(uint32 frames) {
+        m_tiles.SetKeyframeInterval(frames);
+        m_video->SetKeyframeInterval(frames);
+    }
+
+    void HybridVideoEncoder::RequestKeyframe() {
+        m_tiles.RequestKeyframe();
+        m_video->RequestKeyframe();
+    }
+
+    void HybridVideoEncoder::SetIntraRefresh(bool enabled) {
+        m_tiles.SetIntraRefresh(enabled);
+        m_video->SetIntraRefresh(enabled);
+    }
+
+    std::vector<std::string> HybridVideoEncoder::GetSupportedCodecs() const {
+        return GetAvailableVideoCodecs();
+    }
+
+    EncoderStats HybridVideoEncoder::GetStats() {
+        ThroughputMeter::Rates rates = m_encoded.GetRates();
+        EncoderStats stats = {m_encoded.GetItems(), m_encoded.GetBytes(), rates.bitsPerSecond,
+                              rates.itemsPerSecond, m_encoded.GetLastMillis()};
+        stats.averageQP = m_video->GetStats().averageQP; // Video regions only
+        return stats;
+    }
+
+    void HybridVideoEncoder::CopyTiles(const VideoFrame& frame, const DirtyTileMap& mask) {
+        const uint32 tileSize = mask.tileSize;
+        const size_t imageStride = static_cast<size_t>(frame.width) * 4;
+        for (uint32 ty = 0; ty < mask.tilesY; ty++) {
+            uint32 y = ty * tileSize;
+            uint32 height = std::min(tileSize, frame.height - y);
+            for (uint32 tx = 0; tx < mask.tilesX; tx++) {
+                if (!mask.IsDirty(tx, ty)) continue;
+                uint32 x = tx * tileSize;
+                size_t rowBytes = static_cast<size_t>(std::min(tileSize, frame.width - x)) * 4;
+                for (uint32 row = y; row < y + height; row++) {
+                    memcpy(m_videoImage.data() + row * imageStride + x * 4,
+                           frame.data + static_cast<size_t>(row) * frame.stride + x * 4, rowBytes);
+                }
+            }
+        }
+    }
+
+    bool HybridVideoEncoder::EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) {
+        if (!m_initialized || !frame.data || frame.format == 2) return false;
+
+        bool keyframe = m_tiles.FindChangedTiles(frame);
+        m_lastKeyframe = keyframe;
+        const DirtyTileMap& changed = m_tiles.GetChangedTiles();
+        const bool classified = SameGeometry(frame.naturalTiles, changed);
+
+        // The video layer image keeps its content between frames; synthetic
+        // tiles are simply never written into it
+        size_t imageBytes = static_cast<size_t>(frame.width) * frame.height * 4;
+        if (keyframe || !SameGeometry(m_wasNatural, changed) || m_videoImage.size() != imageBytes) {
+            m_videoImage.assign(imageBytes, 0);
+            m_wasNatural.Resize(frame.width, frame.height, changed.tileSize);
+        }
+        CopyGeometry(m_tileMask, changed);
+        CopyGeometry(m_videoMask, changed);
+        CopyGeometry(m_isNatural, changed);
+
+        // Changed synthetic tiles and tiles leaving the video layer go to the
+        // tile codec; changed natural tiles and tiles entering it are copied
+        // into the video layer
+        bool videoChanged = false;
+        for (size_t i = 0; i < changed.bits.size(); i++) {
+            uint64 natural = classified ? frame.naturalTiles.bits[i] : 0;
+            uint64 was = m_wasNatural.bits[i];
+            m_tileMask.bits[i] = (changed.bits[i] | was) & ~natural;
+            m_videoMask.bits[i] = (changed.bits[i] | ~was) & natural;
+            videoChanged |= m_videoMask.bits[i] != 0;
+            m_isNatural.bits[i] = natural;
+        }
+
+        m_videoMessage.clear();
+        if (videoChanged) {
+            CopyTiles(frame, m_videoMask);
+            m_videoFrame.data = m_videoImage.data();
+            m_videoFrame.width = frame.width;
+            m_videoFrame.height = frame.height;
+            m_videoFrame.stride = frame.width * 4;
+            m_videoFrame.timestamp = frame.timestamp;
+            m_videoFrame.format = 0;
+            m_videoFrame.sequence = frame.sequence;
+            m_videoFrame.regionsOfInterest = frame.regionsOfInterest;
+
+            // A video encoder may hold back its first frames
+            if (!m_video->EncodeFrame(m_videoFrame, m_videoMessage)) m_videoMessage.clear();
+        }
+        
+        // Without video for this frame the receiver's video layer is stale
+        // on the tiles that changed or entered it: send those losslessly and
+        // keep them out of the video layer until it has caught up
+        if (videoChanged && m_videoMessage.empty()) {
+            for (size_t i = 0; i < changed.bits.size(); i++) {
+                uint64 was = m_wasNatural.bits[i];
+                m_isNatural.bits[i] &= was & ~changed.bits[i];
+                m_tileMask.bits[i] = (changed.bits[i] | was) & ~m_isNatural.bits[i];
+            }
+        }
+        std::swap(m_wasNatural, m_isNatural);
+
+        encodedData.clear();
+        PutU32(encodedData, kHybridMagic);
+        PutU16(encodedData, changed.tilesX);
+        PutU16(encodedData, changed.tilesY);
+        size_t bitmapBytes = (static_cast<size_t>(changed.tilesX) * changed.tilesY + 7) / 8;
+        for (size_t i = 0; i < bitmapBytes; i++) {
+            encodedData.push_back(static_cast<uint8>(m_wasNatural.bits[i / 8] >> (8 * (i % 8))));
+        }
+
+        // The tile message goes straight into the output after its size
+        size_t tileSizeOffset = encodedData.size();
+        PutU32(encodedData, 0);
+        m_tiles.EncodeTiles(frame, m_tileMask, 0, changed.tilesY, keyframe, encodedData);
+        size_t tileBytes = encodedData.size() - tileSizeOffset - 4;
+        StoreU32(encodedData.data() + tileSizeOffset, static_cast<uint32>(tileBytes));
+
+        PutU32(encodedData, static_cast<uint32>(m_videoMessage.size()));
+        encodedData.insert(encodedData.end(), m_videoMessage.begin(), m_videoMessage.end());
+
+        m_encoded.Record(encodedData.size());
+        m_tileBytes += tileBytes;
+        m_videoBytes += m_videoMessage.size();
+        return true;
+    }
+
+    bool HybridVideoEncoder::EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) {
+        packet.Reset(frame);
+        if (!EncodeFrame(frame, packet.data)) return false;
+        packet.keyframe = m_lastKeyframe;
+
+        EncodedSlice slice = packet.AddSlice(packet.data.size(), 1);
+        if (onSlice) onSlice(slice);
+        return true;
+    }
+
+} // namespace SplashTop
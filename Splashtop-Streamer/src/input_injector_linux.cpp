@@ -1,5 +1,6 @@
 #include "input_injector.h"
 #include "platform.h"
+#include "stats.h"
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
@@ -14,6 +15,8 @@ private:
     Window root;
     int screen;
     uint32 screenWidth, screenHeight;
+    ThroughputMeter mouseEvents;    // Injected from the input thread, read by GetStats
+    ThroughputMeter keyboardEvents;
 
 public:
     LinuxInputInjector() : display(nullptr), root(0), screen(0), screenWidth(0), screenHeight(0) {}
@@ -47,6 +50,7 @@ public:
 
         XTestFakeMotionEvent(display, screen, x, y, CurrentTime);
         XFlush(display);
+        mouseEvents.Record();
         return true;
     }
 
@@ -68,6 +72,7 @@ public:
         }
         
         XFlush(display);
+        mouseEvents.Record();
         return true;
     }
 
@@ -80,6 +85,7 @@ public:
         XTestFakeButtonEvent(display, buttonCode, True, CurrentTime);
         XTestFakeButtonEvent(display, buttonCode, False, CurrentTime);
         XFlush(display);
+        mouseEvents.Record();
         
         return true;
     }
@@ -112,6 +118,7 @@ public:
         }
         
         XFlush(display);
+        keyboardEvents.Record();
         return true;
     }
 
@@ -119,6 +126,7 @@ public:
         if (!display) return false;
 
         // Simple text injection - convert each character to key press
+        uint64 injected = 0;
         for (char c : text) {
             KeySym keysym = static_cast<KeySym>(c);
             KeyCode xKeyCode = XKeysymToKeycode(display, keysym);
@@ -126,10 +134,12 @@ public:
             if (xKeyCode != NoSymbol) {
                 XTestFakeKeyEvent(display, xKeyCode, True, CurrentTime);
                 XTestFakeKeyEvent(display, xKeyCode, False, CurrentTime);
+                injected++;
             }
         }
         
         XFlush(display);
+        keyboardEvents.Record(0, injected);
         return true;
     }
 
@@ -141,8 +151,10 @@ public:
 
     InputStats GetStats() override {
         InputStats stats = {};
-        stats.mouseEvents = 0; // TODO: implement counter
-        stats.keyboardEvents = 0; // TODO: implement counter
+        stats.mouseEvents = mouseEvents.GetItems();
+        stats.keyboardEvents = keyboardEvents.GetItems();
+        stats.lastEventTime = std::max(mouseEvents.GetLastMillis(), keyboardEvents.GetLastMillis());
+        stats.eventsPerSecond = mouseEvents.GetRates().itemsPerSecond + keyboardEvents.GetRates().itemsPerSecond;
         return stats;
     }
 
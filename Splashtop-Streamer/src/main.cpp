@@ -1,4 +1,6 @@
 #include "splashtop_app.h"
+#include "codec_registry.h"
+#include "frame_trace.h"
 #include <iostream>
 #include <string>
 #include <csignal>
@@ -6,16 +8,25 @@
 namespace SplashTop {
 
     static SplashTopApp* g_app = nullptr;
+    static std::string g_tracePath;
+    static volatile std::sig_atomic_t g_traceRequested = 0;
 
     void SignalHandler(int signal) {
         if (g_app) {
             std::cout << "\nReceived signal " << signal << ", shutting down..." << std::endl;
             g_app->StopStreaming();
+            if (!g_tracePath.empty()) {
+                FrameTracer::Instance().ExportChromeTrace(g_tracePath);
+            }
             g_app->Shutdown();
         }
         exit(0);
     }
 
+    void TraceSignalHandler(int) {
+        g_traceRequested = 1;
+    }
+
     void PrintUsage(const char* programName) {
         std::cout << "SplashTop Remote Desktop Streamer" << std::endl;
         std::cout << "Usage: " << programName << " [options]" << std::endl;
@@ -25,6 +36,21 @@ namespace SplashTop {
         std::cout << "  -f, --fps <fps>         Target frame rate (default: 30)" << std::endl;
         std::cout << "  -b, --bitrate <bps>     Target bitrate in bits per second (default: 5000000)" << std::endl;
         std::cout << "  -q, --quality <0-100>   Video quality (default: 80)" << std::endl;
+        std::cout << "  -c, --codec <name>      Video codec (default: h264), one of:" << std::endl;
+        for (const auto& codec : VideoCodecRegistry::Instance().GetAvailable()) {
+            std::cout << "                            " << codec.name << " - " << codec.description << std::endl;
+        }
+        std::cout << "  -g, --gop <frames>      Keyframe interval in frames (default: 2 seconds)" << std::endl;
+        std::cout << "      --slices <count>    Slices per frame, sent as each is ready (default: 1)" << std::endl;
+        std::cout << "      --intra-refresh     Refresh the picture column by column instead of with keyframes" << std::endl;
+        std::cout << "      --yuv-capture       Convert to YUV during capture (codecs that take YUV input)" << std::endl;
+        std::cout << "      --half-size         Stream at half the screen size, scaled during YUV capture" << std::endl;
+        std::cout << "      --keepalive <ms>    Resend an unchanged screen this often, 0 = never (default: 1000)" << std::endl;
+        std::cout << "      --refine <frames>   Frames re-encoded once the screen settles, 0 = off (default: 2)" << std::endl;
+        std::cout << "      --metrics-port <port>  Serve Prometheus metrics at /metrics on this port" << std::endl;
+        std::cout << "      --metrics-address <ip> Address for the metrics endpoint (default: 127.0.0.1)" << std::endl;
+        std::cout << "      --trace <file>      Record frame timings; the last 30 s are written to file as" << std::endl;
+        std::cout << "                          Chrome trace JSON on SIGUSR1 and on exit" << std::endl;
         std::cout << "  -h, --help              Show this help message" << std::endl;
         std::cout << std::endl;
         std::cout << "Example:" << std::endl;
@@ -37,11 +63,25 @@ namespace SplashTop {
         std::cout << "Capture: " << stats.capture.framesCaptured << " frames, " 
                   << stats.capture.averageFPS << " FPS" << std::endl;
         std::cout << "Encoder: " << stats.encoder.framesEncoded << " frames, " 
+                  << stats.encoder.averageFPS << " FPS, "
                   << stats.encoder.averageBitrate / 1000000.0 << " Mbps" << std::endl;
         std::cout << "Streaming: " << stats.streaming.framesSent << " frames sent, " 
+                  << stats.streaming.averageFPS << " FPS, "
+                  << stats.streaming.averageBitrate / 1000000.0 << " Mbps, "
                   << (stats.streaming.isConnected ? "Connected" : "Disconnected") << std::endl;
+        std::cout << "Pipeline: capture " << stats.captureStage.busyMicros / 1000 << "/" << stats.captureStage.waitMicros / 1000
+                  << " ms busy/wait, encode " << stats.encodeStage.busyMicros / 1000 << "/" << stats.encodeStage.waitMicros / 1000
+                  << ", send " << stats.sendStage.busyMicros / 1000 << "/" << stats.sendStage.waitMicros / 1000
+                  << ", " << stats.frameQueue.dropped << " frames dropped before encoding" << std::endl;
+        std::cout << "Pacing: " << stats.pacing.missed << " ticks missed, interval jitter p50/p99/max "
+                  << stats.pacing.jitterP50Micros << "/" << stats.pacing.jitterP99Micros << "/"
+                  << stats.pacing.jitterMaxMicros << " us" << std::endl;
+        std::cout << "Latency: capture to send p50/p99 under " << stats.latency.GetPercentileMicros(0.5) / 1000.0
+                  << "/" << stats.latency.GetPercentileMicros(0.99) / 1000.0 << " ms" << std::endl;
+        std::cout << "Idle: " << stats.framesSkipped << " unchanged frames skipped" << std::endl;
         std::cout << "Input: " << stats.input.mouseEvents << " mouse, " 
-                  << stats.input.keyboardEvents << " keyboard events" << std::endl;
+                  << stats.input.keyboardEvents << " keyboard events, "
+                  << stats.input.eventsPerSecond << " events/s" << std::endl;
     }
 
 } // namespace SplashTop
@@ -55,6 +95,15 @@ int main(int argc, char* argv[]) {
     uint32 fps = 30;
     uint32 bitrate = 5000000;
     uint32 quality = 80;
+    uint32 gop = 0;
+    uint32 slices = 1;
+    bool intraRefresh = false;
+    bool yuvCapture = false;
+    bool halfSize = false;
+    StaticScreenSettings idle;
+    std::string codec = "h264";
+    uint16 metricsPort = 0; // 0 = no metrics endpoint
+    std::string metricsAddress = "127.0.0.1";
     
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -98,6 +147,68 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: Missing quality value" << std::endl;
                 return 1;
             }
+        } else if (arg == "-c" || arg == "--codec") {
+            if (i + 1 < argc) {
+                codec = argv[++i];
+            } else {
+                std::cerr << "Error: Missing codec name" << std::endl;
+                return 1;
+            }
+        } else if (arg == "-g" || arg == "--gop") {
+            if (i + 1 < argc) {
+                gop = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Error: Missing GOP value" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--slices") {
+            if (i + 1 < argc) {
+                slices = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Error: Missing slice count" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--intra-refresh") {
+            intraRefresh = true;
+        } else if (arg == "--yuv-capture") {
+            yuvCapture = true;
+        } else if (arg == "--half-size") {
+            halfSize = true;
+        } else if (arg == "--keepalive") {
+            if (i + 1 < argc) {
+                idle.keepaliveMs = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Error: Missing keepalive interval" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--refine") {
+            if (i + 1 < argc) {
+                idle.refineFrames = std::stoi(argv[++i]);
+            } else {
+                std::cerr << "Error: Missing refinement frame count" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--metrics-port") {
+            if (i + 1 < argc) {
+                metricsPort = static_cast<uint16>(std::stoi(argv[++i]));
+            } else {
+                std::cerr << "Error: Missing metrics port" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--metrics-address") {
+            if (i + 1 < argc) {
+                metricsAddress = argv[++i];
+            } else {
+                std::cerr << "Error: Missing metrics address" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--trace") {
+            if (i + 1 < argc) {
+                g_tracePath = argv[++i];
+            } else {
+                std::cerr << "Error: Missing trace file" << std::endl;
+                return 1;
+            }
         } else {
             std::cerr << "Error: Unknown argument " << arg << std::endl;
             PrintUsage(argv[0]);
@@ -109,6 +220,12 @@ int main(int argc, char* argv[]) {
     // Set up signal handlers
     signal(SIGINT, SignalHandler);
     signal(SIGTERM, SignalHandler);
+    if (!g_tracePath.empty()) {
+        FrameTracer::Instance().SetEnabled(true);
+#ifdef SIGUSR1
+        signal(SIGUSR1, TraceSignalHandler);
+#endif
+    }
     
     // Create and initialize application
     SplashTopApp app;
@@ -117,16 +234,24 @@ int main(int argc, char* argv[]) {
     std::cout << "SplashTop Remote Desktop Streamer v1.0.0" << std::endl;
     std::cout << "========================================" << std::endl;
     
+    app.SetVideoCodec(codec);
+    app.SetYuvCapture(yuvCapture, halfSize);
+    
+    // Set streaming parameters, so the encoder is opened with them
+    app.SetStreamingParameters(fps, bitrate, quality);
+    app.SetKeyframeInterval(gop);
+    app.SetSliceCount(slices);
+    app.SetIntraRefresh(intraRefresh);
+    app.SetIdleSettings(idle);
+    
     if (!app.Initialize()) {
         std::cerr << "Failed to initialize SplashTop application" << std::endl;
         return 1;
     }
     
-    // Set streaming parameters
-    app.SetStreamingParameters(fps, bitrate, quality);
-    
     std::cout << "Configuration:" << std::endl;
     std::cout << "  Server: " << server << ":" << port << std::endl;
+    std::cout << "  Codec: " << codec << std::endl;
     std::cout << "  FPS: " << fps << std::endl;
     std::cout << "  Bitrate: " << bitrate / 1000000.0 << " Mbps" << std::endl;
     std::cout << "  Quality: " << quality << "%" << std::endl;
@@ -138,6 +263,10 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if (metricsPort != 0) {
+        app.StartMetricsServer(metricsAddress, metricsPort);
+    }
+    
     std::cout << "Streaming started. Press Ctrl+C to stop." << std::endl;
     
     // Main loop - print statistics periodically
@@ -152,6 +281,11 @@ int main(int argc, char* argv[]) {
             lastStatsTime = now;
         }
         
+        if (g_traceRequested) {
+            g_traceRequested = 0;
+            FrameTracer::Instance().ExportChromeTrace(g_tracePath);
+        }
+        
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
@@ -0,0 +1,57 @@
+#include "metrics.h"
+
+namespace SplashTop {
+
+    namespace {
+
+        std::string FormatValue(double value) {
+            std::ostringstream out;
+            out.precision(12);
+            out << value;
+            return out.str();
+        }
+
+    } // namespace
+
+    void PrometheusWriter::Family(const char* name, const char* type, const char* help) {
+        m_text += "# HELP ";
+        m_text += name;
+        m_text += ' ';
+        m_text += help;
+        m_text += "\n# TYPE ";
+        m_text += name;
+        m_text += ' ';
+        m_text += type;
+        m_text += '\n';
+    }
+
+    void PrometheusWriter::Sample(const char* name, double value, const std::string& labels) {
+        m_text += name;
+        if (!labels.empty()) {
+            m_text += '{';
+            m_text += labels;
+            m_text += '}';
+        }
+        m_text += ' ';
+        m_text += FormatValue(value);
+        m_text += '\n';
+    }
+
+    void PrometheusWriter::Histogram(const char* name, const LatencyHistogram::Snapshot& snapshot,
+                                     const std::string& labels) {
+        const std::string prefix = labels.empty() ? std::string() : labels + ",";
+        const std::string base = name;
+
+        // Prometheus buckets are cumulative
+        uint64 cumulative = 0;
+        for (size_t i = 0; i < LatencyHistogram::kBucketCount; i++) {
+            cumulative += snapshot.counts[i];
+            Sample((base + "_bucket").c_str(), static_cast<double>(cumulative),
+                   prefix + "le=\"" + FormatValue(LatencyHistogram::kBucketBoundsMicros[i] / 1e6) + "\"");
+        }
+        Sample((base + "_bucket").c_str(), static_cast<double>(snapshot.count), prefix + "le=\"+Inf\"");
+        Sample((base + "_sum").c_str(), snapshot.sumMicros / 1e6, labels);
+        Sample((base + "_count").c_str(), static_cast<double>(snapshot.count), labels);
+    }
+
+} // namespace SplashTop
@@ -0,0 +1,149 @@
+#include "metrics_server.h"
+
+#ifndef PLATFORM_WINDOWS
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <cstring>
+#endif
+
+namespace SplashTop {
+
+    namespace {
+
+        const size_t kMaxRequestSize = 8192;
+
+#ifndef PLATFORM_WINDOWS
+        bool SendAll(int connection, const std::string& data) {
+            size_t sent = 0;
+            while (sent < data.size()) {
+                ssize_t result = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (result <= 0) return false;
+                sent += static_cast<size_t>(result);
+            }
+            return true;
+        }
+
+        std::string Response(const char* status, const char* contentType, const std::string& body) {
+            std::string response = "HTTP/1.1 ";
+            response += status;
+            response += "\r\nContent-Type: ";
+            response += contentType;
+            response += "\r\nContent-Length: " + std::to_string(body.size());
+            response += "\r\nConnection: close\r\n\r\n";
+            response += body;
+            return response;
+        }
+#endif
+
+    } // namespace
+
+    MetricsServer::~MetricsServer() {
+        Stop();
+    }
+
+#ifdef PLATFORM_WINDOWS
+    bool MetricsServer::Start(const std::string& address, uint16 port, Handler handler) {
+        (void)address; (void)port; (void)handler;
+        std::cerr << "Metrics endpoint is not available on Windows" << std::endl;
+        return false;
+    }
+
+    void MetricsServer::Stop() {}
+    void MetricsServer::ServeLoop() {}
+    void MetricsServer::ServeConnection(int connection) { (void)connection; }
+#else
+    bool MetricsServer::Start(const std::string& address, uint16 port, Handler handler) {
+        if (m_running) return false;
+
+        sockaddr_in bindAddress;
+        std::memset(&bindAddress, 0, sizeof(bindAddress));
+        bindAddress.sin_family = AF_INET;
+        bindAddress.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &bindAddress.sin_addr) != 1) {
+            std::cerr << "Metrics: invalid address " << address << std::endl;
+            return false;
+        }
+
+        m_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_socket < 0) {
+            std::cerr << "Metrics: failed to create socket" << std::endl;
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(m_socket, reinterpret_cast<sockaddr*>(&bindAddress), sizeof(bindAddress)) < 0 ||
+            listen(m_socket, 4) < 0) {
+            std::cerr << "Metrics: cannot listen on " << address << ":" << port << std::endl;
+            close(m_socket);
+            m_socket = -1;
+            return false;
+        }
+
+        socklen_t length = sizeof(bindAddress);
+        getsockname(m_socket, reinterpret_cast<sockaddr*>(&bindAddress), &length);
+        m_port = ntohs(bindAddress.sin_port);
+
+        m_handler = std::move(handler);
+        m_running = true;
+        m_thread = std::thread(&MetricsServer::ServeLoop, this);
+        std::cout << "Metrics available at http://" << address << ":" << m_port << "/metrics" << std::endl;
+        return true;
+    }
+
+    void MetricsServer::Stop() {
+        if (!m_running) return;
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        close(m_socket);
+        m_socket = -1;
+    }
+
+    void MetricsServer::ServeLoop() {
+        while (m_running) {
+            // Wake up now and then to notice Stop
+            pollfd listener = {m_socket, POLLIN, 0};
+            if (poll(&listener, 1, 200) <= 0) continue;
+
+            int connection = accept(m_socket, nullptr, nullptr);
+            if (connection < 0) continue;
+            ServeConnection(connection);
+            close(connection);
+        }
+    }
+
+    void MetricsServer::ServeConnection(int connection) {
+        // A scraper that stalls must not hold up the next one for long
+        timeval timeout = {1, 0};
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestSize) {
+            ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+            if (received <= 0) return;
+            request.append(buffer, static_cast<size_t>(received));
+        }
+
+        // Request line: method, path (query ignored), version
+        std::istringstream line(request.substr(0, request.find("\r\n")));
+        std::string method, target;
+        line >> method >> target;
+        std::string path = target.substr(0, target.find('?'));
+
+        if (method != "GET") {
+            SendAll(connection, Response("405 Method Not Allowed", "text/plain", "GET only\n"));
+        } else if (path == "/metrics") {
+            SendAll(connection, Response("200 OK", "text/plain; version=0.0.4; charset=utf-8", m_handler()));
+        } else {
+            SendAll(connection, Response("404 Not Found", "text/plain", "Metrics are at /metrics\n"));
+        }
+    }
+#endif
+
+} // namespace SplashTop
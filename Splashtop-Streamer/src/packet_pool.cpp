@@ -0,0 +1,65 @@
+#include "packet_pool.h"
+
+namespace SplashTop {
+
+    namespace {
+        // See FramePool: the acquire fence orders the last consumer's reads
+        // of the bitstream before the encoder overwrites it
+        bool IsFree(const std::shared_ptr<EncodedPacket>& packet) {
+            if (packet.use_count() != 1) return false;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+    }
+
+    PacketPool::PacketPool(size_t maxPackets) : m_maxPackets(maxPackets), m_next(0) {
+        m_packets.reserve(maxPackets);
+    }
+
+    std::shared_ptr<EncodedPacket> PacketPool::Acquire() {
+        for (size_t i = 0; i < m_packets.size(); i++) {
+            size_t index = (m_next + i) % m_packets.size();
+            if (IsFree(m_packets[index])) {
+                m_next = index + 1;
+                return m_packets[index];
+            }
+        }
+
+        if (m_packets.size() >= m_maxPackets) {
+            return nullptr;
+        }
+        m_packets.push_back(std::make_shared<EncodedPacket>());
+        m_next = m_packets.size();
+        return m_packets.back();
+    }
+
+    std::shared_ptr<EncodedPacket> PacketPool::Acquire(std::chrono::microseconds timeout) {
+        std::shared_ptr<EncodedPacket> packet = Acquire();
+        if (packet) return packet;
+
+        // Same handshake as StageQueue: a release either happens before our
+        // check under the lock, or sees the waiter and notifies
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_released.wait_for(lock, timeout, [&] { return (packet = Acquire()) != nullptr; });
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        return packet;
+    }
+
+    void PacketPool::NotifyReleased() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+        m_released.notify_one();
+    }
+
+    size_t PacketPool::GetFreePackets() const {
+        size_t count = 0;
+        for (const auto& packet : m_packets) {
+            if (packet.use_count() == 1) count++;
+        }
+        return count;
+    }
+
+} // namespace SplashTop
@@ -0,0 +1,349 @@
+#include "pixel_convert.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SPLASHTOP_X86_SIMD 1
+    #include <immintrin.h>
+#endif
+
+namespace SplashTop {
+
+    namespace {
+
+        // Position and width of one color channel inside a packed pixel
+        struct ChannelInfo {
+            uint32 shift;
+            uint32 bits;
+        };
+
+        ChannelInfo GetChannelInfo(uint32 mask) {
+            ChannelInfo info = {0, 0};
+            if (mask == 0) return info;
+            while (!(mask & 1)) {
+                mask >>= 1;
+                info.shift++;
+            }
+            while (mask & 1) {
+                mask >>= 1;
+                info.bits++;
+            }
+            return info;
+        }
+
+        struct LayoutInfo {
+            ChannelInfo red;
+            ChannelInfo green;
+            ChannelInfo blue;
+            uint32 bytesPerPixel;
+        };
+
+        LayoutInfo GetLayoutInfo(const PixelLayout& layout) {
+            LayoutInfo info;
+            info.red = GetChannelInfo(layout.redMask);
+            info.green = GetChannelInfo(layout.greenMask);
+            info.blue = GetChannelInfo(layout.blueMask);
+            info.bytesPerPixel = layout.bitsPerPixel / 8;
+            return info;
+        }
+
+        // Scale an n-bit channel value to 8 bits by replicating its high bits
+        inline uint8 ExpandChannel(uint32 value, uint32 bits) {
+            if (bits == 0) return 0;
+            if (bits >= 8) return static_cast<uint8>(value >> (bits - 8));
+
+            int pos = 8 - static_cast<int>(bits);
+            uint32 result = value << pos;
+            while (pos > 0) {
+                pos -= static_cast<int>(bits);
+                result |= pos >= 0 ? (value << pos) : (value >> -pos);
+            }
+            return static_cast<uint8>(result);
+        }
+
+        inline uint8 ExtractChannel(uint32 pixel, const ChannelInfo& channel) {
+            uint32 value = (pixel >> channel.shift) & ((1u << channel.bits) - 1);
+            return ExpandChannel(value, channel.bits);
+        }
+
+        inline uint32 ReadPixel(const uint8* p, uint32 bytesPerPixel, bool msbFirst) {
+            uint32 pixel = 0;
+            if (msbFirst) {
+                for (uint32 i = 0; i < bytesPerPixel; i++) pixel = (pixel << 8) | p[i];
+            } else {
+                for (uint32 i = 0; i < bytesPerPixel; i++) pixel |= static_cast<uint32>(p[i]) << (8 * i);
+            }
+            return pixel;
+        }
+
+        // Scalar reference kernel, handles every layout
+        void ConvertRowScalar(const uint8* src, uint8* dst, uint32 width,
+                              const LayoutInfo& info, bool msbFirst) {
+            for (uint32 x = 0; x < width; x++) {
+                uint32 pixel = ReadPixel(src + x * info.bytesPerPixel, info.bytesPerPixel, msbFirst);
+                dst[x * 4] = ExtractChannel(pixel, info.blue);
+                dst[x * 4 + 1] = ExtractChannel(pixel, info.green);
+                dst[x * 4 + 2] = ExtractChannel(pixel, info.red);
+                dst[x * 4 + 3] = 0xFF;
+            }
+        }
+
+        bool IsSupportedLayout(const PixelLayout& layout) {
+            return layout.bitsPerPixel == 16 || layout.bitsPerPixel == 24 || layout.bitsPerPixel == 32;
+        }
+
+        // 32bpp SIMD paths need whole-byte channels
+        bool Is32bppSimdLayout(const PixelLayout& layout, const LayoutInfo& info) {
+            return layout.bitsPerPixel == 32 && !layout.msbFirst &&
+                   info.red.bits == 8 && info.green.bits == 8 && info.blue.bits == 8;
+        }
+
+        // 16bpp SIMD paths expand channels of 4 to 8 bits (565, 555, 444)
+        bool Is16bppSimdLayout(const PixelLayout& layout, const LayoutInfo& info) {
+            auto ok = [](const ChannelInfo& c) { return c.bits >= 4 && c.bits <= 8; };
+            return layout.bitsPerPixel == 16 && !layout.msbFirst &&
+                   ok(info.red) && ok(info.green) && ok(info.blue);
+        }
+
+        // 24bpp SIMD path shuffles bytes, so channels must be byte aligned
+        bool Is24bppSimdLayout(const PixelLayout& layout, const LayoutInfo& info) {
+            auto ok = [](const ChannelInfo& c) { return c.bits == 8 && c.shift % 8 == 0 && c.shift < 24; };
+            return layout.bitsPerPixel == 24 && !layout.msbFirst &&
+                   ok(info.red) && ok(info.green) && ok(info.blue);
+        }
+
+#ifdef SPLASHTOP_X86_SIMD
+
+        bool CpuHasSSE2() {
+#if defined(__x86_64__)
+            return true;
+#else
+            static const bool hasSSE2 = __builtin_cpu_supports("sse2");
+            return hasSSE2;
+#endif
+        }
+
+        bool CpuHasAVX2() {
+            static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+            return hasAVX2;
+        }
+
+        __attribute__((target("sse2")))
+        void ConvertRow32SSE2(const uint8* src, uint8* dst, uint32 width, const LayoutInfo& info) {
+            const __m128i byteMask = _mm_set1_epi32(0xFF);
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+            const __m128i redShift = _mm_cvtsi32_si128(static_cast<int>(info.red.shift));
+            const __m128i greenShift = _mm_cvtsi32_si128(static_cast<int>(info.green.shift));
+            const __m128i blueShift = _mm_cvtsi32_si128(static_cast<int>(info.blue.shift));
+
+            uint32 x = 0;
+            for (; x + 4 <= width; x += 4) {
+                __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+                __m128i r = _mm_and_si128(_mm_srl_epi32(p, redShift), byteMask);
+                __m128i g = _mm_and_si128(_mm_srl_epi32(p, greenShift), byteMask);
+                __m128i b = _mm_and_si128(_mm_srl_epi32(p, blueShift), byteMask);
+                __m128i out = _mm_or_si128(_mm_or_si128(b, _mm_slli_epi32(g, 8)),
+                                           _mm_or_si128(_mm_slli_epi32(r, 16), alpha));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), out);
+            }
+            ConvertRowScalar(src + x * 4, dst + x * 4, width - x, info, false);
+        }
+
+        __attribute__((target("avx2")))
+        void ConvertRow32AVX2(const uint8* src, uint8* dst, uint32 width, const LayoutInfo& info) {
+            const __m256i byteMask = _mm256_set1_epi32(0xFF);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+            const __m128i redShift = _mm_cvtsi32_si128(static_cast<int>(info.red.shift));
+            const __m128i greenShift = _mm_cvtsi32_si128(static_cast<int>(info.green.shift));
+            const __m128i blueShift = _mm_cvtsi32_si128(static_cast<int>(info.blue.shift));
+
+            uint32 x = 0;
+            for (; x + 8 <= width; x += 8) {
+                __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+                __m256i r = _mm256_and_si256(_mm256_srl_epi32(p, redShift), byteMask);
+                __m256i g = _mm256_and_si256(_mm256_srl_epi32(p, greenShift), byteMask);
+                __m256i b = _mm256_and_si256(_mm256_srl_epi32(p, blueShift), byteMask);
+                __m256i out = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)),
+                                              _mm256_or_si256(_mm256_slli_epi32(r, 16), alpha));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), out);
+            }
+            ConvertRowScalar(src + x * 4, dst + x * 4, width - x, info, false);
+        }
+
+        // Expand one channel of eight 16-bit pixels to 8 bits per lane
+        __attribute__((target("sse2")))
+        inline __m128i Expand16SSE2(__m128i p, const ChannelInfo& c) {
+            __m128i value = _mm_and_si128(_mm_srl_epi16(p, _mm_cvtsi32_si128(static_cast<int>(c.shift))),
+                                          _mm_set1_epi16(static_cast<short>((1 << c.bits) - 1)));
+            return _mm_or_si128(_mm_sll_epi16(value, _mm_cvtsi32_si128(static_cast<int>(8 - c.bits))),
+                                _mm_srl_epi16(value, _mm_cvtsi32_si128(static_cast<int>(2 * c.bits - 8))));
+        }
+
+        __attribute__((target("sse2")))
+        void ConvertRow16SSE2(const uint8* src, uint8* dst, uint32 width, const LayoutInfo& info) {
+            const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+            uint32 x = 0;
+            for (; x + 8 <= width; x += 8) {
+                __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+                __m128i r = Expand16SSE2(p, info.red);
+                __m128i g = Expand16SSE2(p, info.green);
+                __m128i b = Expand16SSE2(p, info.blue);
+                __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+                __m128i ra = _mm_or_si128(r, alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi16(bg, ra));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+            }
+            ConvertRowScalar(src + x * 2, dst + x * 4, width - x, info, false);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i Expand16AVX2(__m256i p, const ChannelInfo& c) {
+            __m256i value = _mm256_and_si256(_mm256_srl_epi16(p, _mm_cvtsi32_si128(static_cast<int>(c.shift))),
+                                             _mm256_set1_epi16(static_cast<short>((1 << c.bits) - 1)));
+            return _mm256_or_si256(_mm256_sll_epi16(value, _mm_cvtsi32_si128(static_cast<int>(8 - c.bits))),
+                                   _mm256_srl_epi16(value, _mm_cvtsi32_si128(static_cast<int>(2 * c.bits - 8))));
+        }
+
+        __attribute__((target("avx2")))
+        void ConvertRow16AVX2(const uint8* src, uint8* dst, uint32 width, const LayoutInfo& info) {
+            const __m256i alpha = _mm256_set1_epi16(static_cast<short>(0xFF00));
+
+            uint32 x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 2));
+                __m256i r = Expand16AVX2(p, info.red);
+                __m256i g = Expand16AVX2(p, info.green);
+                __m256i b = Expand16AVX2(p, info.blue);
+                __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+                __m256i ra = _mm256_or_si256(r, alpha);
+                // Unpack works per 128-bit lane, so restore pixel order afterwards
+                __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+                __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+            ConvertRowScalar(src + x * 2, dst + x * 4, width - x, info, false);
+        }
+
+        __attribute__((target("avx2")))
+        void ConvertRow24AVX2(const uint8* src, uint8* dst, uint32 width, const LayoutInfo& info) {
+            // Each lane turns 12 packed bytes (4 pixels) into 4 BGRA pixels
+            alignas(32) int8 shuffle[32];
+            for (int lane = 0; lane < 2; lane++) {
+                for (int j = 0; j < 4; j++) {
+                    int8* out = shuffle + lane * 16 + j * 4;
+                    out[0] = static_cast<int8>(j * 3 + info.blue.shift / 8);
+                    out[1] = static_cast<int8>(j * 3 + info.green.shift / 8);
+                    out[2] = static_cast<int8>(j * 3 + info.red.shift / 8);
+                    out[3] = -128; // zero, alpha is OR'ed in below
+                }
+            }
+            const __m256i shuffleMask = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffle));
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+            // The second lane reads 16 bytes at offset 12, so keep 28 bytes in the row
+            uint32 x = 0;
+            for (; x + 10 <= width; x += 8) {
+                const uint8* p = src + x * 3;
+                __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12));
+                __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+                __m256i out = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffleMask), alpha);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), out);
+            }
+            ConvertRowScalar(src + x * 3, dst + x * 4, width - x, info, false);
+        }
+
+#endif // SPLASHTOP_X86_SIMD
+
+        using RowConverter = void (*)(const uint8*, uint8*, uint32, const LayoutInfo&);
+
+        RowConverter GetRowConverter(PixelKernel kernel, const PixelLayout& layout, const LayoutInfo& info) {
+#ifdef SPLASHTOP_X86_SIMD
+            if (kernel == PixelKernel::AVX2 && CpuHasAVX2()) {
+                if (Is32bppSimdLayout(layout, info)) return ConvertRow32AVX2;
+                if (Is16bppSimdLayout(layout, info)) return ConvertRow16AVX2;
+                if (Is24bppSimdLayout(layout, info)) return ConvertRow24AVX2;
+            }
+            if (kernel == PixelKernel::SSE2 && CpuHasSSE2()) {
+                if (Is32bppSimdLayout(layout, info)) return ConvertRow32SSE2;
+                if (Is16bppSimdLayout(layout, info)) return ConvertRow16SSE2;
+            }
+#else
+            (void)kernel; (void)layout; (void)info;
+#endif
+            return nullptr;
+        }
+
+        void ConvertBlock(RowConverter converter, const uint8* src, uint32 srcStride, const PixelLayout& layout,
+                          const LayoutInfo& info, uint8* dst, uint32 dstStride, uint32 width, uint32 height) {
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* srcRow = src + static_cast<size_t>(y) * srcStride;
+                uint8* dstRow = dst + static_cast<size_t>(y) * dstStride;
+                if (converter) {
+                    converter(srcRow, dstRow, width, info);
+                } else {
+                    ConvertRowScalar(srcRow, dstRow, width, info, layout.msbFirst);
+                }
+            }
+        }
+
+    } // namespace
+
+    void ConvertToBGRA(const uint8* src, uint32 srcStride, const PixelLayout& layout,
+                       uint8* dst, uint32 dstStride, uint32 width, uint32 height) {
+        if (!IsSupportedLayout(layout)) return;
+
+        LayoutInfo info = GetLayoutInfo(layout);
+        RowConverter converter = GetRowConverter(PixelKernel::AVX2, layout, info);
+        if (!converter) converter = GetRowConverter(PixelKernel::SSE2, layout, info);
+        ConvertBlock(converter, src, srcStride, layout, info, dst, dstStride, width, height);
+    }
+
+    bool ConvertToBGRAWithKernel(PixelKernel kernel, const uint8* src, uint32 srcStride,
+                                 const PixelLayout& layout, uint8* dst, uint32 dstStride,
+                                 uint32 width, uint32 height) {
+        if (!IsPixelKernelSupported(kernel, layout)) return false;
+
+        LayoutInfo info = GetLayoutInfo(layout);
+        RowConverter converter = kernel == PixelKernel::Scalar ? nullptr : GetRowConverter(kernel, layout, info);
+        ConvertBlock(converter, src, srcStride, layout, info, dst, dstStride, width, height);
+        return true;
+    }
+
+    bool IsPixelKernelSupported(PixelKernel kernel, const PixelLayout& layout) {
+        if (!IsSupportedLayout(layout)) return false;
+        if (kernel == PixelKernel::Scalar) return true;
+
+        LayoutInfo info = GetLayoutInfo(layout);
+        return GetRowConverter(kernel, layout, info) != nullptr;
+    }
+
+    bool IsPixelKernelAvailable(PixelKernel kernel) {
+        switch (kernel) {
+            case PixelKernel::Scalar: return true;
+#ifdef SPLASHTOP_X86_SIMD
+            case PixelKernel::SSE2: return CpuHasSSE2();
+            case PixelKernel::AVX2: return CpuHasAVX2();
+#endif
+            default: return false;
+        }
+    }
+
+    PixelKernel GetBestPixelKernel() {
+#ifdef SPLASHTOP_X86_SIMD
+        if (CpuHasAVX2()) return PixelKernel::AVX2;
+        if (CpuHasSSE2()) return PixelKernel::SSE2;
+#endif
+        return PixelKernel::Scalar;
+    }
+
+    const char* GetPixelKernelName(PixelKernel kernel) {
+        switch (kernel) {
+            case PixelKernel::Scalar: return "scalar";
+            case PixelKernel::SSE2: return "sse2";
+            case PixelKernel::AVX2: return "avx2";
+        }
+        return "unknown";
+    }
+
+} // namespace SplashTop
@@ -0,0 +1,85 @@
+#include "roi_tracker.h"
+
+namespace SplashTop {
+
+    namespace {
+
+        // Intersect a rectangle with the frame; false if nothing is left
+        bool ClipToFrame(int64 x0, int64 y0, int64 x1, int64 y1, const VideoFrame& frame, Rect& out) {
+            x0 = std::max<int64>(x0, 0);
+            y0 = std::max<int64>(y0, 0);
+            x1 = std::min<int64>(x1, frame.width);
+            y1 = std::min<int64>(y1, frame.height);
+            if (x0 >= x1 || y0 >= y1) return false;
+            out = {static_cast<int32>(x0), static_cast<int32>(y0),
+                   static_cast<uint32>(x1 - x0), static_cast<uint32>(y1 - y0)};
+            return true;
+        }
+
+    } // namespace
+
+    RegionOfInterestTracker::RegionOfInterestTracker(const RoiSettings& settings) {
+        SetSettings(settings);
+    }
+
+    void RegionOfInterestTracker::SetSettings(const RoiSettings& settings) {
+        m_settings = settings;
+        m_damage.clear();
+        m_damage.reserve(settings.maxRegions);
+    }
+
+    void RegionOfInterestTracker::OnPointerMoved(int32 x, int32 y, std::chrono::steady_clock::time_point now) {
+        m_pointer.store(static_cast<uint32>(x) | (static_cast<uint64>(static_cast<uint32>(y)) << 32),
+                        std::memory_order_relaxed);
+        m_pointerTime.store(now.time_since_epoch().count(), std::memory_order_release);
+    }
+
+    uint32 RegionOfInterestTracker::Apply(VideoFrame& frame, std::chrono::steady_clock::time_point now) {
+        frame.regionsOfInterest.clear();
+        if (m_settings.maxRegions == 0) return 0;
+
+        // Square around the pointer while it is in use
+        int64 pointerTime = m_pointerTime.load(std::memory_order_acquire);
+        if (pointerTime != 0) {
+            std::chrono::steady_clock::time_point moved{std::chrono::steady_clock::duration(pointerTime)};
+            if (now - moved <= std::chrono::milliseconds(m_settings.pointerHoldMs)) {
+                uint64 pointer = m_pointer.load(std::memory_order_relaxed);
+                int64 x = static_cast<int32>(pointer & 0xFFFFFFFF);
+                int64 y = static_cast<int32>(pointer >> 32);
+                int64 r = m_settings.pointerRadius;
+                Rect rect;
+                if (ClipToFrame(x - r, y - r, x + r, y + r, frame, rect)) {
+                    frame.regionsOfInterest.push_back({rect, m_settings.pointerQpOffset});
+                }
+            }
+        }
+
+        // Forget expired damage, then remember this frame's, dropping the
+        // oldest when over the limit
+        const size_t maxDamage = m_settings.maxRegions - 1;
+        m_damage.erase(std::remove_if(m_damage.begin(), m_damage.end(),
+                                      [now](const DamagedRect& damaged) { return damaged.expires <= now; }),
+                       m_damage.end());
+
+        const uint64 frameArea = static_cast<uint64>(frame.width) * frame.height;
+        if (frame.hasDamageInfo && maxDamage > 0) {
+            for (const Rect& damaged : frame.dirtyRects) {
+                if (static_cast<uint64>(damaged.width) * damaged.height * 4 > frameArea) continue;
+
+                Rect rect;
+                if (!ClipToFrame(damaged.x, damaged.y, static_cast<int64>(damaged.x) + damaged.width,
+                                 static_cast<int64>(damaged.y) + damaged.height, frame, rect)) {
+                    continue;
+                }
+                if (m_damage.size() >= maxDamage) m_damage.erase(m_damage.begin());
+                m_damage.push_back({rect, now + std::chrono::milliseconds(m_settings.damageHoldMs)});
+            }
+        }
+
+        for (const DamagedRect& damaged : m_damage) {
+            frame.regionsOfInterest.push_back({damaged.rect, m_settings.damageQpOffset});
+        }
+        return static_cast<uint32>(frame.regionsOfInterest.size());
+    }
+
+} // namespace SplashTop
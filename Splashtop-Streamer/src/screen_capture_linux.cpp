@@ -1,32 +1,110 @@
 #include "screen_capture.h"
 #include "platform.h"
+#include "pixel_convert.h"
+#include "tile_change_detector.h"
+#include "frame_pool.h"
+#include "frame_mailbox.h"
+#include "yuv_convert.h"
+#include "frame_scheduler.h"
+#include "frame_trace.h"
+#include "stats.h"
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/Xrandr.h>
 #include <X11/extensions/Xfixes.h>
 #include <X11/extensions/Xinerama.h>
+#include <X11/extensions/XShm.h>
+#include <X11/extensions/Xdamage.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <cstring>
 #include <iostream>
 
 namespace SplashTop {
 
+namespace {
+    // Set by ShmErrorHandler when XShmAttach is rejected (e.g. remote display)
+    bool g_shmAttachFailed = false;
+
+    int ShmErrorHandler(Display* display, XErrorEvent* event) {
+        (void)display; (void)event;
+        g_shmAttachFailed = true;
+        return 0;
+    }
+}
+
 class LinuxScreenCapture : public IScreenCapture {
 private:
+    static constexpr size_t kMaxPendingRects = 256;
+
     Display* display;
     Window root;
     XRRScreenResources* resources;
     XRROutputInfo* outputInfo;
     int screen;
     int width, height;
-    std::vector<uint8> frameBuffer;
+    std::vector<uint8> frameBuffer; // Capture thread's working copy of the screen, in the output format
+
+    // Output frames: BGRA at screen size, or YUV420 converted straight from
+    // the captured image and optionally halved (scale 2) in the same pass
+    uint32 outputFormat;
+    uint32 scale;
+    uint32 frameWidth, frameHeight, frameStride;
+    std::unique_ptr<YuvConverter> yuvConverter;
+    std::vector<uint8> stagingBuffer; // BGRA copy of visuals the YUV kernels cannot read
     std::atomic<bool> running;
     std::thread captureThread;
-    std::mutex frameMutex;
+    std::atomic<uint32> targetFps;
+    FrameScheduler scheduler; // Capture thread only, apart from its stats
+    uint64 tickStartMicros;   // When the current capture tick began
+
+    // MIT-SHM backend: the server writes each frame straight into shmImage
+    XImage* shmImage;
+    XShmSegmentInfo shmInfo;
+    bool useShm;
+
+    // XDamage: only fetch what the server reports as changed
+    Damage damage;
+    XserverRegion damageRegion;
+    bool useDamage;
+    bool needFullCapture;
+
+    // Tile hashing confirms which tiles really changed (and is the only
+    // change detection on servers without XDamage)
+    TileChangeDetector tileDetector;
+    VideoFrame detectView;
+    DirtyTileMap capturedTiles;
 
+    // Published frames come from the pool and are never written again while
+    // a consumer holds them. Recycled frames are refreshed from frameBuffer by
+    // copying the tiles modified since their contentGeneration.
+    FramePool framePool;
+    uint64 captureGeneration;
+    std::vector<uint64> tileGeneration;
+
+    // Changes not yet carried by a published frame
+    std::vector<Rect> unpublishedDamage;
+    DirtyTileMap unpublishedTiles;
+
+    // Changes since the last frame the consumer took
+    std::vector<Rect> pendingDamage;
+    DirtyTileMap pendingTiles;
+
+    // Hand-off to the consumer: capture never waits on GetLatestFrame
+    LatestValueMailbox<std::shared_ptr<PooledFrame>> mailbox;
+
+    ThroughputMeter published; // Frames handed to the mailbox
 
 public:
     LinuxScreenCapture() : display(nullptr), root(0), resources(nullptr), 
-                          outputInfo(nullptr), screen(0), width(0), height(0), running(false) {}
+                          outputInfo(nullptr), screen(0), width(0), height(0),
+                          outputFormat(0), scale(1), frameWidth(0), frameHeight(0), frameStride(0), running(false), targetFps(30), tickStartMicros(0),
+                          shmImage(nullptr), shmInfo(), useShm(false),
+                          damage(0), damageRegion(0), useDamage(false), needFullCapture(true),
+                          framePool(8), captureGeneration(0) {
+        shmInfo.shmid = -1;
+        shmInfo.shmaddr = reinterpret_cast<char*>(-1);
+    }
 
     ~LinuxScreenCapture() {
         StopCapture();
@@ -49,8 +127,12 @@ public:
 
         std::cout << "Screen dimensions: " << width << "x" << height << std::endl;
 
-        // Allocate frame buffer (BGRA format)
-        frameBuffer.resize(width * height * 4);
+        // Allocate the frame buffer in the output format
+        ConfigureOutput();
+
+        // Prefer the shared memory path, fall back to XGetImage when unavailable
+        useShm = InitializeShm();
+        useDamage = InitializeDamage();
 
         return true;
     }
@@ -61,6 +143,8 @@ public:
             return false;
         }
 
+        needFullCapture = true;
+        scheduler.Reset();
         running = true;
         captureThread = std::thread(&LinuxScreenCapture::CaptureLoop, this);
         
@@ -73,20 +157,14 @@ public:
         if (captureThread.joinable()) {
             captureThread.join();
         }
-        std::cout << "Screen capture stopped" << std::endl;
+        FrameTimingStats timing = scheduler.GetStats();
+        std::cout << "Screen capture stopped (" << timing.missed << " of " << timing.ticks + timing.missed
+                  << " ticks missed, interval jitter p99 " << timing.jitterP99Micros << " us)" << std::endl;
     }
 
     std::shared_ptr<VideoFrame> GetLatestFrame() override {
-        std::lock_guard<std::mutex> lock(frameMutex);
-        auto frame = std::make_shared<VideoFrame>();
-        frame->data = frameBuffer.data();
-        frame->width = width;
-        frame->height = height;
-        frame->stride = width * 4;
-        frame->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::steady_clock::now().time_since_epoch()).count();
-        frame->format = 0; // BGRA
-        return frame;
+        mailbox.Fetch();
+        return mailbox.Front();
     }
 
     std::vector<std::pair<uint32, uint32>> GetMonitorResolutions() override {
@@ -95,6 +173,25 @@ public:
         return resolutions;
     }
 
+    bool SetOutputFormat(uint32 format, bool halfSize) override {
+        if (running) {
+            std::cerr << "Output format must be set before capture starts" << std::endl;
+            return false;
+        }
+        // Halving is part of the YUV conversion
+        if (format != 2 && (format != 0 || halfSize)) return false;
+
+        outputFormat = format;
+        scale = halfSize ? 2 : 1;
+        if (display) ConfigureOutput();
+        return true;
+    }
+
+    bool SetFrameRate(uint32 fps) override {
+        targetFps = std::max<uint32>(fps, 1);
+        return true;
+    }
+
     void SetCaptureRegion(uint32 x, uint32 y, uint32 w, uint32 h) override {
         // For now, capture full screen
         (void)x; (void)y; (void)w; (void)h;
@@ -102,8 +199,10 @@ public:
 
     CaptureStats GetStats() override {
         CaptureStats stats = {};
-        stats.framesCaptured = 0; // TODO: implement counter
-        stats.averageFPS = 30.0;
+        stats.framesCaptured = published.GetItems();
+        stats.totalBytes = published.GetBytes();
+        stats.averageFPS = published.GetRates().itemsPerSecond;
+        stats.lastFrameTime = published.GetLastMillis();
         return stats;
     }
 
@@ -111,46 +210,449 @@ public:
         return false; // Software capture for now
     }
 
+    std::string GetBackendName() const override {
+        std::string name = useShm ? "X11 MIT-SHM" : "X11 XGetImage";
+        if (useDamage) name += " + XDamage";
+        if (outputFormat == 2) name += scale == 2 ? ", YUV420 at half size" : ", YUV420";
+        return name;
+    }
+
 private:
+    // Size frameBuffer for the output format and forget everything captured
+    // so far, which was in the old format
+    void ConfigureOutput() {
+        frameWidth = (width + scale - 1) / scale;
+        frameHeight = (height + scale - 1) / scale;
+        if (outputFormat == 2) {
+            // Whole 32-bit words per chroma row, so tiles can be hashed
+            frameStride = (frameWidth + 7) & ~7u;
+            frameBuffer.assign(VideoFrame::GetYuv420Size(frameStride, frameHeight), 0);
+            if (!yuvConverter) yuvConverter = std::make_unique<YuvConverter>();
+            yuvConverter->SetHalfSize(scale == 2);
+        } else {
+            frameStride = frameWidth * 4;
+            frameBuffer.assign(static_cast<size_t>(frameStride) * frameHeight, 0);
+            yuvConverter.reset();
+        }
+
+        detectView.data = frameBuffer.data();
+        detectView.width = frameWidth;
+        detectView.height = frameHeight;
+        detectView.stride = frameStride;
+        detectView.format = outputFormat;
+
+        tileDetector.Reset();
+        framePool = FramePool(8);
+        unpublishedTiles = DirtyTileMap();
+        pendingTiles = DirtyTileMap();
+        unpublishedDamage.clear();
+        pendingDamage.clear();
+        needFullCapture = true;
+    }
+
+    // YUV output is converted in whole chroma blocks (2x2 output pixels), so
+    // a partial capture is widened to block boundaries on the screen
+    Rect AlignToChromaBlocks(const Rect& rect) const {
+        if (outputFormat != 2) return rect;
+        const int32 block = static_cast<int32>(scale * 2);
+        int32 x0 = rect.x / block * block;
+        int32 y0 = rect.y / block * block;
+        int32 x1 = std::min<int32>((rect.x + static_cast<int32>(rect.width) + block - 1) / block * block, width);
+        int32 y1 = std::min<int32>((rect.y + static_cast<int32>(rect.height) + block - 1) / block * block, height);
+        return {x0, y0, static_cast<uint32>(x1 - x0), static_cast<uint32>(y1 - y0)};
+    }
+
+    // Screen rectangle in output frame coordinates
+    Rect ToFrameRect(const Rect& rect) const {
+        if (scale == 1) return rect;
+        int32 x0 = rect.x / static_cast<int32>(scale);
+        int32 y0 = rect.y / static_cast<int32>(scale);
+        uint32 x1 = (rect.x + rect.width + scale - 1) / scale;
+        uint32 y1 = (rect.y + rect.height + scale - 1) / scale;
+        return {x0, y0, x1 - x0, y1 - y0};
+    }
+
+    bool InitializeShm() {
+        if (!XShmQueryExtension(display)) {
+            std::cout << "MIT-SHM extension not available" << std::endl;
+            return false;
+        }
+
+        shmImage = XShmCreateImage(display, DefaultVisual(display, screen), DefaultDepth(display, screen),
+                                   ZPixmap, nullptr, &shmInfo, width, height);
+        if (!shmImage) {
+            std::cerr << "XShmCreateImage failed" << std::endl;
+            return false;
+        }
+
+        shmInfo.shmid = shmget(IPC_PRIVATE, shmImage->bytes_per_line * shmImage->height, IPC_CREAT | 0600);
+        if (shmInfo.shmid < 0) {
+            std::cerr << "shmget failed" << std::endl;
+            CleanupShm();
+            return false;
+        }
+
+        shmInfo.shmaddr = static_cast<char*>(shmat(shmInfo.shmid, nullptr, 0));
+        if (shmInfo.shmaddr == reinterpret_cast<char*>(-1)) {
+            std::cerr << "shmat failed" << std::endl;
+            CleanupShm();
+            return false;
+        }
+        shmImage->data = shmInfo.shmaddr;
+        shmInfo.readOnly = False;
+
+        // XShmAttach only reports failure asynchronously, so trap errors around a sync
+        g_shmAttachFailed = false;
+        XErrorHandler previousHandler = XSetErrorHandler(ShmErrorHandler);
+        Status attached = XShmAttach(display, &shmInfo);
+        XSync(display, False);
+        XSetErrorHandler(previousHandler);
+
+        // Mark for removal now so the segment is released even if we crash
+        shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+
+        if (!attached || g_shmAttachFailed) {
+            std::cout << "XShmAttach failed, display is probably remote" << std::endl;
+            shmInfo.shmid = -1;
+            CleanupShm();
+            return false;
+        }
+
+        return true;
+    }
+
+    void CleanupShm() {
+        if (useShm) {
+            XShmDetach(display, &shmInfo);
+            useShm = false;
+        }
+        if (shmImage) {
+            XDestroyImage(shmImage); // does not free the shared segment
+            shmImage = nullptr;
+        }
+        if (shmInfo.shmaddr != reinterpret_cast<char*>(-1)) {
+            shmdt(shmInfo.shmaddr);
+            shmInfo.shmaddr = reinterpret_cast<char*>(-1);
+        }
+        if (shmInfo.shmid >= 0) {
+            shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+            shmInfo.shmid = -1;
+        }
+    }
+
+    bool InitializeDamage() {
+        int eventBase, errorBase;
+        if (!XDamageQueryExtension(display, &eventBase, &errorBase) ||
+            !XFixesQueryExtension(display, &eventBase, &errorBase)) {
+            std::cout << "XDamage extension not available" << std::endl;
+            return false;
+        }
+
+        int major = 1, minor = 1;
+        XDamageQueryVersion(display, &major, &minor);
+        major = 2; minor = 0;
+        XFixesQueryVersion(display, &major, &minor);
+
+        damage = XDamageCreate(display, root, XDamageReportNonEmpty);
+        damageRegion = XFixesCreateRegion(display, nullptr, 0);
+        return damage != 0 && damageRegion != 0;
+    }
+
+    void CleanupDamage() {
+        if (damage) {
+            XDamageDestroy(display, damage);
+            damage = 0;
+        }
+        if (damageRegion) {
+            XFixesDestroyRegion(display, damageRegion);
+            damageRegion = 0;
+        }
+        useDamage = false;
+    }
+
+    // Collect the rectangles damaged since the last call and reset the damage
+    void FetchDamage(std::vector<Rect>& rects) {
+        // Drain DamageNotify events so the queue does not grow
+        while (XPending(display)) {
+            XEvent event;
+            XNextEvent(display, &event);
+        }
+
+        XDamageSubtract(display, damage, None, damageRegion);
+
+        int count = 0;
+        XRectangle* area = XFixesFetchRegion(display, damageRegion, &count);
+        for (int i = 0; i < count; i++) {
+            int x0 = std::max<int>(area[i].x, 0);
+            int y0 = std::max<int>(area[i].y, 0);
+            int x1 = std::min<int>(area[i].x + area[i].width, width);
+            int y1 = std::min<int>(area[i].y + area[i].height, height);
+            if (x1 > x0 && y1 > y0) {
+                rects.push_back({x0, y0, static_cast<uint32>(x1 - x0), static_cast<uint32>(y1 - y0)});
+            }
+        }
+        if (area) XFree(area);
+    }
+
+    // Fetch one rectangle of the root window and convert it into frameBuffer
+    bool CaptureRect(const Rect& rect) {
+        XImage* image = nullptr;
+        if (useShm) {
+            // A header sized to the rectangle, backed by the attached segment
+            image = XShmCreateImage(display, DefaultVisual(display, screen), DefaultDepth(display, screen),
+                                    ZPixmap, shmInfo.shmaddr, &shmInfo, rect.width, rect.height);
+            if (image && !XShmGetImage(display, root, image, rect.x, rect.y, AllPlanes)) {
+                XDestroyImage(image);
+                image = nullptr;
+            }
+        } else {
+            image = XGetImage(display, root, rect.x, rect.y, rect.width, rect.height, AllPlanes, ZPixmap);
+        }
+
+        if (!image) return false;
+
+        ConvertImage(image, rect.x, rect.y);
+        XDestroyImage(image);
+        return true;
+    }
+
+    bool CaptureFullFrame() {
+        XImage* image = nullptr;
+        if (useShm) {
+            if (XShmGetImage(display, root, shmImage, 0, 0, AllPlanes)) {
+                image = shmImage;
+            }
+        } else {
+            image = XGetImage(display, root, 0, 0, width, height, AllPlanes, ZPixmap);
+        }
+
+        if (!image) return false;
+
+        // Convert XImage to our format
+        ConvertImage(image, 0, 0);
+        if (image != shmImage) {
+            XDestroyImage(image);
+        }
+        return true;
+    }
+
+    // Hash the tiles touched by this capture and publish a frame if anything
+    // changed. screenDamage is in screen coordinates.
+    void PublishChanges(const std::vector<Rect>& screenDamage) {
+        const Rect wholeFrame = {0, 0, frameWidth, frameHeight};
+        detectView.hasDamageInfo = true;
+        detectView.dirtyRects.clear();
+        for (const auto& rect : screenDamage) detectView.dirtyRects.push_back(ToFrameRect(rect));
+        const std::vector<Rect>& damaged = detectView.dirtyRects;
+        uint32 changedTiles = tileDetector.Detect(detectView, capturedTiles);
+
+        if (!unpublishedTiles.IsValid()) {
+            unpublishedTiles.Resize(frameWidth, frameHeight, tileDetector.GetTileSize());
+            tileGeneration.assign(static_cast<size_t>(capturedTiles.tilesX) * capturedTiles.tilesY, 0);
+        }
+
+        if (changedTiles > 0) {
+            captureGeneration++;
+            for (uint32 ty = 0; ty < capturedTiles.tilesY; ty++) {
+                for (uint32 tx = 0; tx < capturedTiles.tilesX; tx++) {
+                    if (capturedTiles.IsDirty(tx, ty)) {
+                        tileGeneration[static_cast<size_t>(ty) * capturedTiles.tilesX + tx] = captureGeneration;
+                    }
+                }
+            }
+            unpublishedTiles.Merge(capturedTiles);
+            unpublishedDamage.insert(unpublishedDamage.end(), damaged.begin(), damaged.end());
+            if (unpublishedDamage.size() > kMaxPendingRects) {
+                unpublishedDamage.assign(1, wholeFrame);
+            }
+        }
+
+        if (unpublishedTiles.CountDirty() == 0) return;
+
+        // All pooled frames still in use: keep the changes for the next tick
+        std::shared_ptr<PooledFrame> frame = framePool.Acquire(frameBuffer.size());
+        if (!frame) return;
+
+        SyncFrame(*frame);
+        frame->width = frameWidth;
+        frame->height = frameHeight;
+        frame->stride = frameStride;
+        frame->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        frame->format = outputFormat;
+        frame->hasDamageInfo = useDamage;
+
+        // Changes are reported relative to the last frame the consumer took.
+        // If it takes the previous frame right after this check the new frame
+        // over-reports, which is harmless.
+        if (mailbox.HasUnreadValue()) {
+            pendingTiles.Merge(unpublishedTiles);
+        } else {
+            pendingDamage.clear();
+            pendingTiles = unpublishedTiles;
+        }
+        pendingDamage.insert(pendingDamage.end(), unpublishedDamage.begin(), unpublishedDamage.end());
+        if (pendingDamage.size() > kMaxPendingRects) {
+            // Consumer is far behind, report the whole screen instead
+            pendingDamage.assign(1, wholeFrame);
+        }
+        frame->dirtyRects.assign(pendingDamage.begin(), pendingDamage.end());
+        frame->dirtyTiles = pendingTiles;
+
+        frame->sequence = mailbox.GetGeneration() + 1;
+        FrameTracer& tracer = FrameTracer::Instance();
+        tracer.BeginFrame(frame->sequence, tickStartMicros);
+        tracer.Mark(frame->sequence, TraceStage::CaptureEnd, frame->timestamp);
+        mailbox.BackSlot() = frame;
+        mailbox.Publish();
+        published.Record(frameBuffer.size());
+
+        unpublishedDamage.clear();
+        unpublishedTiles.Clear();
+    }
+
+    // Bring a pooled frame up to date with frameBuffer
+    void SyncFrame(PooledFrame& frame) {
+        if (frame.contentGeneration == 0) {
+            std::memcpy(frame.data, frameBuffer.data(), frameBuffer.size());
+            frame.contentGeneration = captureGeneration;
+            return;
+        }
+
+        const uint32 tileSize = capturedTiles.tileSize;
+        for (uint32 ty = 0; ty < capturedTiles.tilesY; ty++) {
+            for (uint32 tx = 0; tx < capturedTiles.tilesX; tx++) {
+                if (tileGeneration[static_cast<size_t>(ty) * capturedTiles.tilesX + tx] <= frame.contentGeneration) {
+                    continue;
+                }
+                uint32 x = tx * tileSize;
+                uint32 y = ty * tileSize;
+                uint32 tileWidth = std::min<uint32>(tileSize, frameWidth - x);
+                uint32 tileHeight = std::min<uint32>(tileSize, frameHeight - y);
+                if (outputFormat == 2) {
+                    // The tile's block in each plane
+                    const size_t uOffset = static_cast<size_t>(frameStride) * frameHeight;
+                    const size_t vOffset = uOffset + static_cast<size_t>(frameStride / 2) * ((frameHeight + 1) / 2);
+                    const uint32 cx = x / 2, cy = y / 2;
+                    const uint32 chromaWidth = (x + tileWidth + 1) / 2 - cx;
+                    const uint32 chromaHeight = (y + tileHeight + 1) / 2 - cy;
+                    CopyBlock(frame, 0, frameStride, x, y, tileWidth, tileHeight);
+                    CopyBlock(frame, uOffset, frameStride / 2, cx, cy, chromaWidth, chromaHeight);
+                    CopyBlock(frame, vOffset, frameStride / 2, cx, cy, chromaWidth, chromaHeight);
+                } else {
+                    CopyBlock(frame, 0, frameStride, x * 4, y, tileWidth * 4, tileHeight);
+                }
+            }
+        }
+        frame.contentGeneration = captureGeneration;
+    }
+
+    // Copy rows of bytes [x, x + bytes) of one plane of frameBuffer
+    void CopyBlock(PooledFrame& frame, size_t planeOffset, uint32 stride, uint32 x, uint32 y,
+                   uint32 bytes, uint32 rows) {
+        for (uint32 row = 0; row < rows; row++) {
+            size_t offset = planeOffset + static_cast<size_t>(y + row) * stride + x;
+            std::memcpy(frame.data + offset, frameBuffer.data() + offset, bytes);
+        }
+    }
+
     void CaptureLoop() {
+        std::vector<Rect> damaged;
+
         while (running) {
-            auto start = std::chrono::steady_clock::now();
+            // Grab on the frame grid; a grab that overruns its interval
+            // skips the ticks it missed rather than bunching up behind them
+            if (scheduler.GetFPS() != targetFps) scheduler.SetFPS(targetFps);
+            scheduler.WaitForNextFrame();
+            if (!running) break;
+            tickStartMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
 
-            // Capture screen
-            XImage* image = XGetImage(display, root, 0, 0, width, height, AllPlanes, ZPixmap);
-            if (image) {
-                // Convert XImage to our format
-                ConvertImage(image);
-                XDestroyImage(image);
+            damaged.clear();
+            bool fullCapture = !useDamage || needFullCapture;
+            if (!fullCapture) {
+                FetchDamage(damaged);
 
-                // Create video frame
-                VideoFrame frame;
-                frame.data = frameBuffer.data();
-                frame.width = width;
-                frame.height = height;
-                frame.stride = width * 4;
-                frame.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::steady_clock::now().time_since_epoch()).count();
-                frame.format = 0; // BGRA
-
-                // Store frame in buffer (callback removed for new interface)
+                // Large or fragmented damage is cheaper as a single grab
+                uint64 damagedArea = 0;
+                for (const auto& rect : damaged) damagedArea += static_cast<uint64>(rect.width) * rect.height;
+                fullCapture = damaged.size() > 64 || damagedArea * 2 >= static_cast<uint64>(width) * height;
+            } else if (useDamage) {
+                // Everything is grabbed anyway, just reset the damage
+                FetchDamage(damaged);
             }
 
-            // Limit to ~30 FPS
-            auto end = std::chrono::steady_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            if (duration.count() < 33) { // ~30 FPS
-                std::this_thread::sleep_for(std::chrono::milliseconds(33 - duration.count()));
+            if (fullCapture) {
+                damaged.assign(1, Rect{0, 0, static_cast<uint32>(width), static_cast<uint32>(height)});
+                if (CaptureFullFrame()) {
+                    needFullCapture = false;
+                    PublishChanges(damaged);
+                }
+            } else if (!damaged.empty()) {
+                for (auto& rect : damaged) {
+                    rect = AlignToChromaBlocks(rect);
+                    if (!CaptureRect(rect)) {
+                        needFullCapture = true;
+                        break;
+                    }
+                }
+                PublishChanges(damaged);
             }
         }
     }
 
-    void ConvertImage(XImage* image) {
-        std::lock_guard<std::mutex> lock(frameMutex);
-        
-        // Convert XImage data to BGRA format
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
+    // Convert an XImage into frameBuffer with its top-left corner at screen
+    // position (dstX, dstY)
+    void ConvertImage(XImage* image, int dstX, int dstY) {
+        if (outputFormat == 2) {
+            ConvertImageToYuv(image, dstX, dstY);
+            return;
+        }
+        ConvertImageToBGRA(image, frameBuffer.data() + (static_cast<size_t>(dstY) * width + dstX) * 4, width * 4);
+    }
+
+    // The usual 24/32-bit visual is already BGRA in memory, so it converts
+    // straight from the image: every pixel is read once and only the planes
+    // are written. Other visuals are staged as BGRA first.
+    void ConvertImageToYuv(XImage* image, int dstX, int dstY) {
+        const uint8* src = reinterpret_cast<const uint8*>(image->data);
+        uint32 srcStride = image->bytes_per_line;
+        bool bgra = image->bits_per_pixel == 32 && image->red_mask == 0xFF0000 &&
+                    image->green_mask == 0xFF00 && image->blue_mask == 0xFF && image->byte_order == LSBFirst;
+        if (!bgra) {
+            stagingBuffer.resize(static_cast<size_t>(image->width) * image->height * 4);
+            ConvertImageToBGRA(image, stagingBuffer.data(), image->width * 4);
+            src = stagingBuffer.data();
+            srcStride = image->width * 4;
+        }
+
+        // (dstX, dstY) is on a chroma block boundary, so the plane offsets are exact
+        YuvImage planes = GetYuv420Planes(detectView);
+        const uint32 x = dstX / scale, y = dstY / scale;
+        planes.y += static_cast<size_t>(y) * planes.yStride + x;
+        planes.u += static_cast<size_t>(y / 2) * planes.uStride + x / 2;
+        planes.v += static_cast<size_t>(y / 2) * planes.vStride + x / 2;
+        yuvConverter->Convert(src, srcStride, image->width, image->height, planes);
+    }
+
+    // Convert an XImage to BGRA at dst
+    void ConvertImageToBGRA(XImage* image, uint8* dst, uint32 dstStride) {
+        PixelLayout layout;
+        layout.bitsPerPixel = image->bits_per_pixel;
+        layout.redMask = image->red_mask;
+        layout.greenMask = image->green_mask;
+        layout.blueMask = image->blue_mask;
+        layout.msbFirst = image->byte_order == MSBFirst;
+
+        if (IsPixelKernelSupported(PixelKernel::Scalar, layout)) {
+            ConvertToBGRA(reinterpret_cast<const uint8*>(image->data), image->bytes_per_line, layout,
+                          dst, dstStride, image->width, image->height);
+            return;
+        }
+
+        // Uncommon visuals (e.g. 8bpp) go through XGetPixel
+        for (int y = 0; y < image->height; y++) {
+            for (int x = 0; x < image->width; x++) {
                 unsigned long pixel = XGetPixel(image, x, y);
                 
                 // Extract RGB values (assuming 24-bit color)
@@ -160,16 +662,20 @@ private:
                 uint8 a = 0xFF; // Full alpha
                 
                 // Store in BGRA format
-                int index = (y * width + x) * 4;
-                frameBuffer[index] = b;     // Blue
-                frameBuffer[index + 1] = g; // Green
-                frameBuffer[index + 2] = r; // Red
-                frameBuffer[index + 3] = a; // Alpha
+                uint8* out = dst + static_cast<size_t>(y) * dstStride + x * 4;
+                out[0] = b; // Blue
+                out[1] = g; // Green
+                out[2] = r; // Red
+                out[3] = a; // Alpha
             }
         }
     }
 
     void Cleanup() {
+        if (display) {
+            CleanupDamage();
+            CleanupShm();
+        }
         if (outputInfo) {
             XRRFreeOutputInfo(outputInfo);
             outputInfo = nullptr;
@@ -1,11 +1,14 @@
 #include "splashtop_app.h"
+#include "codec_registry.h"
 #include <iostream>
 #include <chrono>
 
 namespace SplashTop {
 
-    SplashTopApp::SplashTopApp() : m_isRunning(false), m_isStreaming(false), 
-        m_fps(30), m_bitrate(5000000), m_quality(80), m_captureWidth(1920), m_captureHeight(1080),
+    SplashTopApp::SplashTopApp() : m_frameQueue(2, StageQueue<FrameJob>::Policy::DropOldest),
+        m_packetQueue(kPacketQueueSlices, StageQueue<PacketJob>::Policy::Block), m_framesReleased(0),
+        m_isRunning(false), m_isStreaming(false), 
+        m_parameters{30, 5000000, 80, 0, 1, false}, m_parametersVersion(0), m_keyframeRequested(false), m_captureWidth(1920), m_captureHeight(1080),
         m_totalFramesProcessed(0) {
         m_startTime = std::chrono::steady_clock::now();
     }
@@ -18,10 +21,14 @@ namespace SplashTop {
         std::cout << "Initializing SplashTop Remote Desktop Streamer..." << std::endl;
         
         // Create components
-        m_screenCapture = CreateScreenCapture();
-        m_videoEncoder = CreateVideoEncoder("h264");
-        m_inputInjector = CreateInputInjector();
-        m_webrtcStreamer = CreateWebRTCStreamer();
+        if (!m_screenCapture) m_screenCapture = CreateScreenCapture();
+        m_videoEncoder = CreateVideoEncoder(m_videoCodec);
+        const VideoCodecRegistry& codecs = VideoCodecRegistry::Instance();
+        if (codecs.IsAvailable(m_videoCodec) && codecs.Find(m_videoCodec)->routesByContent) {
+            m_contentClassifier = std::make_unique<ContentClassifier>();
+        }
+        if (!m_inputInjector) m_inputInjector = CreateInputInjector();
+        if (!m_webrtcStreamer) m_webrtcStreamer = CreateWebRTCStreamer();
         
         if (!m_screenCapture || !m_videoEncoder || !m_inputInjector || !m_webrtcStreamer) {
             std::cerr << "Failed to create components" << std::endl;
@@ -41,7 +48,31 @@ namespace SplashTop {
             m_captureHeight = resolutions[0].second;
         }
         
-        if (!m_videoEncoder->Initialize(m_captureWidth, m_captureHeight, m_fps, m_bitrate)) {
+        // Frames are streamed at the capture's output size
+        uint32 streamWidth = m_captureWidth;
+        uint32 streamHeight = m_captureHeight;
+        if (m_yuvCapture) {
+            const VideoCodecInfo* codecInfo = codecs.Find(m_videoCodec);
+            if (codecInfo && codecInfo->yuvInput && m_screenCapture->SetOutputFormat(2, m_halfSizeCapture)) {
+                if (m_halfSizeCapture) {
+                    streamWidth = (m_captureWidth + 1) / 2;
+                    streamHeight = (m_captureHeight + 1) / 2;
+                }
+            } else {
+                std::cout << "YUV capture not available with codec " << m_videoCodec
+                          << ", capturing BGRA" << std::endl;
+            }
+        }
+        
+        StreamingParameters parameters;
+        {
+            std::lock_guard<std::mutex> lock(m_parametersMutex);
+            parameters = m_parameters;
+        }
+        m_videoEncoder->SetKeyframeInterval(parameters.keyframeInterval);
+        m_videoEncoder->SetSliceCount(parameters.sliceCount);
+        m_videoEncoder->SetIntraRefresh(parameters.intraRefresh);
+        if (!m_videoEncoder->Initialize(streamWidth, streamHeight, parameters.fps, parameters.bitrate)) {
             std::cerr << "Failed to initialize video encoder" << std::endl;
             return false;
         }
@@ -65,14 +96,22 @@ namespace SplashTop {
             OnConnectionStateChanged(connected);
         });
         
-        // Set coordinate mapping
-        m_inputInjector->SetCoordinateMapping(m_captureWidth, m_captureHeight, 
+        m_webrtcStreamer->SetKeyframeRequestCallback([this]() {
+            RequestKeyframe();
+        });
+        
+        // Set coordinate mapping from the stream to the screen
+        m_inputInjector->SetCoordinateMapping(streamWidth, streamHeight, 
                                             m_captureWidth, m_captureHeight);
         
         m_isRunning = true;
         std::cout << "SplashTop initialized successfully" << std::endl;
         std::cout << "Screen resolution: " << m_captureWidth << "x" << m_captureHeight << std::endl;
+        if (streamWidth != m_captureWidth || streamHeight != m_captureHeight) {
+            std::cout << "Stream resolution: " << streamWidth << "x" << streamHeight << std::endl;
+        }
         std::cout << "Hardware acceleration: " << (m_screenCapture->IsHardwareAccelerated() ? "Yes" : "No") << std::endl;
+        std::cout << "Capture backend: " << m_screenCapture->GetBackendName() << std::endl;
         
         return true;
     }
@@ -98,10 +137,28 @@ namespace SplashTop {
             return false;
         }
         
+        // Refining an unchanged frame only helps lossy codecs
+        StaticScreenSettings idleSettings = m_idleSettings;
+        const VideoCodecInfo* codecInfo = VideoCodecRegistry::Instance().Find(m_videoCodec);
+        if (codecInfo && codecInfo->lossless) {
+            idleSettings.refineFrames = 0;
+        }
+        m_staticScreen.SetSettings(idleSettings);
+        m_staticScreen.Reset();
+        m_frameScheduler.Reset();
+        
+        // So does spending more bits around the pointer and recent edits
+        m_useRegionsOfInterest = codecInfo && !codecInfo->lossless;
+        
         m_isStreaming = true;
         
-        // Start processing thread
-        m_processingThread = std::thread(&SplashTopApp::ProcessingLoop, this);
+        // Start the pipeline, back to front
+        m_frameQueue.Reset();
+        m_packetQueue.Reset();
+        m_framesReleased = 0;
+        m_sendThread = std::thread(&SplashTopApp::SendStage, this);
+        m_encodeThread = std::thread(&SplashTopApp::EncodeStage, this);
+        m_captureThread = std::thread(&SplashTopApp::CaptureStage, this);
         
         std::cout << "Streaming started successfully" << std::endl;
         return true;
@@ -113,11 +170,19 @@ namespace SplashTop {
         std::cout << "Stopping streaming..." << std::endl;
         
         m_isStreaming = false;
+        m_frameQueue.Close();
+        m_packetQueue.Close();
         
-        if (m_processingThread.joinable()) {
-            m_processingThread.join();
+        for (std::thread* stage : {&m_captureThread, &m_encodeThread, &m_sendThread}) {
+            if (stage->joinable()) {
+                stage->join();
+            }
         }
         
+        // Return queued frames and packets to their pools
+        m_frameQueue.Reset();
+        m_packetQueue.Reset();
+        
         m_screenCapture->StopCapture();
         m_webrtcStreamer->StopStreaming();
         
@@ -125,78 +190,352 @@ namespace SplashTop {
     }
     
     void SplashTopApp::SetStreamingParameters(uint32 fps, uint32 bitrate, uint32 quality) {
-        m_fps = fps;
-        m_bitrate = bitrate;
-        m_quality = quality;
-        
-        if (m_videoEncoder) {
-            m_videoEncoder->SetFPS(fps);
-            m_videoEncoder->SetBitrate(bitrate);
-            m_videoEncoder->SetQuality(quality);
-        }
-        
-        if (m_webrtcStreamer) {
-            m_webrtcStreamer->SetFPS(fps);
-            m_webrtcStreamer->SetBitrate(bitrate);
-            m_webrtcStreamer->SetQuality(quality);
+        {
+            std::lock_guard<std::mutex> lock(m_parametersMutex);
+            m_parameters.fps = std::max<uint32>(1, fps);
+            m_parameters.bitrate = bitrate;
+            m_parameters.quality = quality;
+            m_parametersVersion++;
         }
     }
     
+    SplashTopApp::StreamingParameters SplashTopApp::GetStreamingParameters() {
+        std::lock_guard<std::mutex> lock(m_parametersMutex);
+        return m_parameters;
+    }
+    
+    // The encoder belongs to the encode stage while streaming, so encoder
+    // settings go through m_parameters like the rates
+    void SplashTopApp::SetKeyframeInterval(uint32 frames) {
+        std::lock_guard<std::mutex> lock(m_parametersMutex);
+        m_parameters.keyframeInterval = frames;
+        m_parametersVersion++;
+    }
+    
+    void SplashTopApp::SetSliceCount(uint32 slices) {
+        std::lock_guard<std::mutex> lock(m_parametersMutex);
+        m_parameters.sliceCount = std::max<uint32>(1, slices);
+        m_parametersVersion++;
+    }
+    
+    void SplashTopApp::SetIntraRefresh(bool enabled) {
+        std::lock_guard<std::mutex> lock(m_parametersMutex);
+        m_parameters.intraRefresh = enabled;
+        m_parametersVersion++;
+    }
+    
     SplashTopApp::AppStats SplashTopApp::GetStats() {
         AppStats stats;
         stats.capture = m_screenCapture ? m_screenCapture->GetStats() : CaptureStats{};
         stats.encoder = m_videoEncoder ? m_videoEncoder->GetStats() : EncoderStats{};
         stats.streaming = m_webrtcStreamer ? m_webrtcStreamer->GetStats() : StreamingStats{};
         stats.input = m_inputInjector ? m_inputInjector->GetStats() : InputStats{};
+        stats.framesSkipped = m_staticScreen.GetSkippedFrames();
+        stats.frameQueue = m_frameQueue.GetStats();
+        stats.packetQueue = m_packetQueue.GetStats();
+        stats.pacing = m_frameScheduler.GetStats();
+        stats.latency = m_totalLatency.GetSnapshot();
+        
+        // A stage waits on its input queue when starved and on its output
+        // queue when the next stage falls behind
+        auto stageStats = [](const StageCounters& counters, uint64 waitMicros) {
+            return StageStats{counters.items.load(std::memory_order_relaxed),
+                              counters.busyMicros.load(std::memory_order_relaxed), waitMicros};
+        };
+        stats.captureStage = stageStats(m_captureCounters, stats.frameQueue.producerWaitMicros);
+        stats.encodeStage = stageStats(m_encodeCounters,
+                                       stats.frameQueue.consumerWaitMicros + stats.packetQueue.producerWaitMicros);
+        stats.sendStage = stageStats(m_sendCounters, stats.packetQueue.consumerWaitMicros);
         stats.isStreaming = m_isStreaming;
         return stats;
     }
     
+    std::string SplashTopApp::GetMetrics() {
+        PrometheusWriter writer;
+        
+        writer.Family("splashtop_frames_total", "counter", "Frames passing each point of the pipeline");
+        writer.Sample("splashtop_frames_total", static_cast<double>(m_framesCaptured.load()), "stage=\"captured\"");
+        writer.Sample("splashtop_frames_total", static_cast<double>(m_totalFramesProcessed.load()), "stage=\"encoded\"");
+        writer.Sample("splashtop_frames_total", static_cast<double>(m_sendCounters.items.load()), "stage=\"sent\"");
+        writer.Sample("splashtop_frames_total", static_cast<double>(m_frameQueue.GetStats().dropped), "stage=\"dropped\"");
+        writer.Sample("splashtop_frames_total", static_cast<double>(m_staticScreen.GetSkippedFrames()), "stage=\"skipped\"");
+        
+        writer.Family("splashtop_sent_bytes_total", "counter", "Encoded bytes handed to the streamer");
+        writer.Sample("splashtop_sent_bytes_total", static_cast<double>(m_bytesSent.load()));
+        
+        writer.Family("splashtop_input_events_total", "counter", "Input events received from the viewer");
+        writer.Sample("splashtop_input_events_total", static_cast<double>(m_mouseEvents.load()), "type=\"mouse\"");
+        writer.Sample("splashtop_input_events_total", static_cast<double>(m_keyboardEvents.load()), "type=\"keyboard\"");
+        
+        // Rolling rates from the components themselves
+        CaptureStats capture = m_screenCapture ? m_screenCapture->GetStats() : CaptureStats{};
+        EncoderStats encoder = m_videoEncoder ? m_videoEncoder->GetStats() : EncoderStats{};
+        StreamingStats streaming = m_webrtcStreamer ? m_webrtcStreamer->GetStats() : StreamingStats{};
+        writer.Family("splashtop_frames_per_second", "gauge", "Frame rate over the last few seconds");
+        writer.Sample("splashtop_frames_per_second", capture.averageFPS, "stage=\"captured\"");
+        writer.Sample("splashtop_frames_per_second", encoder.averageFPS, "stage=\"encoded\"");
+        writer.Sample("splashtop_frames_per_second", streaming.averageFPS, "stage=\"sent\"");
+        writer.Family("splashtop_bits_per_second", "gauge", "Bitrate over the last few seconds");
+        writer.Sample("splashtop_bits_per_second", encoder.averageBitrate, "stage=\"encoded\"");
+        writer.Sample("splashtop_bits_per_second", streaming.averageBitrate, "stage=\"sent\"");
+        
+        writer.Family("splashtop_queue_depth", "gauge", "Items waiting between pipeline stages");
+        writer.Sample("splashtop_queue_depth", m_frameQueue.GetStats().depth, "queue=\"frame\"");
+        writer.Sample("splashtop_queue_depth", m_packetQueue.GetStats().depth, "queue=\"packet\"");
+        
+        writer.Family("splashtop_encoder_qp", "gauge", "Average quantizer of recent frames (0 if not reported)");
+        writer.Sample("splashtop_encoder_qp", encoder.averageQP);
+        
+        writer.Family("splashtop_stage_latency_seconds", "histogram", "Time frames spend in each pipeline stage");
+        writer.Histogram("splashtop_stage_latency_seconds", m_pickupLatency.GetSnapshot(), "stage=\"pickup\"");
+        writer.Histogram("splashtop_stage_latency_seconds", m_frameQueueLatency.GetSnapshot(), "stage=\"frame_queue\"");
+        writer.Histogram("splashtop_stage_latency_seconds", m_encodeLatency.GetSnapshot(), "stage=\"encode\"");
+        writer.Histogram("splashtop_stage_latency_seconds", m_packetQueueLatency.GetSnapshot(), "stage=\"packet_queue\"");
+        writer.Histogram("splashtop_stage_latency_seconds", m_sendLatency.GetSnapshot(), "stage=\"send\"");
+        
+        writer.Family("splashtop_capture_to_send_seconds", "histogram", "Time from capturing a new frame to sending its last slice");
+        writer.Histogram("splashtop_capture_to_send_seconds", m_totalLatency.GetSnapshot());
+        
+        writer.Family("splashtop_streaming", "gauge", "1 while streaming");
+        writer.Sample("splashtop_streaming", m_isStreaming ? 1.0 : 0.0);
+        return writer.GetText();
+    }
+    
+    bool SplashTopApp::StartMetricsServer(const std::string& address, uint16 port) {
+        return m_metricsServer.Start(address, port, [this] { return GetMetrics(); });
+    }
+    
     void SplashTopApp::Shutdown() {
+        m_metricsServer.Stop();
         StopStreaming();
         m_isRunning = false;
         
         m_screenCapture.reset();
         m_videoEncoder.reset();
+        m_contentClassifier.reset();
         m_inputInjector.reset();
         m_webrtcStreamer.reset();
         
         std::cout << "SplashTop shutdown complete" << std::endl;
     }
     
-    void SplashTopApp::ProcessingLoop() {
-        const auto frameInterval = std::chrono::microseconds(1000000 / m_fps);
-        auto lastFrameTime = std::chrono::steady_clock::now();
+    namespace {
+        // How long after the capture thread publishes a frame the capture
+        // stage ticks, as slack for a grab that runs a little long
+        const int64 kCaptureLeadMicros = 1000;
+        
+        uint64 MicrosSince(std::chrono::steady_clock::time_point start) {
+            return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        
+        uint64 NowMicros() {
+            return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    } // namespace
+    
+    void SplashTopApp::CaptureStage() {
+        uint64 parametersVersion = ~uint64(0);
+        bool alignToCapture = false;
+        uint64 lastTimestamp = 0;
+        
+        // The frame queued last, and how many jobs were queued. The capture
+        // hands out the same frame again while the screen is unchanged; it
+        // is only annotated again once the encode stage has let go of it.
+        const VideoFrame* lastQueued = nullptr;
+        uint64 framesQueued = 0;
         
         while (m_isStreaming) {
+            if (m_parametersVersion != parametersVersion) {
+                parametersVersion = m_parametersVersion;
+                uint32 fps = GetStreamingParameters().fps;
+                m_frameScheduler.SetFPS(fps);
+                alignToCapture = m_screenCapture->SetFrameRate(fps);
+            }
+            
+            // Tick on absolute deadlines; if a tick overran, the ones it
+            // missed are skipped instead of sent back to back
+            m_frameScheduler.WaitForNextFrame();
+            if (!m_isStreaming) break;
             auto now = std::chrono::steady_clock::now();
-            auto elapsed = now - lastFrameTime;
-            
-            if (elapsed >= frameInterval) {
-                // Capture frame
-                auto frame = m_screenCapture->GetLatestFrame();
-                if (frame) {
-                    // Encode frame
-                    std::vector<uint8> encodedData;
-                    if (m_videoEncoder->EncodeFrame(*frame, encodedData)) {
-                        // Send frame
-                        m_webrtcStreamer->SendVideoFrame(*frame);
-                        m_totalFramesProcessed++;
-                    }
-                    
-                    // Clean up frame data
-                    delete[] frame->data;
+            
+            auto frame = m_screenCapture->GetLatestFrame();
+            if (!frame) continue;
+            
+            // Tick just after the capture thread publishes, so frames are
+            // picked up fresh instead of up to an interval old
+            bool newFrame = frame->timestamp != lastTimestamp;
+            if (newFrame) {
+                lastTimestamp = frame->timestamp;
+                m_framesCaptured.fetch_add(1, std::memory_order_relaxed);
+                uint64 nowMicros = NowMicros();
+                m_pickupLatency.Observe(nowMicros > frame->timestamp ? nowMicros - frame->timestamp : 0);
+                if (alignToCapture) {
+                    m_frameScheduler.AlignTo(frame->timestamp, std::chrono::microseconds(kCaptureLeadMicros));
                 }
-                
-                lastFrameTime = now;
-            } else {
-                // Sleep for a short time to avoid busy waiting
-                std::this_thread::sleep_for(std::chrono::microseconds(1000));
             }
+            if (frame.get() == lastQueued && m_framesReleased.load(std::memory_order_acquire) != framesQueued) {
+                continue;
+            }
+            
+            // An unchanged screen is neither encoded nor sent, apart from
+            // keepalive and refinement frames and requested keyframes
+            FrameJob job;
+            bool encode = m_staticScreen.Update(*frame, now) != StaticScreenDetector::Action::Skip;
+            if (m_keyframeRequested.exchange(false)) {
+                job.keyframe = true;
+                encode = true;
+            }
+            if (!encode) continue;
+            
+            // Split text/UI from video content for the encoder
+            if (m_contentClassifier) {
+                m_contentClassifier->Classify(*frame);
+            }
+            
+            // Sharpen where the user is working
+            if (m_useRegionsOfInterest) {
+                m_roiTracker.Apply(*frame, now);
+            }
+            
+            job.frame = frame;
+            job.capturedMicros = newFrame ? frame->timestamp : 0;
+            lastQueued = frame.get();
+            framesQueued++;
+            bool droppable = !job.keyframe;
+            FrameTracer::Instance().Mark(frame->sequence, TraceStage::Queued);
+            job.queuedAt = std::chrono::steady_clock::now();
+            bool queued = m_frameQueue.Push(std::move(job), droppable, [&](FrameJob& dropped, FrameJob& next) {
+                FrameTracer::Instance().Mark(dropped.frame->sequence, TraceStage::Dropped);
+                if (dropped.frame != next.frame) next.frame->MergeDroppedFrame(*dropped.frame);
+                dropped.frame.reset();
+                m_framesReleased.fetch_add(1, std::memory_order_release);
+            });
+            if (!queued) break;
+            
+            m_captureCounters.items.fetch_add(1, std::memory_order_relaxed);
+            m_captureCounters.busyMicros.fetch_add(MicrosSince(now), std::memory_order_relaxed);
+        }
+    }
+    
+    void SplashTopApp::EncodeStage() {
+        uint64 parametersVersion = ~uint64(0);
+        
+        while (m_isStreaming) {
+            // Parameter changes land between frames, all at once
+            if (m_parametersVersion != parametersVersion) {
+                parametersVersion = m_parametersVersion;
+                StreamingParameters parameters = GetStreamingParameters();
+                m_videoEncoder->SetFPS(parameters.fps);
+                m_videoEncoder->SetBitrate(parameters.bitrate);
+                m_videoEncoder->SetQuality(parameters.quality);
+                m_videoEncoder->SetKeyframeInterval(parameters.keyframeInterval);
+                m_videoEncoder->SetSliceCount(parameters.sliceCount);
+                m_videoEncoder->SetIntraRefresh(parameters.intraRefresh);
+            }
+            
+            FrameJob job;
+            if (!m_frameQueue.Pop(job, std::chrono::milliseconds(10))) continue;
+            auto start = std::chrono::steady_clock::now();
+            m_frameQueueLatency.Observe(MicrosSince(job.queuedAt));
+            
+            // Every packet may be queued or being sent; the sender wakes us
+            // when it releases one
+            std::shared_ptr<EncodedPacket> packet;
+            while (!packet && m_isStreaming) {
+                packet = m_packetPool.Acquire(std::chrono::milliseconds(10));
+            }
+            
+            // Each slice goes to the send stage as soon as it is encoded, so
+            // the first bytes leave before the rest of the frame is done.
+            // Encoded slices depend on each other and are never dropped.
+            // The callback only captures a reference to the frame's state,
+            // which std::function holds without allocating.
+            struct SliceHandoff {
+                StageQueue<PacketJob>& queue;
+                std::shared_ptr<EncodedPacket> packet;
+                uint64 capturedMicros;
+                bool closed;
+            } handoff{m_packetQueue, std::move(packet), job.capturedMicros, false};
+            bool encoded = false;
+            if (handoff.packet) {
+                if (job.keyframe) {
+                    m_videoEncoder->RequestKeyframe();
+                }
+                FrameTracer& tracer = FrameTracer::Instance();
+                tracer.Mark(job.frame->sequence, TraceStage::EncodeStart);
+                auto encodeStart = std::chrono::steady_clock::now();
+                encoded = m_videoEncoder->EncodePacket(*job.frame, *handoff.packet, [&handoff](const EncodedSlice& slice) {
+                    if (handoff.closed) return;
+                    PacketJob packetJob{handoff.packet, slice, std::chrono::steady_clock::now(), handoff.capturedMicros};
+                    handoff.closed = !handoff.queue.Push(std::move(packetJob));
+                });
+                m_encodeLatency.Observe(MicrosSince(encodeStart));
+                tracer.Mark(job.frame->sequence, TraceStage::EncodeEnd);
+            }
+            
+            // The capture stage may now touch the frame again
+            job.frame.reset();
+            m_framesReleased.fetch_add(1, std::memory_order_release);
+            
+            if (encoded) {
+                m_totalFramesProcessed++;
+                m_encodeCounters.items.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_encodeCounters.busyMicros.fetch_add(MicrosSince(start), std::memory_order_relaxed);
+            if (handoff.closed) break;
+        }
+    }
+    
+    void SplashTopApp::SendStage() {
+        uint64 parametersVersion = ~uint64(0);
+        
+        while (m_isStreaming) {
+            if (m_parametersVersion != parametersVersion) {
+                parametersVersion = m_parametersVersion;
+                StreamingParameters parameters = GetStreamingParameters();
+                m_webrtcStreamer->SetFPS(parameters.fps);
+                m_webrtcStreamer->SetBitrate(parameters.bitrate);
+                m_webrtcStreamer->SetQuality(parameters.quality);
+            }
+            
+            PacketJob job;
+            if (!m_packetQueue.Pop(job, std::chrono::milliseconds(10))) continue;
+            auto start = std::chrono::steady_clock::now();
+            m_packetQueueLatency.Observe(MicrosSince(job.queuedAt));
+            const EncodedSlice& slice = job.slice;
+            FrameTracer& tracer = FrameTracer::Instance();
+            if (slice.index == 0) {
+                tracer.Mark(slice.frameSequence, TraceStage::SendStart);
+            }
+            
+            m_webrtcStreamer->SendVideoSlice(slice);
+            m_sendLatency.Observe(MicrosSince(start));
+            m_bytesSent.fetch_add(slice.size, std::memory_order_relaxed);
+            
+            // The packet returns to its pool once its last slice is released
+            job.packet.reset();
+            m_packetPool.NotifyReleased();
+            if (slice.IsLastInFrame()) {
+                tracer.Mark(slice.frameSequence, TraceStage::SendEnd);
+                if (job.capturedMicros) {
+                    uint64 nowMicros = NowMicros();
+                    m_totalLatency.Observe(nowMicros > job.capturedMicros ? nowMicros - job.capturedMicros : 0);
+                }
+                m_sendCounters.items.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_sendCounters.busyMicros.fetch_add(MicrosSince(start), std::memory_order_relaxed);
         }
     }
     
     void SplashTopApp::OnInputEvent(const InputEvent& event) {
+        if (event.type == InputEvent::MOUSE_MOVE) {
+            m_roiTracker.OnPointerMoved(event.x, event.y, std::chrono::steady_clock::now());
+        }
+        bool keyboard = event.type == InputEvent::KEY_DOWN || event.type == InputEvent::KEY_UP;
+        (keyboard ? m_keyboardEvents : m_mouseEvents).fetch_add(1, std::memory_order_relaxed);
+        
         if (!m_inputInjector) return;
         
         switch (event.type) {
@@ -222,6 +561,7 @@ namespace SplashTop {
     }
     
     void SplashTopApp::OnConnectionStateChanged(bool connected) {
+        // The streamer asks for the new viewer's keyframe itself
         std::cout << "Connection state changed: " << (connected ? "Connected" : "Disconnected") << std::endl;
     }
 
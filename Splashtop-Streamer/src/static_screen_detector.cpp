@@ -0,0 +1,60 @@
+#include "static_screen_detector.h"
+
+namespace SplashTop {
+
+    StaticScreenDetector::StaticScreenDetector(const StaticScreenSettings& settings) : m_settings(settings) {
+    }
+
+    void StaticScreenDetector::Reset() {
+        m_first = true;
+        m_lastSequence = 0;
+        m_refinesLeft = 0;
+        m_detector.Reset();
+    }
+
+    bool StaticScreenDetector::HasChanged(const VideoFrame& frame) {
+        if (frame.sequence != 0) {
+            // The capture handed out the frame we already saw
+            if (frame.sequence == m_lastSequence) return false;
+            m_lastSequence = frame.sequence;
+        }
+
+        // A new frame can still be identical to the last one
+        if (frame.dirtyTiles.IsValid()) return frame.dirtyTiles.CountDirty() > 0;
+        if (frame.hasDamageInfo) return !frame.dirtyRects.empty();
+        return m_detector.Detect(frame, m_changed) > 0;
+    }
+
+    StaticScreenDetector::Action StaticScreenDetector::Update(VideoFrame& frame,
+                                                              std::chrono::steady_clock::time_point now) {
+        bool changed = HasChanged(frame);
+        if (changed || m_first) {
+            m_first = false;
+            m_lastChange = now;
+            m_lastSent = now;
+            m_refinesLeft = m_settings.refineFrames;
+            return Action::Encode;
+        }
+
+        Action action = Action::Skip;
+        if (m_refinesLeft > 0 && now - m_lastChange >= std::chrono::milliseconds(m_settings.refineDelayMs)) {
+            m_refinesLeft--;
+            action = Action::Refine;
+        } else if (m_settings.keepaliveMs && now - m_lastSent >= std::chrono::milliseconds(m_settings.keepaliveMs)) {
+            action = Action::Keepalive;
+        }
+
+        if (action == Action::Skip) {
+            m_skippedFrames++;
+            return action;
+        }
+
+        // Relative to the frame sent last, nothing changed
+        frame.dirtyTiles.Clear();
+        frame.dirtyRects.clear();
+        frame.hasDamageInfo = true;
+        m_lastSent = now;
+        return action;
+    }
+
+} // namespace SplashTop
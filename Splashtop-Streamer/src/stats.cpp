@@ -0,0 +1,134 @@
+#include "stats.h"
+#include <cmath>
+
+namespace SplashTop {
+
+    uint64 StatsNowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    size_t StatCounter::ThreadShard() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+        return shard;
+    }
+
+    uint64 StatCounter::Get() const {
+        uint64 total = 0;
+        for (const Shard& shard : m_shards) total += shard.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void StatCounter::Reset() {
+        for (Shard& shard : m_shards) shard.value.store(0, std::memory_order_relaxed);
+    }
+
+    RateEstimator::RateEstimator(double windowSeconds)
+        : m_windowMicros(std::max(windowSeconds, 0.001) * 1e6) {}
+
+    double RateEstimator::Update(uint64 total, uint64 nowMicros) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_hasSample || total < m_lastTotal || nowMicros < m_lastMicros) {
+            // First sample, or the total was reset: start over from here
+            m_lastTotal = total;
+            m_lastMicros = nowMicros;
+            m_hasSample = true;
+            m_hasRate = false;
+            m_rate = 0.0;
+            return m_rate;
+        }
+
+        uint64 elapsed = nowMicros - m_lastMicros;
+        if (elapsed < kMinIntervalMicros) return m_rate;
+
+        double instant = (total - m_lastTotal) * 1e6 / elapsed;
+        if (m_hasRate) {
+            // Weight by elapsed time so the window does not depend on how
+            // often readers come by
+            double alpha = 1.0 - std::exp(-static_cast<double>(elapsed) / m_windowMicros);
+            m_rate += alpha * (instant - m_rate);
+        } else {
+            m_rate = instant;
+            m_hasRate = true;
+        }
+        m_lastTotal = total;
+        m_lastMicros = nowMicros;
+        return m_rate;
+    }
+
+    double RateEstimator::Get() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_rate;
+    }
+
+    void RateEstimator::Reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hasSample = false;
+        m_hasRate = false;
+        m_rate = 0.0;
+    }
+
+    ThroughputMeter::ThroughputMeter(double windowSeconds)
+        : m_itemRate(windowSeconds), m_byteRate(windowSeconds) {}
+
+    void ThroughputMeter::Record(uint64 bytes, uint64 items) {
+        if (bytes) m_bytes.Add(bytes);
+        if (items) {
+            m_items.Add(items);
+            m_lastMicros.store(StatsNowMicros(), std::memory_order_relaxed);
+        }
+    }
+
+    ThroughputMeter::Rates ThroughputMeter::GetRates() {
+        uint64 now = StatsNowMicros();
+        Rates rates;
+        rates.itemsPerSecond = m_itemRate.Update(m_items.Get(), now);
+        rates.bitsPerSecond = m_byteRate.Update(m_bytes.Get(), now) * 8.0;
+        return rates;
+    }
+
+    void ThroughputMeter::Reset() {
+        m_items.Reset();
+        m_bytes.Reset();
+        m_lastMicros.store(0, std::memory_order_relaxed);
+        m_itemRate.Reset();
+        m_byteRate.Reset();
+    }
+
+    // From well under a frame to a second, in 1-2.5-5 steps
+    const uint64 LatencyHistogram::kBucketBoundsMicros[LatencyHistogram::kBucketCount] = {
+        100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000
+    };
+
+    void LatencyHistogram::Observe(uint64 micros) {
+        size_t bucket = 0;
+        while (bucket < kBucketCount && micros > kBucketBoundsMicros[bucket]) bucket++;
+        m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_sumMicros.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+        Snapshot snapshot;
+        for (size_t i = 0; i <= kBucketCount; i++) {
+            snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+            snapshot.count += snapshot.counts[i];
+        }
+        snapshot.sumMicros = m_sumMicros.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    uint64 LatencyHistogram::Snapshot::GetPercentileMicros(double q) const {
+        if (count == 0) return 0;
+        // Rank of the sample at quantile q, counting from 1
+        uint64 rank = static_cast<uint64>(std::ceil(std::min(std::max(q, 0.0), 1.0) * count));
+        rank = std::max<uint64>(rank, 1);
+        uint64 seen = 0;
+        for (size_t i = 0; i < kBucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank) return kBucketBoundsMicros[i];
+        }
+        return kBucketBoundsMicros[kBucketCount - 1];
+    }
+
+} // namespace SplashTop
@@ -0,0 +1,438 @@
+#include "synthetic_screen_capture.h"
+#include "yuv_convert.h"
+#include "frame_trace.h"
+#include <cstring>
+
+namespace SplashTop {
+
+    namespace {
+
+        const uint32 kTitleBarHeight = 24;
+        const uint32 kScrollRows = 4;     // Per frame, a brisk scroll
+        const uint32 kNoiseSlack = 256;   // Pixels a video row can shift by
+        const uint32 kTextWhite = 0xFFFFFFFF;
+        const uint32 kTextInk = 0xFF202020;
+
+        uint64 Mix(uint64 a, uint64 b) {
+            uint64 z = a * 0x9E3779B97F4A7C15ull + b + 0x632BE59BD9B4E019ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Position going back and forth over [0, range]
+        uint32 Bounce(uint64 value, uint32 range) {
+            if (range == 0) return 0;
+            uint64 position = value % (2 * static_cast<uint64>(range));
+            return static_cast<uint32>(position <= range ? position : 2 * range - position);
+        }
+
+        uint32* Row(uint8* image, uint32 stride, uint32 y) {
+            return reinterpret_cast<uint32*>(image + static_cast<size_t>(y) * stride);
+        }
+
+        void FillRect(uint8* image, uint32 stride, const Rect& rect, uint32 color) {
+            for (uint32 y = 0; y < rect.height; y++) {
+                uint32* row = Row(image, stride, rect.y + y) + rect.x;
+                std::fill(row, row + rect.width, color);
+            }
+        }
+
+        // Lines of pseudo-text on white, 8x16 character cells, rows
+        // documentY onwards of a document that depends only on seed
+        void DrawText(uint8* image, uint32 stride, const Rect& area, uint64 seed, uint64 documentY) {
+            for (uint32 y = 0; y < area.height; y++) {
+                uint32* row = Row(image, stride, area.y + y) + area.x;
+                uint64 documentRow = documentY + y;
+                uint64 line = documentRow / 16;
+                uint32 glyphY = static_cast<uint32>(documentRow % 16);
+                uint64 lineHash = Mix(seed, line);
+                uint32 lineLength = 10 + static_cast<uint32>(lineHash % 90);
+
+                std::fill(row, row + area.width, kTextWhite);
+                if (glyphY < 3 || glyphY > 12 || area.width < 12) continue;
+                uint32 columns = std::min(lineLength, (area.width - 4) / 8);
+                for (uint32 column = 0; column < columns; column++) {
+                    uint64 glyph = Mix(lineHash, column);
+                    if ((glyph & 7) == 0) continue; // Space
+                    uint32 bits = static_cast<uint32>(glyph >> (8 + (glyphY - 3) * 5)) & 0x3F;
+                    uint32* cell = row + 4 + column * 8 + 1;
+                    for (uint32 x = 0; x < 6; x++) {
+                        if ((bits >> x) & 1) cell[x] = kTextInk;
+                    }
+                }
+            }
+        }
+
+        // Title bar and a body of text; returns the body
+        Rect DrawWindow(uint8* image, uint32 stride, const Rect& rect, uint64 seed) {
+            FillRect(image, stride, rect, 0xFF2B2B2B);
+            FillRect(image, stride, {rect.x + 1, rect.y + 1, rect.width - 2, kTitleBarHeight - 1}, 0xFF3C3F41);
+            for (uint32 i = 0; i < 3 && rect.width > 80; i++) {
+                FillRect(image, stride, {rect.x + static_cast<int32>(rect.width) - 24 - 20 * static_cast<int32>(i),
+                                         rect.y + 6, 12, 12}, i == 0 ? 0xFFE06C60 : 0xFF8A8A8A);
+            }
+            Rect body = {rect.x + 2, rect.y + static_cast<int32>(kTitleBarHeight), rect.width - 4,
+                         rect.height - kTitleBarHeight - 2};
+            DrawText(image, stride, body, seed, 0);
+            return body;
+        }
+
+        bool Overlaps(const Rect& a, const Rect& b) {
+            return a.x < b.x + static_cast<int32>(b.width) && b.x < a.x + static_cast<int32>(a.width) &&
+                   a.y < b.y + static_cast<int32>(b.height) && b.y < a.y + static_cast<int32>(a.height);
+        }
+
+    } // namespace
+
+    const char* GetSyntheticWorkloadName(SyntheticWorkload workload) {
+        switch (workload) {
+            case SyntheticWorkload::Static: return "static";
+            case SyntheticWorkload::ScrollingText: return "scroll";
+            case SyntheticWorkload::WindowDrag: return "drag";
+            case SyntheticWorkload::VideoNoise: return "video";
+            case SyntheticWorkload::Mixed: return "mixed";
+        }
+        return "unknown";
+    }
+
+    bool ParseSyntheticWorkload(const std::string& name, SyntheticWorkload& workload) {
+        for (SyntheticWorkload candidate : GetSyntheticWorkloads()) {
+            if (name == GetSyntheticWorkloadName(candidate)) {
+                workload = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<SyntheticWorkload> GetSyntheticWorkloads() {
+        return {SyntheticWorkload::Static, SyntheticWorkload::ScrollingText, SyntheticWorkload::WindowDrag,
+                SyntheticWorkload::VideoNoise, SyntheticWorkload::Mixed};
+    }
+
+    SyntheticDesktop::SyntheticDesktop(SyntheticWorkload workload, uint32 width, uint32 height, uint32 seed)
+        : m_workload(workload), m_width(std::max<uint32>(width, 128)), m_height(std::max<uint32>(height, 128)),
+          m_seed(seed) {
+        const int32 w = static_cast<int32>(m_width), h = static_cast<int32>(m_height);
+        DrawDesktop();
+        m_pixels = m_background;
+
+        switch (m_workload) {
+            case SyntheticWorkload::Static:
+                break;
+            case SyntheticWorkload::ScrollingText:
+                m_textArea = DrawWindow(m_pixels.data(), GetStride(),
+                                        {w / 8, h / 8, m_width * 3 / 4, m_height * 3 / 4}, Mix(m_seed, 10));
+                break;
+            case SyntheticWorkload::WindowDrag: {
+                m_dragWindow = {0, 0, m_width / 3, m_height / 3};
+                m_dragImage.resize(static_cast<size_t>(m_dragWindow.width) * m_dragWindow.height * 4);
+                DrawWindow(m_dragImage.data(), m_dragWindow.width * 4, m_dragWindow, Mix(m_seed, 20));
+                DragWindow();
+                break;
+            }
+            case SyntheticWorkload::VideoNoise:
+                m_videoArea = {0, 0, m_width, m_height};
+                break;
+            case SyntheticWorkload::Mixed:
+                m_textArea = DrawWindow(m_pixels.data(), GetStride(),
+                                        {w / 16, h / 8, m_width * 7 / 16, m_height * 3 / 4}, Mix(m_seed, 10));
+                m_videoArea = {w / 2 + w / 16, h / 2, m_width * 3 / 8, m_height * 3 / 8};
+                break;
+        }
+
+        if (m_videoArea.width > 0) {
+            // Smooth colours with grain, so each frame looks like video and
+            // shifting the rows around changes every pixel
+            const uint32 textureWidth = m_videoArea.width + kNoiseSlack;
+            m_noise.resize(static_cast<size_t>(textureWidth) * m_videoArea.height * 4);
+            for (uint32 y = 0; y < m_videoArea.height; y++) {
+                uint32* row = Row(m_noise.data(), textureWidth * 4, y);
+                for (uint32 x = 0; x < textureWidth; x++) {
+                    uint32 grain = static_cast<uint32>(Mix(m_seed, static_cast<uint64>(y) * textureWidth + x)) & 31;
+                    uint32 r = (x * 255 / textureWidth + grain) & 0xFF;
+                    uint32 g = (y * 255 / m_videoArea.height + grain) & 0xFF;
+                    uint32 b = ((x + y) / 4 + grain * 2) & 0xFF;
+                    row[x] = 0xFF000000 | (r << 16) | (g << 8) | b;
+                }
+            }
+            DrawVideo(m_videoArea);
+        }
+    }
+
+    const std::vector<Rect>& SyntheticDesktop::Step() {
+        m_changed.clear();
+        if (m_step++ == 0) {
+            m_changed.push_back({0, 0, m_width, m_height});
+            return m_changed;
+        }
+
+        switch (m_workload) {
+            case SyntheticWorkload::Static:
+                break;
+            case SyntheticWorkload::ScrollingText:
+                ScrollText(m_textArea);
+                break;
+            case SyntheticWorkload::WindowDrag:
+                DragWindow();
+                break;
+            case SyntheticWorkload::VideoNoise:
+                DrawVideo(m_videoArea);
+                break;
+            case SyntheticWorkload::Mixed:
+                ScrollText(m_textArea);
+                DrawVideo(m_videoArea);
+                break;
+        }
+        return m_changed;
+    }
+
+    VideoFrame SyntheticDesktop::GetFrame() {
+        VideoFrame frame;
+        frame.data = m_pixels.data();
+        frame.width = m_width;
+        frame.height = m_height;
+        frame.stride = GetStride();
+        frame.timestamp = 0;
+        frame.format = 0;
+        return frame;
+    }
+
+    void SyntheticDesktop::DrawDesktop() {
+        m_background.resize(static_cast<size_t>(m_width) * m_height * 4);
+        for (uint32 y = 0; y < m_height; y++) {
+            uint32 r = 20 + y * 40 / m_height;
+            uint32 g = 70 + y * 50 / m_height;
+            uint32 b = 110 + y * 60 / m_height;
+            uint32* row = Row(m_background.data(), GetStride(), y);
+            std::fill(row, row + m_width, 0xFF000000 | (r << 16) | (g << 8) | b);
+        }
+
+        // A couple of windows that never change
+        const int32 w = static_cast<int32>(m_width), h = static_cast<int32>(m_height);
+        DrawWindow(m_background.data(), GetStride(), {w / 20, h / 10, m_width / 3, m_height / 2}, Mix(m_seed, 1));
+        DrawWindow(m_background.data(), GetStride(), {w / 2, h / 5, m_width * 2 / 5, m_height / 2}, Mix(m_seed, 2));
+    }
+
+    void SyntheticDesktop::ScrollText(const Rect& area) {
+        if (area.height <= kScrollRows) return;
+        const uint32 stride = GetStride();
+        for (uint32 y = 0; y + kScrollRows < area.height; y++) {
+            std::memcpy(Row(m_pixels.data(), stride, area.y + y) + area.x,
+                        Row(m_pixels.data(), stride, area.y + y + kScrollRows) + area.x, area.width * 4);
+        }
+        m_scrolled += kScrollRows;
+        Rect newRows = {area.x, area.y + static_cast<int32>(area.height - kScrollRows), area.width, kScrollRows};
+        DrawText(m_pixels.data(), stride, newRows, Mix(m_seed, 10), m_scrolled + area.height - kScrollRows);
+        m_changed.push_back(area);
+    }
+
+    void SyntheticDesktop::DrawVideo(const Rect& area) {
+        const uint32 textureStride = (area.width + kNoiseSlack) * 4;
+        for (uint32 y = 0; y < area.height; y++) {
+            // Every row from a different place in the texture, so no motion
+            // search finds the frame in the previous one
+            uint32 shift = static_cast<uint32>(Mix(Mix(m_seed, m_step), y) % kNoiseSlack);
+            std::memcpy(Row(m_pixels.data(), GetStride(), area.y + y) + area.x,
+                        Row(m_noise.data(), textureStride, y) + shift, area.width * 4);
+        }
+        m_changed.push_back(area);
+    }
+
+    void SyntheticDesktop::DragWindow() {
+        Rect previous = m_dragWindow;
+        m_dragWindow.x = static_cast<int32>(Bounce(m_step * 12, m_width - m_dragWindow.width));
+        m_dragWindow.y = static_cast<int32>(Bounce(m_step * 7, m_height - m_dragWindow.height));
+        if (m_step > 0 && m_dragWindow.x == previous.x && m_dragWindow.y == previous.y) return;
+
+        if (m_step > 0) Restore(previous);
+        const uint32 imageStride = m_dragWindow.width * 4;
+        for (uint32 y = 0; y < m_dragWindow.height; y++) {
+            std::memcpy(Row(m_pixels.data(), GetStride(), m_dragWindow.y + y) + m_dragWindow.x,
+                        m_dragImage.data() + static_cast<size_t>(y) * imageStride, imageStride);
+        }
+
+        // Old and new position, as one rectangle when they overlap (as a
+        // compositor would report)
+        if (m_step == 0) return;
+        if (Overlaps(previous, m_dragWindow)) {
+            int32 x0 = std::min(previous.x, m_dragWindow.x), y0 = std::min(previous.y, m_dragWindow.y);
+            int32 x1 = std::max(previous.x, m_dragWindow.x) + static_cast<int32>(m_dragWindow.width);
+            int32 y1 = std::max(previous.y, m_dragWindow.y) + static_cast<int32>(m_dragWindow.height);
+            m_changed.push_back({x0, y0, static_cast<uint32>(x1 - x0), static_cast<uint32>(y1 - y0)});
+        } else {
+            m_changed.push_back(previous);
+            m_changed.push_back(m_dragWindow);
+        }
+    }
+
+    void SyntheticDesktop::Restore(const Rect& rect) {
+        for (uint32 y = 0; y < rect.height; y++) {
+            std::memcpy(Row(m_pixels.data(), GetStride(), rect.y + y) + rect.x,
+                        Row(m_background.data(), GetStride(), rect.y + y) + rect.x, rect.width * 4);
+        }
+    }
+
+    SyntheticScreenCapture::SyntheticScreenCapture(SyntheticWorkload workload, uint32 width, uint32 height, uint32 seed)
+        : m_desktop(workload, width, height, seed) {}
+
+    SyntheticScreenCapture::~SyntheticScreenCapture() = default;
+
+    bool SyntheticScreenCapture::Initialize() {
+        ConfigureOutput();
+        return true;
+    }
+
+    bool SyntheticScreenCapture::StartCapture(uint32 monitorIndex) {
+        (void)monitorIndex;
+        m_capturing = true;
+        return true;
+    }
+
+    void SyntheticScreenCapture::StopCapture() {
+        m_capturing = false;
+    }
+
+    std::shared_ptr<VideoFrame> SyntheticScreenCapture::GetLatestFrame() {
+        if (!m_capturing) return nullptr;
+
+        uint64 start = StatsNowMicros();
+        const std::vector<Rect>& changed = m_desktop.Step();
+        m_renderMicros.fetch_add(StatsNowMicros() - start, std::memory_order_relaxed);
+
+        for (const Rect& rect : changed) {
+            Rect aligned = AlignToChromaBlocks(rect);
+            if (m_format == 2) ConvertRect(aligned);
+            m_pendingRects.push_back(ToFrameRect(aligned));
+        }
+        if (m_pendingRects.size() > kMaxPendingRects) {
+            m_pendingRects.assign(1, Rect{0, 0, m_frameWidth, m_frameHeight});
+        }
+        if (m_pendingRects.empty() && m_latest) return m_latest;
+
+        // All pooled frames still in use: keep the changes for the next call
+        const uint8* source = m_format == 2 ? m_frameBuffer.data() : m_desktop.GetPixels();
+        size_t size = m_format == 2 ? m_frameBuffer.size() : static_cast<size_t>(m_frameStride) * m_frameHeight;
+        std::shared_ptr<PooledFrame> frame = m_framePool.Acquire(size);
+        if (!frame) return m_latest;
+
+        std::memcpy(frame->data, source, size);
+        frame->width = m_frameWidth;
+        frame->height = m_frameHeight;
+        frame->stride = m_frameStride;
+        frame->format = m_format;
+        frame->timestamp = StatsNowMicros();
+        frame->sequence = ++m_sequence;
+        frame->hasDamageInfo = true;
+        frame->dirtyRects.assign(m_pendingRects.begin(), m_pendingRects.end());
+        frame->dirtyTiles.Resize(m_frameWidth, m_frameHeight, kTileSize);
+        for (const Rect& rect : m_pendingRects) frame->dirtyTiles.MarkRect(rect);
+        m_pendingRects.clear();
+
+        FrameTracer& tracer = FrameTracer::Instance();
+        tracer.BeginFrame(frame->sequence, start);
+        tracer.Mark(frame->sequence, TraceStage::CaptureEnd, frame->timestamp);
+        m_captured.Record(size);
+        m_latest = frame;
+        return m_latest;
+    }
+
+    std::vector<std::pair<uint32, uint32>> SyntheticScreenCapture::GetMonitorResolutions() {
+        return {{m_desktop.GetWidth(), m_desktop.GetHeight()}};
+    }
+
+    bool SyntheticScreenCapture::SetOutputFormat(uint32 format, bool halfSize) {
+        if (m_capturing) {
+            std::cerr << "Output format must be set before capture starts" << std::endl;
+            return false;
+        }
+        // Halving is part of the YUV conversion
+        if (format != 2 && (format != 0 || halfSize)) return false;
+
+        m_format = format;
+        m_scale = halfSize ? 2 : 1;
+        ConfigureOutput();
+        return true;
+    }
+
+    bool SyntheticScreenCapture::SetFrameRate(uint32 fps) {
+        // Steps are taken in GetLatestFrame, at the caller's pace
+        (void)fps;
+        return false;
+    }
+
+    void SyntheticScreenCapture::SetCaptureRegion(uint32 x, uint32 y, uint32 width, uint32 height) {
+        (void)x; (void)y; (void)width; (void)height;
+    }
+
+    CaptureStats SyntheticScreenCapture::GetStats() {
+        return {m_captured.GetItems(), m_captured.GetBytes(), m_captured.GetRates().itemsPerSecond,
+                m_captured.GetLastMillis()};
+    }
+
+    std::string SyntheticScreenCapture::GetBackendName() const {
+        std::string name = std::string("Synthetic (") + GetSyntheticWorkloadName(m_desktop.GetWorkload()) + ")";
+        if (m_format == 2) name += m_scale == 2 ? ", YUV420 at half size" : ", YUV420";
+        return name;
+    }
+
+    // Size the output for the format and start over from a full frame
+    void SyntheticScreenCapture::ConfigureOutput() {
+        m_frameWidth = (m_desktop.GetWidth() + m_scale - 1) / m_scale;
+        m_frameHeight = (m_desktop.GetHeight() + m_scale - 1) / m_scale;
+        if (m_format == 2) {
+            m_frameStride = (m_frameWidth + 7) & ~7u;
+            m_frameBuffer.assign(VideoFrame::GetYuv420Size(m_frameStride, m_frameHeight), 0);
+            if (!m_yuvConverter) m_yuvConverter = std::make_unique<YuvConverter>();
+            m_yuvConverter->SetHalfSize(m_scale == 2);
+            ConvertRect({0, 0, m_desktop.GetWidth(), m_desktop.GetHeight()});
+        } else {
+            m_frameStride = m_frameWidth * 4;
+            m_frameBuffer.clear();
+            m_yuvConverter.reset();
+        }
+        m_latest.reset();
+        m_pendingRects.assign(1, Rect{0, 0, m_frameWidth, m_frameHeight});
+    }
+
+    Rect SyntheticScreenCapture::AlignToChromaBlocks(const Rect& rect) const {
+        if (m_format != 2) return rect;
+        const int32 block = static_cast<int32>(m_scale * 2);
+        const int32 width = static_cast<int32>(m_desktop.GetWidth());
+        const int32 height = static_cast<int32>(m_desktop.GetHeight());
+        int32 x0 = rect.x / block * block;
+        int32 y0 = rect.y / block * block;
+        int32 x1 = std::min<int32>((rect.x + static_cast<int32>(rect.width) + block - 1) / block * block, width);
+        int32 y1 = std::min<int32>((rect.y + static_cast<int32>(rect.height) + block - 1) / block * block, height);
+        return {x0, y0, static_cast<uint32>(x1 - x0), static_cast<uint32>(y1 - y0)};
+    }
+
+    Rect SyntheticScreenCapture::ToFrameRect(const Rect& rect) const {
+        if (m_scale == 1) return rect;
+        int32 x0 = rect.x / static_cast<int32>(m_scale);
+        int32 y0 = rect.y / static_cast<int32>(m_scale);
+        uint32 x1 = (rect.x + rect.width + m_scale - 1) / m_scale;
+        uint32 y1 = (rect.y + rect.height + m_scale - 1) / m_scale;
+        return {x0, y0, x1 - x0, y1 - y0};
+    }
+
+    // Convert a screen rectangle on chroma block boundaries into m_frameBuffer
+    void SyntheticScreenCapture::ConvertRect(const Rect& rect) {
+        VideoFrame view;
+        view.data = m_frameBuffer.data();
+        view.width = m_frameWidth;
+        view.height = m_frameHeight;
+        view.stride = m_frameStride;
+        view.format = 2;
+        YuvImage planes = GetYuv420Planes(view);
+
+        const uint32 x = rect.x / m_scale, y = rect.y / m_scale;
+        planes.y += static_cast<size_t>(y) * planes.yStride + x;
+        planes.u += static_cast<size_t>(y / 2) * planes.uStride + x / 2;
+        planes.v += static_cast<size_t>(y / 2) * planes.vStride + x / 2;
+        const uint8* source = m_desktop.GetPixels() + static_cast<size_t>(rect.y) * m_desktop.GetStride() + rect.x * 4;
+        m_yuvConverter->Convert(source, m_desktop.GetStride(), rect.width, rect.height, planes);
+    }
+
+} // namespace SplashTop
@@ -0,0 +1,335 @@
+#include "tile_change_detector.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SPLASHTOP_X86_SIMD 1
+    #include <immintrin.h>
+#endif
+
+namespace SplashTop {
+
+    namespace {
+
+        // Stripe-based multiply-accumulate hash in the style of XXH3. Each row
+        // is consumed in 32-byte stripes (four 64-bit lanes), keyed by the
+        // stripe position, and the accumulators are scrambled after every row
+        // so that moved content changes the hash.
+        constexpr uint32 kStripeBytes = 32;
+        constexpr uint32 kKeyStripes = 8;
+        constexpr uint64 kPrime32 = 0x9E3779B1ull;
+        constexpr uint64 kPrime64A = 0x9E3779B185EBCA87ull;
+        constexpr uint64 kPrime64B = 0xC2B2AE3D27D4EB4Full;
+
+        struct HashSecret {
+            uint64 keys[kKeyStripes * 4];
+
+            constexpr HashSecret() : keys() {
+                uint64 state = 0x5AD1C0DE5EED1234ull;
+                for (uint32 i = 0; i < kKeyStripes * 4; i++) {
+                    // splitmix64
+                    state += 0x9E3779B97F4A7C15ull;
+                    uint64 z = state;
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                    keys[i] = z ^ (z >> 31);
+                }
+            }
+        };
+
+        constexpr HashSecret kSecret;
+
+        inline const uint64* StripeKey(uint32 stripe) {
+            return kSecret.keys + (stripe % kKeyStripes) * 4;
+        }
+
+        inline void InitAccumulators(uint64 acc[4]) {
+            acc[0] = kPrime32;
+            acc[1] = kPrime64A;
+            acc[2] = kPrime64B;
+            acc[3] = kPrime64A ^ kPrime64B;
+        }
+
+        inline uint64 Avalanche(uint64 h) {
+            h ^= h >> 37;
+            h *= 0x165667919E3779F9ull;
+            h ^= h >> 32;
+            return h;
+        }
+
+        uint64 FinishHash(const uint64 acc[4], uint32 width, uint32 height) {
+            uint64 h = (static_cast<uint64>(width) << 32 | height) * kPrime64A;
+            for (int i = 0; i < 4; i++) {
+                h = Avalanche(h ^ (acc[i] * kPrime64B));
+            }
+            return h;
+        }
+
+        // Load the trailing bytes of a row into a zero-padded stripe
+        inline void LoadTail(uint8 stripe[kStripeBytes], const uint8* src, uint32 bytes) {
+            std::memset(stripe, 0, kStripeBytes);
+            std::memcpy(stripe, src, bytes);
+        }
+
+        inline void AccumulateScalar(uint64 acc[4], const uint8* stripe, const uint64* key) {
+            uint64 data[4];
+            std::memcpy(data, stripe, sizeof(data));
+            for (int i = 0; i < 4; i++) {
+                uint64 keyed = data[i] ^ key[i];
+                acc[i] += data[i ^ 1] + (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+            }
+        }
+
+        inline void ScrambleScalar(uint64 acc[4], const uint64* key) {
+            for (int i = 0; i < 4; i++) {
+                acc[i] ^= acc[i] >> 47;
+                acc[i] ^= key[i];
+                acc[i] *= kPrime32;
+            }
+        }
+
+        uint64 HashTileScalar(const uint8* data, uint32 stride, uint32 width, uint32 height) {
+            uint64 acc[4];
+            InitAccumulators(acc);
+
+            const uint32 rowBytes = width * 4;
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+                uint32 stripe = 0;
+                uint32 offset = 0;
+                for (; offset + kStripeBytes <= rowBytes; offset += kStripeBytes, stripe++) {
+                    AccumulateScalar(acc, row + offset, StripeKey(stripe));
+                }
+                if (offset < rowBytes) {
+                    uint8 tail[kStripeBytes];
+                    LoadTail(tail, row + offset, rowBytes - offset);
+                    AccumulateScalar(acc, tail, StripeKey(stripe));
+                }
+                ScrambleScalar(acc, StripeKey(y));
+            }
+            return FinishHash(acc, width, height);
+        }
+
+#ifdef SPLASHTOP_X86_SIMD
+
+        __attribute__((target("sse2")))
+        inline __m128i AccumulateSSE2(__m128i acc, __m128i data, __m128i key) {
+            __m128i keyed = _mm_xor_si128(data, key);
+            __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+            __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            return _mm_add_epi64(acc, _mm_add_epi64(swapped, product));
+        }
+
+        __attribute__((target("sse2")))
+        inline __m128i ScrambleSSE2(__m128i acc, __m128i key) {
+            const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32));
+            acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+            acc = _mm_xor_si128(acc, key);
+            __m128i lo = _mm_mul_epu32(acc, prime);
+            __m128i hi = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+            return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+        }
+
+        __attribute__((target("sse2")))
+        uint64 HashTileSSE2(const uint8* data, uint32 stride, uint32 width, uint32 height) {
+            alignas(16) uint64 acc[4];
+            InitAccumulators(acc);
+            __m128i acc0 = _mm_load_si128(reinterpret_cast<const __m128i*>(acc));
+            __m128i acc1 = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + 2));
+
+            const uint32 rowBytes = width * 4;
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+                uint32 stripe = 0;
+                uint32 offset = 0;
+                for (; offset + kStripeBytes <= rowBytes; offset += kStripeBytes, stripe++) {
+                    const uint64* key = StripeKey(stripe);
+                    acc0 = AccumulateSSE2(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + offset)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(key)));
+                    acc1 = AccumulateSSE2(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + offset + 16)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 2)));
+                }
+                if (offset < rowBytes) {
+                    alignas(16) uint8 tail[kStripeBytes];
+                    LoadTail(tail, row + offset, rowBytes - offset);
+                    const uint64* key = StripeKey(stripe);
+                    acc0 = AccumulateSSE2(acc0, _mm_load_si128(reinterpret_cast<const __m128i*>(tail)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(key)));
+                    acc1 = AccumulateSSE2(acc1, _mm_load_si128(reinterpret_cast<const __m128i*>(tail + 16)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 2)));
+                }
+                const uint64* rowKey = StripeKey(y);
+                acc0 = ScrambleSSE2(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowKey)));
+                acc1 = ScrambleSSE2(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowKey + 2)));
+            }
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(acc), acc0);
+            _mm_store_si128(reinterpret_cast<__m128i*>(acc + 2), acc1);
+            return FinishHash(acc, width, height);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i AccumulateAVX2(__m256i acc, __m256i data, __m256i key) {
+            __m256i keyed = _mm256_xor_si256(data, key);
+            __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+            __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            return _mm256_add_epi64(acc, _mm256_add_epi64(swapped, product));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i ScrambleAVX2(__m256i acc, __m256i key) {
+            const __m256i prime = _mm256_set1_epi32(static_cast<int>(kPrime32));
+            acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+            acc = _mm256_xor_si256(acc, key);
+            __m256i lo = _mm256_mul_epu32(acc, prime);
+            __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+            return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+        }
+
+        __attribute__((target("avx2")))
+        uint64 HashTileAVX2(const uint8* data, uint32 stride, uint32 width, uint32 height) {
+            alignas(32) uint64 acc[4];
+            InitAccumulators(acc);
+            __m256i accVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc));
+
+            const uint32 rowBytes = width * 4;
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+                uint32 stripe = 0;
+                uint32 offset = 0;
+                for (; offset + kStripeBytes <= rowBytes; offset += kStripeBytes, stripe++) {
+                    accVec = AccumulateAVX2(accVec, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + offset)),
+                                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(StripeKey(stripe))));
+                }
+                if (offset < rowBytes) {
+                    alignas(32) uint8 tail[kStripeBytes];
+                    LoadTail(tail, row + offset, rowBytes - offset);
+                    accVec = AccumulateAVX2(accVec, _mm256_load_si256(reinterpret_cast<const __m256i*>(tail)),
+                                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(StripeKey(stripe))));
+                }
+                accVec = ScrambleAVX2(accVec, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(StripeKey(y))));
+            }
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(acc), accVec);
+            return FinishHash(acc, width, height);
+        }
+
+#endif // SPLASHTOP_X86_SIMD
+
+    } // namespace
+
+    uint64 HashTile(PixelKernel kernel, const uint8* data, uint32 stride, uint32 width, uint32 height) {
+#ifdef SPLASHTOP_X86_SIMD
+        if (kernel == PixelKernel::AVX2 && IsPixelKernelAvailable(PixelKernel::AVX2)) {
+            return HashTileAVX2(data, stride, width, height);
+        }
+        if (kernel == PixelKernel::SSE2 && IsPixelKernelAvailable(PixelKernel::SSE2)) {
+            return HashTileSSE2(data, stride, width, height);
+        }
+#else
+        (void)kernel;
+#endif
+        return HashTileScalar(data, stride, width, height);
+    }
+
+    namespace {
+
+        // Hash the Y, U and V blocks of one tile of a YUV420 frame. Plane rows
+        // are hashed in 32-bit words, reading into the stride padding at the
+        // right edge, which is why Detect requires stride % 8 == 0.
+        uint64 HashYuv420Tile(PixelKernel kernel, const VideoFrame& frame, uint32 x, uint32 y,
+                              uint32 width, uint32 height) {
+            const uint32 chromaStride = frame.stride / 2;
+            const uint32 cx = x / 2, cy = y / 2;
+            const uint32 chromaWidth = (x + width + 1) / 2 - cx;
+            const uint32 chromaHeight = (y + height + 1) / 2 - cy;
+
+            uint64 hash = HashTile(kernel, frame.data + static_cast<size_t>(y) * frame.stride + x,
+                                   frame.stride, (width + 3) / 4, height);
+            const size_t chromaOffset = static_cast<size_t>(cy) * chromaStride + cx;
+            uint64 u = HashTile(kernel, frame.GetUPlane() + chromaOffset, chromaStride, (chromaWidth + 3) / 4, chromaHeight);
+            uint64 v = HashTile(kernel, frame.GetVPlane() + chromaOffset, chromaStride, (chromaWidth + 3) / 4, chromaHeight);
+            hash ^= (u + 0x9E3779B97F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+            hash ^= (v + 0x165667B19E3779F9ull) * 0x9E3779B185EBCA87ull;
+            return hash;
+        }
+
+    } // namespace
+
+    TileChangeDetector::TileChangeDetector(uint32 tileSize)
+        : m_tileSize(tileSize), m_width(0), m_height(0), m_kernel(GetBestPixelKernel()) {
+    }
+
+    void TileChangeDetector::Reset() {
+        m_width = 0;
+        m_height = 0;
+        m_hashes.clear();
+    }
+
+    void TileChangeDetector::SetKernel(PixelKernel kernel) {
+        m_kernel = IsPixelKernelAvailable(kernel) ? kernel : PixelKernel::Scalar;
+    }
+
+    uint32 TileChangeDetector::Detect(const VideoFrame& frame, DirtyTileMap& dirtyTiles) {
+        if (dirtyTiles.tileSize != m_tileSize ||
+            dirtyTiles.tilesX != (frame.width + m_tileSize - 1) / m_tileSize ||
+            dirtyTiles.tilesY != (frame.height + m_tileSize - 1) / m_tileSize) {
+            dirtyTiles.Resize(frame.width, frame.height, m_tileSize);
+        } else {
+            dirtyTiles.Clear();
+        }
+
+        // Packed 32-bit frames, and YUV420 frames whose plane rows can be
+        // read in whole 32-bit words, can be hashed
+        const bool yuv = frame.format == 2;
+        if (!frame.data || (yuv && frame.stride % 8 != 0)) {
+            dirtyTiles.SetAll();
+            return dirtyTiles.CountDirty();
+        }
+
+        bool firstFrame = frame.width != m_width || frame.height != m_height || m_hashes.empty();
+        if (firstFrame) {
+            m_width = frame.width;
+            m_height = frame.height;
+            m_hashes.assign(static_cast<size_t>(dirtyTiles.tilesX) * dirtyTiles.tilesY, 0);
+        }
+
+        // With damage info only the damaged tiles can have changed
+        bool useCandidates = frame.hasDamageInfo && !firstFrame;
+        if (useCandidates) {
+            if (m_candidates.tilesX != dirtyTiles.tilesX || m_candidates.tilesY != dirtyTiles.tilesY) {
+                m_candidates.Resize(frame.width, frame.height, m_tileSize);
+            } else {
+                m_candidates.Clear();
+            }
+            for (const auto& rect : frame.dirtyRects) m_candidates.MarkRect(rect);
+        }
+
+        uint32 dirtyCount = 0;
+        for (uint32 ty = 0; ty < dirtyTiles.tilesY; ty++) {
+            uint32 y = ty * m_tileSize;
+            uint32 tileHeight = std::min(m_tileSize, frame.height - y);
+            for (uint32 tx = 0; tx < dirtyTiles.tilesX; tx++) {
+                if (useCandidates && !m_candidates.IsDirty(tx, ty)) continue;
+
+                uint32 x = tx * m_tileSize;
+                uint32 tileWidth = std::min(m_tileSize, frame.width - x);
+                uint64 hash;
+                if (yuv) {
+                    hash = HashYuv420Tile(m_kernel, frame, x, y, tileWidth, tileHeight);
+                } else {
+                    const uint8* tile = frame.data + static_cast<size_t>(y) * frame.stride + x * 4;
+                    hash = HashTile(m_kernel, tile, frame.stride, tileWidth, tileHeight);
+                }
+
+                uint64& previous = m_hashes[static_cast<size_t>(ty) * dirtyTiles.tilesX + tx];
+                if (firstFrame || hash != previous) {
+                    previous = hash;
+                    dirtyTiles.SetDirty(tx, ty);
+                    dirtyCount++;
+                }
+            }
+        }
+        return dirtyCount;
+    }
+
+} // namespace SplashTop
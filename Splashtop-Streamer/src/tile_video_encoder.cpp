@@ -0,0 +1,747 @@
+#include "tile_video_encoder.h"
+#include "codec_registry.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SPLASHTOP_X86_SIMD 1
+    #include <immintrin.h>
+#endif
+
+namespace SplashTop {
+
+    namespace {
+
+        constexpr uint32 kTileMagic = 0x31545453; // "STT1"
+        constexpr uint8 kFlagKeyframe = 1;
+        constexpr size_t kHeaderSize = 28;
+        constexpr uint32 kColorMask = 0x00FFFFFF;
+
+        const VideoCodecRegistration kTileRegistration(
+            {"tile", "Lossless tiles for text and UI", 50, false, true, true},
+            [] { return std::make_unique<TileVideoEncoder>(); });
+
+        inline uint32 LoadColor(const uint8* pixel) {
+            uint32 value;
+            std::memcpy(&value, pixel, 4);
+            return value & kColorMask;
+        }
+
+        inline void PutU16(std::vector<uint8>& out, uint32 value) {
+            out.push_back(static_cast<uint8>(value));
+            out.push_back(static_cast<uint8>(value >> 8));
+        }
+
+        inline void PutU32(std::vector<uint8>& out, uint32 value) {
+            PutU16(out, value & 0xFFFF);
+            PutU16(out, value >> 16);
+        }
+
+        inline void StoreU32(uint8* dst, uint32 value) {
+            for (int i = 0; i < 4; i++) dst[i] = static_cast<uint8>(value >> (8 * i));
+        }
+
+        // Tile data is written through a cursor into space reserved up front
+        inline void PutColor(uint8*& out, uint32 color) {
+            out[0] = static_cast<uint8>(color);
+            out[1] = static_cast<uint8>(color >> 8);
+            out[2] = static_cast<uint8>(color >> 16);
+            out += 3;
+        }
+
+        inline void PutRunLength(uint8*& out, uint32 length) {
+            uint32 value = length - 1;
+            for (; value >= 255; value -= 255) *out++ = 255;
+            *out++ = static_cast<uint8>(value);
+        }
+
+        // Largest possible encoding of a tile: RLE with every run one pixel
+        // long, plus a palette and the bytes long runs need
+        inline size_t MaxTileBytes(size_t pixels) {
+            return 2 + 3 * TilePalette::kMaxColors + pixels * 4 + pixels / 255;
+        }
+
+        // Adds a color to the palette, or marks it as overflowing
+        inline void AddColorScalar(TilePalette& palette, uint32 color) {
+            for (uint32 i = 0; i < palette.count; i++) {
+                if (palette.colors[i] == color) return;
+            }
+            if (palette.count < TilePalette::kMaxColors) palette.colors[palette.count] = color;
+            palette.count++;
+        }
+
+        inline void AddRunStart(TilePalette& palette, uint32 color) {
+            palette.runs++;
+            if (palette.HasPalette()) AddColorScalar(palette, color);
+        }
+
+        void AnalyzeTileScalar(const uint8* data, uint32 stride, uint32 width, uint32 height, TilePalette& palette) {
+            palette.Reset();
+            uint32 previous = TilePalette::kUnusedColor;
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+                for (uint32 x = 0; x < width; x++) {
+                    uint32 color = LoadColor(row + x * 4);
+                    if (color == previous) continue;
+                    previous = color;
+                    AddRunStart(palette, color);
+                }
+            }
+        }
+
+#ifdef SPLASHTOP_X86_SIMD
+
+        // The palette is searched a vector of entries at a time; unused
+        // entries never match because colors have their alpha byte cleared
+
+        __attribute__((target("sse2")))
+        inline void AddColorSSE2(TilePalette& palette, uint32 color) {
+            const __m128i needle = _mm_set1_epi32(static_cast<int>(color));
+            for (uint32 i = 0; i < palette.count; i += 4) {
+                __m128i entries = _mm_load_si128(reinterpret_cast<const __m128i*>(palette.colors + i));
+                if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(entries, needle)))) return;
+            }
+            if (palette.count < TilePalette::kMaxColors) palette.colors[palette.count] = color;
+            palette.count++;
+        }
+
+        // Run starts are found by comparing each pixel with its left
+        // neighbour; only those pixels are looked up in the palette
+        __attribute__((target("sse2")))
+        void AnalyzeTileSSE2(const uint8* data, uint32 stride, uint32 width, uint32 height, TilePalette& palette) {
+            palette.Reset();
+            const __m128i mask = _mm_set1_epi32(static_cast<int>(kColorMask));
+            uint32 previous = TilePalette::kUnusedColor;
+
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+
+                // The first pixel continues the run from the end of the previous row
+                uint32 color = LoadColor(row);
+                if (color != previous) AddRunStart(palette, color);
+
+                uint32 x = 1;
+                for (; x + 4 <= width; x += 4) {
+                    __m128i current = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4)), mask);
+                    __m128i left = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + (x - 1) * 4)), mask);
+                    uint32 starts = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(current, left))) & 0xF;
+                    if (!starts) continue;
+
+                    palette.runs += __builtin_popcount(starts);
+                    if (!palette.HasPalette()) continue;
+                    for (; starts && palette.HasPalette(); starts &= starts - 1) {
+                        AddColorSSE2(palette, LoadColor(row + (x + __builtin_ctz(starts)) * 4));
+                    }
+                }
+
+                previous = LoadColor(row + (x - 1) * 4);
+                for (; x < width; x++) {
+                    color = LoadColor(row + x * 4);
+                    if (color == previous) continue;
+                    previous = color;
+                    AddRunStart(palette, color);
+                }
+            }
+        }
+
+        __attribute__((target("avx2")))
+        inline void AddColorAVX2(TilePalette& palette, uint32 color) {
+            const __m256i needle = _mm256_set1_epi32(static_cast<int>(color));
+            for (uint32 i = 0; i < palette.count; i += 8) {
+                __m256i entries = _mm256_load_si256(reinterpret_cast<const __m256i*>(palette.colors + i));
+                if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(entries, needle)))) return;
+            }
+            if (palette.count < TilePalette::kMaxColors) palette.colors[palette.count] = color;
+            palette.count++;
+        }
+
+        __attribute__((target("avx2")))
+        void AnalyzeTileAVX2(const uint8* data, uint32 stride, uint32 width, uint32 height, TilePalette& palette) {
+            palette.Reset();
+            const __m256i mask = _mm256_set1_epi32(static_cast<int>(kColorMask));
+            uint32 previous = TilePalette::kUnusedColor;
+
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+
+                uint32 color = LoadColor(row);
+                if (color != previous) AddRunStart(palette, color);
+
+                uint32 x = 1;
+                for (; x + 8 <= width; x += 8) {
+                    __m256i current = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x * 4)), mask);
+                    __m256i left = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + (x - 1) * 4)), mask);
+                    uint32 starts = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(current, left))) & 0xFF;
+                    if (!starts) continue;
+
+                    palette.runs += __builtin_popcount(starts);
+                    if (!palette.HasPalette()) continue;
+                    for (; starts && palette.HasPalette(); starts &= starts - 1) {
+                        AddColorAVX2(palette, LoadColor(row + (x + __builtin_ctz(starts)) * 4));
+                    }
+                }
+
+                previous = LoadColor(row + (x - 1) * 4);
+                for (; x < width; x++) {
+                    color = LoadColor(row + x * 4);
+                    if (color == previous) continue;
+                    previous = color;
+                    AddRunStart(palette, color);
+                }
+            }
+        }
+
+#endif // SPLASHTOP_X86_SIMD
+
+        inline uint8 FindIndex(const TilePalette& palette, uint32 color) {
+            for (uint32 i = 0; i < palette.count; i++) {
+                if (palette.colors[i] == color) return static_cast<uint8>(i);
+            }
+            return 0;
+        }
+
+        inline uint32 PaletteBits(uint32 colors) {
+            return colors <= 2 ? 1 : (colors <= 4 ? 2 : 4);
+        }
+
+        void PutPalette(uint8*& out, const TilePalette& palette) {
+            *out++ = static_cast<uint8>(palette.count);
+            for (uint32 i = 0; i < palette.count; i++) PutColor(out, palette.colors[i]);
+        }
+
+        void EncodePackedPalette(const uint8* data, uint32 stride, uint32 width, uint32 height,
+                                 const TilePalette& palette, uint8*& out) {
+            PutPalette(out, palette);
+            const uint32 bits = PaletteBits(palette.count);
+            uint32 previous = TilePalette::kUnusedColor;
+            uint8 index = 0;
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+                uint32 packed = 0, used = 0;
+                for (uint32 x = 0; x < width; x++) {
+                    uint32 color = LoadColor(row + x * 4);
+                    if (color != previous) {
+                        index = FindIndex(palette, color);
+                        previous = color;
+                    }
+                    packed = (packed << bits) | index;
+                    used += bits;
+                    if (used == 8) {
+                        *out++ = static_cast<uint8>(packed);
+                        packed = used = 0;
+                    }
+                }
+                if (used) *out++ = static_cast<uint8>(packed << (8 - used));
+            }
+        }
+
+        // Walk the tile in row-major order, calling emit(color, length) per run
+        template <typename Emit>
+        void ForEachRun(const uint8* data, uint32 stride, uint32 width, uint32 height, Emit emit) {
+            uint32 current = LoadColor(data);
+            uint32 length = 0;
+            for (uint32 y = 0; y < height; y++) {
+                const uint8* row = data + static_cast<size_t>(y) * stride;
+                for (uint32 x = 0; x < width; x++) {
+                    uint32 color = LoadColor(row + x * 4);
+                    if (color != current) {
+                        emit(current, length);
+                        current = color;
+                        length = 0;
+                    }
+                    length++;
+                }
+            }
+            emit(current, length);
+        }
+
+        // Tile records are decoded into a BGRA image with opaque alpha
+        struct ByteReader {
+            const uint8* data;
+            size_t size;
+            size_t pos = 0;
+
+            bool Has(size_t bytes) const { return size - pos >= bytes; }
+            uint8 U8() { return data[pos++]; }
+            uint32 U16() { uint32 v = data[pos] | (data[pos + 1] << 8); pos += 2; return v; }
+            uint32 U32() { uint32 v = U16(); return v | (U16() << 16); }
+            uint32 Color() { uint32 v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16); pos += 3; return v | 0xFF000000; }
+
+            bool RunLength(uint32 limit, uint32& length) {
+                length = 1;
+                while (Has(1)) {
+                    uint8 value = U8();
+                    length += value;
+                    if (length > limit) return false;
+                    if (value != 255) return true;
+                }
+                return false;
+            }
+        };
+
+        inline void StorePixel(uint8* tile, uint32 stride, uint32 width, uint32 position, uint32 color) {
+            std::memcpy(tile + static_cast<size_t>(position / width) * stride + (position % width) * 4, &color, 4);
+        }
+
+        bool ReadPalette(ByteReader& reader, uint32 colors[TilePalette::kMaxColors], uint32& count) {
+            if (!reader.Has(1)) return false;
+            count = reader.U8();
+            if (count == 0 || count > TilePalette::kMaxColors || !reader.Has(count * 3)) return false;
+            for (uint32 i = 0; i < count; i++) colors[i] = reader.Color();
+            return true;
+        }
+
+        bool DecodeTile(ByteReader& reader, uint8* tile, uint32 stride, uint32 width, uint32 height) {
+            if (!reader.Has(1)) return false;
+            const uint32 pixels = width * height;
+            uint32 colors[TilePalette::kMaxColors];
+            uint32 count = 0;
+
+            switch (static_cast<TileEncoding>(reader.U8())) {
+                case TileEncoding::Solid: {
+                    if (!reader.Has(3)) return false;
+                    uint32 color = reader.Color();
+                    for (uint32 i = 0; i < pixels; i++) StorePixel(tile, stride, width, i, color);
+                    return true;
+                }
+                case TileEncoding::PackedPalette: {
+                    if (!ReadPalette(reader, colors, count) || count > 16) return false;
+                    const uint32 bits = PaletteBits(count);
+                    const uint32 rowBytes = (width * bits + 7) / 8;
+                    if (!reader.Has(static_cast<size_t>(rowBytes) * height)) return false;
+                    for (uint32 y = 0; y < height; y++) {
+                        const uint8* packed = reader.data + reader.pos + static_cast<size_t>(y) * rowBytes;
+                        uint32* row = reinterpret_cast<uint32*>(tile + static_cast<size_t>(y) * stride);
+                        for (uint32 x = 0; x < width; x++) {
+                            uint32 bit = x * bits;
+                            uint32 index = (packed[bit / 8] >> (8 - bits - bit % 8)) & ((1u << bits) - 1);
+                            if (index >= count) return false;
+                            row[x] = colors[index];
+                        }
+                    }
+                    reader.pos += static_cast<size_t>(rowBytes) * height;
+                    return true;
+                }
+                case TileEncoding::PaletteRLE: {
+                    if (!ReadPalette(reader, colors, count)) return false;
+                    for (uint32 position = 0; position < pixels;) {
+                        if (!reader.Has(1)) return false;
+                        uint8 value = reader.U8();
+                        uint32 index = value & 0x7F;
+                        uint32 length = 1;
+                        if (index >= count) return false;
+                        if ((value & 0x80) && !reader.RunLength(pixels - position, length)) return false;
+                        if (length > pixels - position) return false;
+                        for (uint32 i = 0; i < length; i++) StorePixel(tile, stride, width, position++, colors[index]);
+                    }
+                    return true;
+                }
+                case TileEncoding::PlainRLE: {
+                    for (uint32 position = 0; position < pixels;) {
+                        if (!reader.Has(3)) return false;
+                        uint32 color = reader.Color();
+                        uint32 length;
+                        if (!reader.RunLength(pixels - position, length)) return false;
+                        for (uint32 i = 0; i < length; i++) StorePixel(tile, stride, width, position++, color);
+                    }
+                    return true;
+                }
+                case TileEncoding::Raw: {
+                    if (!reader.Has(static_cast<size_t>(pixels) * 3)) return false;
+                    for (uint32 i = 0; i < pixels; i++) StorePixel(tile, stride, width, i, reader.Color());
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    } // namespace
+
+    void AnalyzeTile(PixelKernel kernel, const uint8* data, uint32 stride, uint32 width, uint32 height,
+                     TilePalette& palette) {
+#ifdef SPLASHTOP_X86_SIMD
+        if (kernel == PixelKernel::AVX2 && IsPixelKernelAvailable(PixelKernel::AVX2)) {
+            return AnalyzeTileAVX2(data, stride, width, height, palette);
+        }
+        if (kernel == PixelKernel::SSE2 && IsPixelKernelAvailable(PixelKernel::SSE2)) {
+            return AnalyzeTileSSE2(data, stride, width, height, palette);
+        }
+#else
+        (void)kernel;
+#endif
+        AnalyzeTileScalar(data, stride, width, height, palette);
+    }
+
+    TileEncoding EncodeTile(const uint8* data, uint32 stride, uint32 width, uint32 height,
+                            const TilePalette& palette, std::vector<uint8>& out) {
+        const size_t pixels = static_cast<size_t>(width) * height;
+        const size_t offset = out.size();
+        out.resize(offset + MaxTileBytes(pixels));
+        uint8* cursor = out.data() + offset;
+
+        // Pick the smallest encoding from the color and run counts. RLE sizes
+        // are estimates since runs longer than 256 pixels take extra bytes.
+        const size_t paletteBytes = 1 + 3 * static_cast<size_t>(palette.count);
+        TileEncoding encoding = TileEncoding::Raw;
+        size_t best = pixels * 3;
+
+        auto consider = [&](TileEncoding candidate, size_t bytes) {
+            if (bytes < best) {
+                best = bytes;
+                encoding = candidate;
+            }
+        };
+        consider(TileEncoding::PlainRLE, static_cast<size_t>(palette.runs) * 4);
+        if (palette.HasPalette()) {
+            consider(TileEncoding::PaletteRLE, paletteBytes + static_cast<size_t>(palette.runs) * 2);
+            if (palette.count <= 16) {
+                size_t rowBytes = (static_cast<size_t>(width) * PaletteBits(palette.count) + 7) / 8;
+                consider(TileEncoding::PackedPalette, paletteBytes + rowBytes * height);
+            }
+        }
+
+        if (palette.count == 1) encoding = TileEncoding::Solid;
+
+        *cursor++ = static_cast<uint8>(encoding);
+        switch (encoding) {
+            case TileEncoding::Solid:
+                PutColor(cursor, palette.colors[0]);
+                break;
+            case TileEncoding::PackedPalette:
+                EncodePackedPalette(data, stride, width, height, palette, cursor);
+                break;
+            case TileEncoding::PaletteRLE:
+                PutPalette(cursor, palette);
+                ForEachRun(data, stride, width, height, [&](uint32 color, uint32 length) {
+                    uint8 index = FindIndex(palette, color);
+                    if (length == 1) {
+                        *cursor++ = index;
+                    } else {
+                        *cursor++ = index | 0x80;
+                        PutRunLength(cursor, length);
+                    }
+                });
+                break;
+            case TileEncoding::PlainRLE:
+                ForEachRun(data, stride, width, height, [&](uint32 color, uint32 length) {
+                    PutColor(cursor, color);
+                    PutRunLength(cursor, length);
+                });
+                break;
+            case TileEncoding::Raw:
+                for (uint32 y = 0; y < height; y++) {
+                    const uint8* row = data + static_cast<size_t>(y) * stride;
+                    for (uint32 x = 0; x < width; x++) PutColor(cursor, LoadColor(row + x * 4));
+                }
+                break;
+        }
+
+        out.resize(cursor - out.data());
+        return encoding;
+    }
+
+    TileVideoEncoder::TileVideoEncoder(uint32 tileSize)
+        : m_tileSize(tileSize), m_kernel(GetBestPixelKernel()), m_detector(tileSize) {
+    }
+
+    TileVideoEncoder::~TileVideoEncoder() {
+#ifdef HAVE_ZSTD
+        ZSTD_freeCCtx(m_zstd);
+#elif defined(HAVE_ZLIB)
+        if (m_zlibReady) deflateEnd(&m_zlib);
+#endif
+    }
+
+    bool TileVideoEncoder::Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) {
+        m_width = width;
+        m_height = height;
+        m_fps = fps;
+        m_bitrate = bitrate;
+        SetQuality(m_quality);
+
+#ifdef HAVE_ZSTD
+        if (!m_zstd) m_zstd = ZSTD_createCCtx();
+        if (!m_zstd) {
+            std::cerr << "Tile encoder: Failed to create zstd context" << std::endl;
+            return false;
+        }
+#elif defined(HAVE_ZLIB)
+        if (!m_zlibReady) {
+            // Higher zlib levels cost far more than zstd's for little gain
+            if (deflateInit(&m_zlib, Z_BEST_SPEED) != Z_OK) {
+                std::cerr << "Tile encoder: Failed to initialize zlib" << std::endl;
+                return false;
+            }
+            m_zlibReady = true;
+        }
+#endif
+
+        m_detector.Reset();
+        m_needsKeyframe = true;
+        m_initialized = true;
+        return true;
+    }
+
+    void TileVideoEncoder::SetQuality(uint32 quality) {
+        // The codec is lossless, so quality only buys compression effort
+        m_quality = quality;
+        m_compressionLevel = quality >= 67 ? 3 : (quality >= 34 ? 2 : 1);
+    }
+
+    void TileVideoEncoder::SetKernel(PixelKernel kernel) {
+        m_kernel = IsPixelKernelAvailable(kernel) ? kernel : PixelKernel::Scalar;
+        m_detector.SetKernel(m_kernel);
+    }
+
+    std::vector<std::string> TileVideoEncoder::GetSupportedCodecs() const {
+        return GetAvailableVideoCodecs();
+    }
+
+    EncoderStats TileVideoEncoder::GetStats() {
+        ThroughputMeter::Rates rates = m_encoded.GetRates();
+        return {m_encoded.GetItems(), m_encoded.GetBytes(), rates.bitsPerSecond,
+                rates.itemsPerSecond, m_encoded.GetLastMillis()};
+    }
+
+    bool TileVideoEncoder::FindChangedTiles(const VideoFrame& frame) {
+        if (frame.width != m_width || frame.height != m_height) {
+            m_width = frame.width;
+            m_height = frame.height;
+            m_needsKeyframe = true;
+        }
+        if (m_keyframeInterval && !m_intraRefresh && m_framesSinceKeyframe >= m_keyframeInterval) {
+            m_needsKeyframe = true;
+        }
+        if (m_keyframeRequested.exchange(false)) {
+            m_needsKeyframe = true;
+        }
+
+        const DirtyTileMap& captured = frame.dirtyTiles;
+        bool useCaptured = captured.IsValid() && captured.tileSize == m_tileSize &&
+                           captured.tilesX == (m_width + m_tileSize - 1) / m_tileSize &&
+                           captured.tilesY == (m_height + m_tileSize - 1) / m_tileSize;
+
+        // Prefer the capture's change map; otherwise hash the tiles ourselves
+        if (m_needsKeyframe) m_detector.Reset();
+        if (useCaptured) {
+            m_dirtyTiles.tileSize = captured.tileSize;
+            m_dirtyTiles.tilesX = captured.tilesX;
+            m_dirtyTiles.tilesY = captured.tilesY;
+            m_dirtyTiles.bits.assign(captured.bits.begin(), captured.bits.end());
+        } else {
+            m_detector.Detect(frame, m_dirtyTiles);
+        }
+
+        bool keyframe = m_needsKeyframe;
+        if (keyframe) {
+            m_dirtyTiles.SetAll();
+            m_framesSinceKeyframe = 0;
+            m_refreshColumn = 0;
+            m_needsKeyframe = false;
+        } else if (m_intraRefresh && m_dirtyTiles.tilesX) {
+            // Enough columns per frame to cover the screen once per period
+            uint32 period = m_keyframeInterval ? m_keyframeInterval : std::max<uint32>(1, m_fps * 2);
+            uint32 columns = (m_dirtyTiles.tilesX + period - 1) / period;
+            if (m_refreshColumn >= m_dirtyTiles.tilesX) m_refreshColumn = 0;
+            uint32 end = std::min(m_refreshColumn + columns, m_dirtyTiles.tilesX);
+            for (uint32 ty = 0; ty < m_dirtyTiles.tilesY; ty++) {
+                for (uint32 tx = m_refreshColumn; tx < end; tx++) m_dirtyTiles.SetDirty(tx, ty);
+            }
+            m_refreshColumn = end;
+        }
+        m_framesSinceKeyframe++;
+        return keyframe;
+    }
+
+    TileCompression TileVideoEncoder::Compress(std::vector<uint8>& out) {
+#if defined(HAVE_ZSTD) || defined(HAVE_ZLIB)
+        const size_t offset = out.size();
+        const size_t bytes = m_tileData.size();
+#endif
+
+#ifdef HAVE_ZSTD
+        size_t bound = ZSTD_compressBound(bytes);
+        out.resize(offset + bound);
+        size_t written = ZSTD_compressCCtx(m_zstd, out.data() + offset, bound, m_tileData.data(), bytes,
+                                           m_compressionLevel);
+        if (!ZSTD_isError(written) && written < bytes) {
+            out.resize(offset + written);
+            return TileCompression::Zstd;
+        }
+        out.resize(offset);
+#elif defined(HAVE_ZLIB)
+        uLong bound = deflateBound(&m_zlib, static_cast<uLong>(bytes));
+        out.resize(offset + bound);
+        deflateReset(&m_zlib);
+        m_zlib.next_in = const_cast<Bytef*>(m_tileData.data());
+        m_zlib.avail_in = static_cast<uInt>(bytes);
+        m_zlib.next_out = out.data() + offset;
+        m_zlib.avail_out = static_cast<uInt>(bound);
+        if (deflate(&m_zlib, Z_FINISH) == Z_STREAM_END && m_zlib.total_out < bytes) {
+            out.resize(offset + m_zlib.total_out);
+            return TileCompression::Zlib;
+        }
+        out.resize(offset);
+#endif
+
+        out.insert(out.end(), m_tileData.begin(), m_tileData.end());
+        return TileCompression::Stored;
+    }
+
+    void TileVideoEncoder::EncodeTiles(const VideoFrame& frame, const DirtyTileMap& tiles, uint32 tileY0, uint32 tileY1,
+                                       bool keyframe, std::vector<uint8>& out) {
+        m_tileData.clear();
+        uint32 tileCount = 0;
+        size_t rawTileBytes = 0;
+
+        for (uint32 ty = tileY0; ty < tileY1; ty++) {
+            uint32 y = ty * m_tileSize;
+            uint32 height = std::min(m_tileSize, frame.height - y);
+            for (uint32 tx = 0; tx < tiles.tilesX; tx++) {
+                if (!tiles.IsDirty(tx, ty)) continue;
+
+                uint32 x = tx * m_tileSize;
+                uint32 width = std::min(m_tileSize, frame.width - x);
+                const uint8* tile = frame.data + static_cast<size_t>(y) * frame.stride + x * 4;
+
+                AnalyzeTile(m_kernel, tile, frame.stride, width, height, m_palette);
+                PutU16(m_tileData, tx);
+                PutU16(m_tileData, ty);
+                size_t start = m_tileData.size();
+                if (EncodeTile(tile, frame.stride, width, height, m_palette, m_tileData) == TileEncoding::Raw) {
+                    rawTileBytes += m_tileData.size() - start;
+                }
+                tileCount++;
+            }
+        }
+
+        const size_t base = out.size();
+        PutU32(out, kTileMagic);
+        out.push_back(keyframe ? kFlagKeyframe : 0);
+        out.push_back(0); // Compression, set below
+        PutU16(out, m_tileSize);
+        PutU32(out, frame.width);
+        PutU32(out, frame.height);
+        PutU32(out, tileCount);
+        PutU32(out, static_cast<uint32>(m_tileData.size()));
+        PutU32(out, 0); // Payload size, set below
+
+        // Photo-like tiles barely compress, so mostly-raw messages skip the
+        // entropy stage rather than spend the CPU on it
+        if (rawTileBytes * 2 > m_tileData.size()) {
+            out.insert(out.end(), m_tileData.begin(), m_tileData.end());
+            out[base + 5] = static_cast<uint8>(TileCompression::Stored);
+        } else {
+            out[base + 5] = static_cast<uint8>(Compress(out));
+        }
+        StoreU32(out.data() + base + 24, static_cast<uint32>(out.size() - base - kHeaderSize));
+    }
+
+    bool TileVideoEncoder::EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) {
+        if (!m_initialized || !frame.data || frame.format == 2) return false;
+
+        bool keyframe = FindChangedTiles(frame);
+        encodedData.clear();
+        EncodeTiles(frame, m_dirtyTiles, 0, m_dirtyTiles.tilesY, keyframe, encodedData);
+
+        m_encoded.Record(encodedData.size());
+        return true;
+    }
+
+    bool TileVideoEncoder::EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) {
+        if (!m_initialized || !frame.data || frame.format == 2) return false;
+
+        packet.Reset(frame);
+        packet.keyframe = FindChangedTiles(frame);
+
+        // Each slice is a band of tile rows sent as its own message
+        uint32 count = std::max<uint32>(1, std::min(m_sliceCount, m_dirtyTiles.tilesY));
+
+        // Slices already handed out may be read by another thread while
+        // later ones are appended, so make room for the worst case up front:
+        // every tile at its largest, plus what compression can add
+        if (count > 1) {
+            size_t tileData = static_cast<size_t>(m_dirtyTiles.tilesX) * m_dirtyTiles.tilesY *
+                              (4 + MaxTileBytes(static_cast<size_t>(m_tileSize) * m_tileSize));
+            packet.data.reserve(tileData + tileData / 8 + count * (kHeaderSize + 1024));
+        }
+        for (uint32 i = 0; i < count; i++) {
+            uint32 tileY0 = m_dirtyTiles.tilesY * i / count;
+            uint32 tileY1 = m_dirtyTiles.tilesY * (i + 1) / count;
+            EncodeTiles(frame, m_dirtyTiles, tileY0, tileY1, packet.keyframe, packet.data);
+
+            EncodedSlice slice = packet.AddSlice(packet.data.size(), count);
+            if (onSlice) onSlice(slice);
+        }
+
+        m_encoded.Record(packet.data.size());
+        return true;
+    }
+
+    bool TileFrameDecoder::Decode(const uint8* data, size_t size) {
+        ByteReader reader{data, size};
+        if (!reader.Has(kHeaderSize) || reader.U32() != kTileMagic) return false;
+
+        uint8 flags = reader.U8();
+        TileCompression compression = static_cast<TileCompression>(reader.U8());
+        uint32 tileSize = reader.U16();
+        uint32 width = reader.U32();
+        uint32 height = reader.U32();
+        uint32 tileCount = reader.U32();
+        uint32 rawSize = reader.U32();
+        uint32 payloadSize = reader.U32();
+        if (tileSize == 0 || !reader.Has(payloadSize)) return false;
+
+        if (flags & kFlagKeyframe) {
+            if (width != m_width || height != m_height) {
+                m_width = width;
+                m_height = height;
+                m_image.assign(static_cast<size_t>(width) * height * 4, 0);
+            }
+        } else if (width != m_width || height != m_height) {
+            return false;
+        }
+
+        const uint8* payload = data + kHeaderSize;
+        switch (compression) {
+            case TileCompression::Stored:
+                if (payloadSize != rawSize) return false;
+                return DecodeTiles(payload, rawSize, tileSize, tileCount);
+#ifdef HAVE_ZSTD
+            case TileCompression::Zstd: {
+                m_payload.resize(rawSize);
+                size_t result = ZSTD_decompress(m_payload.data(), rawSize, payload, payloadSize);
+                if (ZSTD_isError(result) || result != rawSize) return false;
+                return DecodeTiles(m_payload.data(), rawSize, tileSize, tileCount);
+            }
+#elif defined(HAVE_ZLIB)
+            case TileCompression::Zlib: {
+                m_payload.resize(rawSize);
+                uLongf length = rawSize;
+                if (uncompress(m_payload.data(), &length, payload, payloadSize) != Z_OK || length != rawSize) return false;
+                return DecodeTiles(m_payload.data(), rawSize, tileSize, tileCount);
+            }
+#endif
+            default:
+                std::cerr << "Tile decoder: Unsupported compression " << static_cast<int>(compression) << std::endl;
+                return false;
+        }
+    }
+
+    bool TileFrameDecoder::DecodeTiles(const uint8* data, size_t size, uint32 tileSize, uint32 tileCount) {
+        ByteReader reader{data, size};
+        const uint32 stride = GetStride();
+        for (uint32 i = 0; i < tileCount; i++) {
+            if (!reader.Has(4)) return false;
+            uint32 x = reader.U16() * tileSize;
+            uint32 y = reader.U16() * tileSize;
+            if (x >= m_width || y >= m_height) return false;
+
+            uint8* tile = m_image.data() + static_cast<size_t>(y) * stride + x * 4;
+            if (!DecodeTile(reader, tile, stride, std::min(tileSize, m_width - x), std::min(tileSize, m_height - y))) {
+                return false;
+            }
+        }
+        return reader.pos == size;
+    }
+
+} // namespace SplashTop
@@ -1,5 +1,6 @@
 #include "webrtc_streamer.h"
 #include "platform.h"
+#include "stats.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -15,9 +16,11 @@ private:
     std::thread streamingThread;
     std::function<void(const InputEvent&)> inputCallback;
     std::function<void(bool connected)> connectionCallback;
+    std::function<void()> keyframeRequestCallback;
     uint32 targetFPS;
     uint32 targetBitrate;
     uint32 quality;
+    ThroughputMeter sent; // Frames and bytes since connecting
 
 public:
     SimpleWebRTCStreamer() : running(false), connected(false), targetFPS(30), 
@@ -38,7 +41,13 @@ public:
         // Simulate connection process
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
         
+        sent.Reset();
         connected = true;
+        
+        // The viewer's decoder starts with nothing to predict from
+        if (keyframeRequestCallback) {
+            keyframeRequestCallback();
+        }
         running = true;
         streamingThread = std::thread(&SimpleWebRTCStreamer::StreamingLoop, this);
         
@@ -57,7 +66,13 @@ public:
 
     bool SendVideoFrame(const VideoFrame& frame) override {
         // Simulate sending video frame
-        (void)frame;
+        sent.Record(static_cast<uint64>(frame.width) * frame.height * 4); // BGRA format
+        return true;
+    }
+
+    bool SendVideoSlice(const EncodedSlice& slice) override {
+        // Simulate sending an encoded slice
+        sent.Record(slice.size, slice.IsLastInFrame() ? 1 : 0);
         return true;
     }
 
@@ -69,9 +84,18 @@ public:
         connectionCallback = callback;
     }
 
+    void SetKeyframeRequestCallback(std::function<void()> callback) override {
+        keyframeRequestCallback = callback;
+    }
+
     StreamingStats GetStats() override {
+        ThroughputMeter::Rates rates = sent.GetRates();
         StreamingStats stats = {};
-        stats.framesSent = 0; // TODO: implement counter
+        stats.framesSent = sent.GetItems();
+        stats.bytesSent = sent.GetBytes();
+        stats.averageBitrate = rates.bitsPerSecond;
+        stats.averageFPS = rates.itemsPerSecond;
+        stats.lastFrameTime = sent.GetLastMillis();
         stats.isConnected = connected;
         return stats;
     }
@@ -2,6 +2,7 @@
 
 #include "platform.h"
 #include "webrtc_streamer.h"
+#include "stats.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -75,12 +76,17 @@ namespace SplashTop {
                 std::this_thread::sleep_for(std::chrono::milliseconds(250));
                 
                 m_connected = true;
-                m_connectionStartTime = std::chrono::steady_clock::now();
+                m_sent.Reset(); // Stats cover the current connection
                 
                 if (m_connectionCallback) {
                     m_connectionCallback(true);
                 }
                 
+                // The viewer's decoder starts with nothing to predict from
+                if (m_keyframeRequestCallback) {
+                    m_keyframeRequestCallback();
+                }
+                
                 std::cout << "Unix WebRTC Streamer: Stream started successfully" << std::endl;
                 return true;
                 
@@ -119,9 +125,7 @@ namespace SplashTop {
                 // - Process through platform media APIs
                 // - Send via POSIX sockets with optimizations
                 
-                m_framesSent++;
-                m_bytesSent += frame.width * frame.height * 4; // BGRA format
-                m_lastFrameTime = std::chrono::steady_clock::now();
+                m_sent.Record(static_cast<uint64>(frame.width) * frame.height * 4); // BGRA format
                 
                 // Simulate Unix-specific processing time
                 std::this_thread::sleep_for(std::chrono::microseconds(75));
@@ -134,6 +138,18 @@ namespace SplashTop {
             }
         }
         
+        bool SendVideoSlice(const EncodedSlice& slice) override {
+            if (!m_streaming || !m_connected) {
+                return false;
+            }
+            
+            // In a real implementation the slice goes out on the video
+            // channel right away instead of waiting for the whole frame
+            m_sent.Record(slice.size, slice.IsLastInFrame() ? 1 : 0);
+            
+            return true;
+        }
+        
         void SetInputCallback(std::function<void(const InputEvent&)> callback) override {
             m_inputCallback = callback;
         }
@@ -142,33 +158,21 @@ namespace SplashTop {
             m_connectionCallback = callback;
         }
         
+        void SetKeyframeRequestCallback(std::function<void()> callback) override {
+            // Called on connecting; in a real implementation RTCP PLI/FIR
+            // messages from the viewer invoke it as well
+            m_keyframeRequestCallback = callback;
+        }
+        
         StreamingStats GetStats() override {
-            auto now = std::chrono::steady_clock::now();
-            
-            // Calculate bitrate and FPS
-            double bitrate = 0.0;
-            double fps = 0.0;
-            
-            if (m_connected && m_connectionStartTime.time_since_epoch().count() > 0) {
-                auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - m_connectionStartTime).count();
-                if (duration > 0) {
-                    bitrate = (m_bytesSent * 8.0) / duration; // bits per second
-                    fps = static_cast<double>(m_framesSent) / duration;
-                }
-            }
-            
-            uint64 lastFrameTimeMs = 0;
-            if (m_lastFrameTime.time_since_epoch().count() > 0) {
-                lastFrameTimeMs = static_cast<uint64>(std::chrono::duration_cast<std::chrono::milliseconds>(
-                    m_lastFrameTime.time_since_epoch()).count());
-            }
-            
+            // Called from the stats thread while the send stage records
+            ThroughputMeter::Rates rates = m_sent.GetRates();
             return {
-                m_framesSent,
-                m_bytesSent,
-                bitrate,
-                fps,
-                lastFrameTimeMs,
+                m_sent.GetItems(),
+                m_sent.GetBytes(),
+                rates.bitsPerSecond,
+                rates.itemsPerSecond,
+                m_sent.GetLastMillis(),
                 m_connected
             };
         }
@@ -199,15 +203,13 @@ namespace SplashTop {
         uint32 m_quality = 80;       // 80% quality default
         
         // Statistics
-        uint64 m_framesSent = 0;
-        uint64 m_bytesSent = 0;
+        ThroughputMeter m_sent; // Frames and bytes since connecting
         std::chrono::steady_clock::time_point m_startTime;
-        std::chrono::steady_clock::time_point m_connectionStartTime;
-        std::chrono::steady_clock::time_point m_lastFrameTime;
         
         // Callbacks
         std::function<void(const InputEvent&)> m_inputCallback;
         std::function<void(bool connected)> m_connectionCallback;
+        std::function<void()> m_keyframeRequestCallback;
     };
 
     // Unix-specific factory function
@@ -1,5 +1,6 @@
 #include "platform.h"
 #include "input_injector.h"
+#include "stats.h"
 
 #ifdef PLATFORM_WINDOWS
 
@@ -7,9 +8,7 @@ namespace SplashTop {
 
     class WindowsInputInjector : public IInputInjector {
     public:
-        WindowsInputInjector() : m_initialized(false), m_mouseEvents(0), m_keyboardEvents(0) {
-            m_lastEventTime = std::chrono::steady_clock::now();
-        }
+        WindowsInputInjector() : m_initialized(false) {}
         
         ~WindowsInputInjector() = default;
         
@@ -40,8 +39,7 @@ namespace SplashTop {
             
             UINT result = SendInput(1, &input, sizeof(INPUT));
             if (result > 0) {
-                m_mouseEvents++;
-                m_lastEventTime = std::chrono::steady_clock::now();
+                m_mouseEvents.Record();
                 return true;
             }
             
@@ -70,8 +68,7 @@ namespace SplashTop {
             
             UINT result = SendInput(1, &input, sizeof(INPUT));
             if (result > 0) {
-                m_mouseEvents++;
-                m_lastEventTime = std::chrono::steady_clock::now();
+                m_mouseEvents.Record();
                 return true;
             }
             
@@ -88,8 +85,7 @@ namespace SplashTop {
             
             UINT result = SendInput(1, &input, sizeof(INPUT));
             if (result > 0) {
-                m_mouseEvents++;
-                m_lastEventTime = std::chrono::steady_clock::now();
+                m_mouseEvents.Record();
                 return true;
             }
             
@@ -106,8 +102,7 @@ namespace SplashTop {
             
             UINT result = SendInput(1, &input, sizeof(INPUT));
             if (result > 0) {
-                m_keyboardEvents++;
-                m_lastEventTime = std::chrono::steady_clock::now();
+                m_keyboardEvents.Record();
                 return true;
             }
             
@@ -158,8 +153,7 @@ namespace SplashTop {
             
             UINT result = SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
             if (result > 0) {
-                m_keyboardEvents += inputs.size();
-                m_lastEventTime = std::chrono::steady_clock::now();
+                m_keyboardEvents.Record(0, inputs.size());
                 return true;
             }
             
@@ -176,11 +170,13 @@ namespace SplashTop {
         }
         
         InputStats GetStats() override {
-            return {
-                m_mouseEvents,
-                m_keyboardEvents,
-                static_cast<uint64>(std::chrono::duration_cast<std::chrono::milliseconds>(m_lastEventTime.time_since_epoch()).count())
+            InputStats stats = {
+                m_mouseEvents.GetItems(),
+                m_keyboardEvents.GetItems(),
+                std::max(m_mouseEvents.GetLastMillis(), m_keyboardEvents.GetLastMillis())
             };
+            stats.eventsPerSecond = m_mouseEvents.GetRates().itemsPerSecond + m_keyboardEvents.GetRates().itemsPerSecond;
+            return stats;
         }
         
         bool IsAvailable() const override {
@@ -189,9 +185,8 @@ namespace SplashTop {
         
     private:
         bool m_initialized;
-        uint64 m_mouseEvents;
-        uint64 m_keyboardEvents;
-        std::chrono::steady_clock::time_point m_lastEventTime;
+        ThroughputMeter m_mouseEvents;    // Injected from the input thread, read by GetStats
+        ThroughputMeter m_keyboardEvents;
         
         // Coordinate mapping
         bool m_coordinateMappingEnabled = false;
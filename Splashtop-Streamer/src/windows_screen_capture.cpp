@@ -1,5 +1,8 @@
 #include "platform.h"
 #include "screen_capture.h"
+#include "frame_pool.h"
+#include "frame_trace.h"
+#include "stats.h"
 #include <d3d11.h>
 #include <dxgi.h>
 #include <dxgi1_2.h>
@@ -12,9 +15,7 @@ namespace SplashTop {
 
     class WindowsScreenCapture : public IScreenCapture {
     public:
-        WindowsScreenCapture() : m_initialized(false), m_capturing(false), m_framesCaptured(0), m_totalBytes(0) {
-            m_lastFrameTime = std::chrono::steady_clock::now();
-        }
+        WindowsScreenCapture() : m_initialized(false), m_capturing(false) {}
         
         ~WindowsScreenCapture() {
             StopCapture();
@@ -89,9 +90,7 @@ namespace SplashTop {
             }
             
             m_capturing = true;
-            m_framesCaptured = 0;
-            m_totalBytes = 0;
-            m_lastFrameTime = std::chrono::steady_clock::now();
+            m_captured.Reset();
             
             return true;
         }
@@ -102,6 +101,8 @@ namespace SplashTop {
         
         std::shared_ptr<VideoFrame> GetLatestFrame() override {
             if (!m_capturing || !m_initialized) return nullptr;
+            uint64 captureStart = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
             
             IDXGIResource* desktopResource = nullptr;
             DXGI_OUTDUPL_FRAME_INFO frameInfo;
@@ -149,27 +150,33 @@ namespace SplashTop {
                 return nullptr;
             }
             
-            // Create video frame
-            auto frame = std::make_shared<VideoFrame>();
+            // Take a frame from the pool; skip this one if consumers hold them all
+            size_t frameSize = textureDesc.Height * mappedResource.RowPitch;
+            auto frame = m_framePool.Acquire(frameSize);
+            if (!frame) {
+                m_d3dContext->Unmap(m_stagingTexture, 0);
+                m_desktopDuplication->ReleaseFrame();
+                return nullptr;
+            }
             frame->width = textureDesc.Width;
             frame->height = textureDesc.Height;
             frame->stride = mappedResource.RowPitch;
             frame->format = 0; // BGRA
+            frame->sequence = m_captured.GetItems() + 1;
             frame->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
                 std::chrono::steady_clock::now().time_since_epoch()).count();
             
-            // Allocate and copy frame data
-            size_t frameSize = frame->height * frame->stride;
-            frame->data = new uint8[frameSize];
+            // Copy frame data
             memcpy(frame->data, mappedResource.pData, frameSize);
             
             m_d3dContext->Unmap(m_stagingTexture, 0);
             m_desktopDuplication->ReleaseFrame();
             
-            // Update statistics
-            m_framesCaptured++;
-            m_totalBytes += frameSize;
-            m_lastFrameTime = std::chrono::steady_clock::now();
+            FrameTracer& tracer = FrameTracer::Instance();
+            tracer.BeginFrame(frame->sequence, captureStart);
+            tracer.Mark(frame->sequence, TraceStage::CaptureEnd);
+            
+            m_captured.Record(frameSize);
             
             return frame;
         }
@@ -185,21 +192,27 @@ namespace SplashTop {
             return resolutions;
         }
         
+        bool SetOutputFormat(uint32 format, bool halfSize) override {
+            return format == 0 && !halfSize; // BGRA straight from the duplicated surface only
+        }
+        
+        bool SetFrameRate(uint32 fps) override {
+            // Frames are duplicated inside GetLatestFrame, at the caller's pace
+            (void)fps;
+            return false;
+        }
+        
         void SetCaptureRegion(uint32 x, uint32 y, uint32 width, uint32 height) override {
             // For now, capture the entire screen
             // TODO: Implement region capture
         }
         
         CaptureStats GetStats() override {
-            auto now = std::chrono::steady_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - m_startTime).count();
-            double fps = duration > 0 ? static_cast<double>(m_framesCaptured) / duration : 0.0;
-            
             return {
-                m_framesCaptured,
-                m_totalBytes,
-                fps,
-                static_cast<uint64>(std::chrono::duration_cast<std::chrono::milliseconds>(m_lastFrameTime.time_since_epoch()).count())
+                m_captured.GetItems(),
+                m_captured.GetBytes(),
+                m_captured.GetRates().itemsPerSecond,
+                m_captured.GetLastMillis()
             };
         }
         
@@ -207,6 +220,10 @@ namespace SplashTop {
             return true; // DXGI Desktop Duplication is hardware accelerated
         }
         
+        std::string GetBackendName() const override {
+            return "DXGI Desktop Duplication";
+        }
+        
     private:
         void Cleanup() {
             if (m_stagingTexture) {
@@ -235,13 +252,13 @@ namespace SplashTop {
         ID3D11Texture2D* m_stagingTexture = nullptr;
         D3D11_TEXTURE2D_DESC m_stagingTextureDesc = {};
         
+        // Recycled frame storage handed to consumers
+        FramePool m_framePool{8};
+        
         // State
         bool m_initialized;
         bool m_capturing;
-        uint64 m_framesCaptured;
-        uint64 m_totalBytes;
-        std::chrono::steady_clock::time_point m_lastFrameTime;
-        std::chrono::steady_clock::time_point m_startTime = std::chrono::steady_clock::now();
+        ThroughputMeter m_captured; // Written by GetLatestFrame, read by GetStats
     };
 
     // Factory function implementation
@@ -0,0 +1,494 @@
+#include "yuv_convert.h"
+#include <cmath>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SPLASHTOP_X86_SIMD 1
+    #include <immintrin.h>
+#endif
+
+namespace SplashTop {
+
+    namespace {
+
+        // Fixed-point conversion: Y = (yb*B + yg*G + yr*R + yOffset) >> 15 per
+        // pixel, U and V the same over the sums of a 2x2 block >> 17. Every
+        // kernel uses exactly this arithmetic, so they all agree bit for bit.
+        struct YuvCoefficients {
+            int32 yb, yg, yr, yOffset;
+            int32 ub, ug, ur;
+            int32 vb, vg, vr;
+            int32 uvOffset;
+        };
+
+        YuvCoefficients GetCoefficients(const YuvFormat& format) {
+            const double kr = format.matrix == YuvMatrix::BT601 ? 0.299 : 0.2126;
+            const double kb = format.matrix == YuvMatrix::BT601 ? 0.114 : 0.0722;
+            const bool limited = format.range == YuvRange::Limited;
+            const double yScale = (limited ? 219.0 / 255.0 : 1.0) * 32768.0;
+            const double cScale = (limited ? 224.0 / 255.0 : 1.0) * 32768.0;
+
+            // Round the sums, not just the terms, so white maps to exactly
+            // 235/255 and grey to exactly 128 chroma
+            YuvCoefficients c;
+            c.yr = static_cast<int32>(std::lround(kr * yScale));
+            c.yb = static_cast<int32>(std::lround(kb * yScale));
+            c.yg = static_cast<int32>(std::lround(yScale)) - c.yr - c.yb;
+            c.yOffset = ((limited ? 16 : 0) << 15) + (1 << 14);
+
+            c.ub = static_cast<int32>(std::lround(0.5 * cScale));
+            c.ur = -static_cast<int32>(std::lround(kr / (2.0 * (1.0 - kb)) * cScale));
+            c.ug = -c.ub - c.ur;
+            c.vr = static_cast<int32>(std::lround(0.5 * cScale));
+            c.vb = -static_cast<int32>(std::lround(kb / (2.0 * (1.0 - kr)) * cScale));
+            c.vg = -c.vr - c.vb;
+            c.uvOffset = (128 << 17) + (1 << 16);
+            return c;
+        }
+
+        inline uint8 ClampToByte(int32 value) {
+            return static_cast<uint8>(std::min(255, std::max(0, value)));
+        }
+
+        inline uint8 Luma(const uint8* p, const YuvCoefficients& c) {
+            return ClampToByte((c.yb * p[0] + c.yg * p[1] + c.yr * p[2] + c.yOffset) >> 15);
+        }
+
+        // Scalar reference kernel: two source rows to two luma rows and one
+        // chroma row. u and v point at chroma sample 0 of the row (u only for
+        // NV12). An odd width replicates the last column.
+        void ConvertRowPairScalar(const uint8* src0, const uint8* src1, uint8* y0, uint8* y1,
+                                  uint8* u, uint8* v, uint32 width, bool nv12, const YuvCoefficients& c) {
+            for (uint32 x = 0; x < width; x += 2) {
+                const uint32 x1 = std::min(x + 1, width - 1);
+                const uint8* p[4] = {src0 + x * 4, src0 + x1 * 4, src1 + x * 4, src1 + x1 * 4};
+
+                y0[x] = Luma(p[0], c);
+                y0[x1] = Luma(p[1], c);
+                y1[x] = Luma(p[2], c);
+                y1[x1] = Luma(p[3], c);
+
+                int32 b = p[0][0] + p[1][0] + p[2][0] + p[3][0];
+                int32 g = p[0][1] + p[1][1] + p[2][1] + p[3][1];
+                int32 r = p[0][2] + p[1][2] + p[2][2] + p[3][2];
+                uint8 cb = ClampToByte((c.ub * b + c.ug * g + c.ur * r + c.uvOffset) >> 17);
+                uint8 cr = ClampToByte((c.vb * b + c.vg * g + c.vr * r + c.uvOffset) >> 17);
+                if (nv12) {
+                    u[x] = cb;
+                    u[x + 1] = cr;
+                } else {
+                    u[x / 2] = cb;
+                    v[x / 2] = cr;
+                }
+            }
+        }
+
+        // Average 2x2 blocks of two source rows into one row of
+        // (width + 1) / 2 pixels. An odd width replicates the last column.
+        void HalveRowPairScalar(const uint8* src0, const uint8* src1, uint8* dst, uint32 width) {
+            for (uint32 x = 0; x < width; x += 2) {
+                const uint32 x1 = std::min(x + 1, width - 1);
+                for (uint32 channel = 0; channel < 4; channel++) {
+                    dst[x * 2 + channel] = static_cast<uint8>((src0[x * 4 + channel] + src0[x1 * 4 + channel] +
+                                                               src1[x * 4 + channel] + src1[x1 * 4 + channel] + 2) >> 2);
+                }
+            }
+        }
+
+#ifdef SPLASHTOP_X86_SIMD
+
+        // Two 16-bit coefficients in one 32-bit lane, for _mm_madd_epi16
+        inline int32 PackPair(int32 lo, int32 hi) {
+            return static_cast<int32>((static_cast<uint32>(hi) << 16) | (static_cast<uint32>(lo) & 0xFFFF));
+        }
+
+        // The kernels split BGRA pixels into (B, R) and (G, A) 16-bit pairs
+        // with a mask, so one multiply-add per pair covers all three channels
+        // without SSSE3 shuffles; A always gets a zero coefficient
+        struct SimdCoefficients {
+            int32 yBR, yGA, uBR, uGA, vBR, vGA;
+
+            explicit SimdCoefficients(const YuvCoefficients& c)
+                : yBR(PackPair(c.yb, c.yr)), yGA(PackPair(c.yg, 0)),
+                  uBR(PackPair(c.ub, c.ur)), uGA(PackPair(c.ug, 0)),
+                  vBR(PackPair(c.vb, c.vr)), vGA(PackPair(c.vg, 0)) {}
+        };
+
+        __attribute__((target("sse2")))
+        inline __m128i Luma4SSE2(__m128i p, __m128i mask, __m128i br, __m128i ga, __m128i offset) {
+            __m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_and_si128(p, mask), br),
+                                        _mm_madd_epi16(_mm_and_si128(_mm_srli_epi32(p, 8), mask), ga));
+            return _mm_srai_epi32(_mm_add_epi32(sum, offset), 15);
+        }
+
+        // Chroma of two 2x2 blocks (pixels 0-3 of two rows), packed into lanes 0 and 1
+        __attribute__((target("sse2")))
+        inline void Chroma4SSE2(__m128i p0, __m128i p1, __m128i mask, const SimdCoefficients& k,
+                                __m128i offset, __m128i& u, __m128i& v) {
+            __m128i br = _mm_add_epi16(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+            __m128i ga = _mm_add_epi16(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                                       _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+            // Add each odd pixel to its even neighbour; the odd lanes are ignored
+            br = _mm_add_epi16(br, _mm_srli_epi64(br, 32));
+            ga = _mm_add_epi16(ga, _mm_srli_epi64(ga, 32));
+
+            u = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(k.uBR)), _mm_madd_epi16(ga, _mm_set1_epi32(k.uGA)));
+            v = _mm_add_epi32(_mm_madd_epi16(br, _mm_set1_epi32(k.vBR)), _mm_madd_epi16(ga, _mm_set1_epi32(k.vGA)));
+            u = _mm_shuffle_epi32(_mm_srai_epi32(_mm_add_epi32(u, offset), 17), _MM_SHUFFLE(2, 0, 2, 0));
+            v = _mm_shuffle_epi32(_mm_srai_epi32(_mm_add_epi32(v, offset), 17), _MM_SHUFFLE(2, 0, 2, 0));
+        }
+
+        __attribute__((target("sse2")))
+        void ConvertRowPairSSE2(const uint8* src0, const uint8* src1, uint8* y0, uint8* y1,
+                                uint8* u, uint8* v, uint32 width, bool nv12, const YuvCoefficients& c) {
+            const SimdCoefficients k(c);
+            const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+            const __m128i yBR = _mm_set1_epi32(k.yBR);
+            const __m128i yGA = _mm_set1_epi32(k.yGA);
+            const __m128i yOffset = _mm_set1_epi32(c.yOffset);
+            const __m128i uvOffset = _mm_set1_epi32(c.uvOffset);
+
+            uint32 x = 0;
+            for (; x + 8 <= width; x += 8) {
+                __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 4));
+                __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 4 + 16));
+                __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 4));
+                __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 4 + 16));
+
+                __m128i luma0 = _mm_packs_epi32(Luma4SSE2(a0, mask, yBR, yGA, yOffset),
+                                                Luma4SSE2(b0, mask, yBR, yGA, yOffset));
+                __m128i luma1 = _mm_packs_epi32(Luma4SSE2(a1, mask, yBR, yGA, yOffset),
+                                                Luma4SSE2(b1, mask, yBR, yGA, yOffset));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(y0 + x), _mm_packus_epi16(luma0, luma0));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(y1 + x), _mm_packus_epi16(luma1, luma1));
+
+                __m128i ua, va, ub, vb;
+                Chroma4SSE2(a0, a1, mask, k, uvOffset, ua, va);
+                Chroma4SSE2(b0, b1, mask, k, uvOffset, ub, vb);
+                __m128i chroma = _mm_packs_epi32(_mm_unpacklo_epi64(ua, ub), _mm_unpacklo_epi64(va, vb));
+                chroma = _mm_packus_epi16(chroma, chroma); // u0-3, v0-3
+                if (nv12) {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x),
+                                     _mm_unpacklo_epi8(chroma, _mm_srli_si128(chroma, 4)));
+                } else {
+                    int32 cb = _mm_cvtsi128_si32(chroma);
+                    int32 cr = _mm_cvtsi128_si32(_mm_srli_si128(chroma, 4));
+                    std::memcpy(u + x / 2, &cb, 4);
+                    std::memcpy(v + x / 2, &cr, 4);
+                }
+            }
+            ConvertRowPairScalar(src0 + x * 4, src1 + x * 4, y0 + x, y1 + x,
+                                 nv12 ? u + x : u + x / 2, nv12 ? v : v + x / 2, width - x, nv12, c);
+        }
+
+        __attribute__((target("sse2")))
+        void HalveRowPairSSE2(const uint8* src0, const uint8* src1, uint8* dst, uint32 width) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi16(2);
+
+            uint32 x = 0;
+            for (; x + 8 <= width; x += 8) {
+                __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 4));
+                __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 4 + 16));
+                __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 4));
+                __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 4 + 16));
+
+                // Vertical sums of pixels 0-1, 2-3, 4-5 and 6-7 as 16-bit channels
+                __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(a1, zero));
+                __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(a1, zero));
+                __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(b0, zero), _mm_unpacklo_epi8(b1, zero));
+                __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(b0, zero), _mm_unpackhi_epi8(b1, zero));
+
+                // Even plus odd pixels gives the 2x2 sums of output pixels 0-1 and 2-3
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+                __m128i hi = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 2);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2), _mm_packus_epi16(lo, hi));
+            }
+            HalveRowPairScalar(src0 + x * 4, src1 + x * 4, dst + x * 2, width - x);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i Luma8AVX2(__m256i p, __m256i mask, __m256i br, __m256i ga, __m256i offset) {
+            __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(_mm256_and_si256(p, mask), br),
+                                           _mm256_madd_epi16(_mm256_and_si256(_mm256_srli_epi32(p, 8), mask), ga));
+            return _mm256_srai_epi32(_mm256_add_epi32(sum, offset), 15);
+        }
+
+        // Chroma of four 2x2 blocks; results in lanes 0-1 and 4-5
+        __attribute__((target("avx2")))
+        inline void Chroma8AVX2(__m256i p0, __m256i p1, __m256i mask, const SimdCoefficients& k,
+                                __m256i offset, __m256i& u, __m256i& v) {
+            __m256i br = _mm256_add_epi16(_mm256_and_si256(p0, mask), _mm256_and_si256(p1, mask));
+            __m256i ga = _mm256_add_epi16(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask),
+                                          _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask));
+            br = _mm256_add_epi16(br, _mm256_srli_epi64(br, 32));
+            ga = _mm256_add_epi16(ga, _mm256_srli_epi64(ga, 32));
+
+            u = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(k.uBR)),
+                                 _mm256_madd_epi16(ga, _mm256_set1_epi32(k.uGA)));
+            v = _mm256_add_epi32(_mm256_madd_epi16(br, _mm256_set1_epi32(k.vBR)),
+                                 _mm256_madd_epi16(ga, _mm256_set1_epi32(k.vGA)));
+            u = _mm256_shuffle_epi32(_mm256_srai_epi32(_mm256_add_epi32(u, offset), 17), _MM_SHUFFLE(2, 0, 2, 0));
+            v = _mm256_shuffle_epi32(_mm256_srai_epi32(_mm256_add_epi32(v, offset), 17), _MM_SHUFFLE(2, 0, 2, 0));
+        }
+
+        __attribute__((target("avx2")))
+        void ConvertRowPairAVX2(const uint8* src0, const uint8* src1, uint8* y0, uint8* y1,
+                                uint8* u, uint8* v, uint32 width, bool nv12, const YuvCoefficients& c) {
+            const SimdCoefficients k(c);
+            const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+            const __m256i yBR = _mm256_set1_epi32(k.yBR);
+            const __m256i yGA = _mm256_set1_epi32(k.yGA);
+            const __m256i yOffset = _mm256_set1_epi32(c.yOffset);
+            const __m256i uvOffset = _mm256_set1_epi32(c.uvOffset);
+
+            uint32 x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 4));
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x * 4 + 32));
+                __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 4));
+                __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x * 4 + 32));
+
+                // Packs work per 128-bit lane, so restore pixel order in 64-bit steps
+                __m256i luma0 = _mm256_packs_epi32(Luma8AVX2(a0, mask, yBR, yGA, yOffset),
+                                                   Luma8AVX2(b0, mask, yBR, yGA, yOffset));
+                __m256i luma1 = _mm256_packs_epi32(Luma8AVX2(a1, mask, yBR, yGA, yOffset),
+                                                   Luma8AVX2(b1, mask, yBR, yGA, yOffset));
+                luma0 = _mm256_permute4x64_epi64(luma0, _MM_SHUFFLE(3, 1, 2, 0));
+                luma1 = _mm256_permute4x64_epi64(luma1, _MM_SHUFFLE(3, 1, 2, 0));
+                luma0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(luma0, luma0), _MM_SHUFFLE(3, 1, 2, 0));
+                luma1 = _mm256_permute4x64_epi64(_mm256_packus_epi16(luma1, luma1), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x), _mm256_castsi256_si128(luma0));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x), _mm256_castsi256_si128(luma1));
+
+                __m256i ua, va, ub, vb;
+                Chroma8AVX2(a0, a1, mask, k, uvOffset, ua, va);
+                Chroma8AVX2(b0, b1, mask, k, uvOffset, ub, vb);
+                __m256i cb = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(ua, ub), _MM_SHUFFLE(3, 1, 2, 0));
+                __m256i cr = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(va, vb), _MM_SHUFFLE(3, 1, 2, 0));
+                __m256i chroma = _mm256_permute4x64_epi64(_mm256_packs_epi32(cb, cr), _MM_SHUFFLE(3, 1, 2, 0));
+                chroma = _mm256_packus_epi16(chroma, chroma); // u0-7 in the low lane, v0-7 in the high lane
+                __m128i cbBytes = _mm256_castsi256_si128(chroma);
+                __m128i crBytes = _mm256_extracti128_si256(chroma, 1);
+                if (nv12) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x), _mm_unpacklo_epi8(cbBytes, crBytes));
+                } else {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), cbBytes);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), crBytes);
+                }
+            }
+            ConvertRowPairScalar(src0 + x * 4, src1 + x * 4, y0 + x, y1 + x,
+                                 nv12 ? u + x : u + x / 2, nv12 ? v : v + x / 2, width - x, nv12, c);
+        }
+
+#endif // SPLASHTOP_X86_SIMD
+
+        using RowPairConverter = void (*)(const uint8*, const uint8*, uint8*, uint8*, uint8*, uint8*,
+                                          uint32, bool, const YuvCoefficients&);
+
+        RowPairConverter GetRowPairConverter(PixelKernel kernel) {
+#ifdef SPLASHTOP_X86_SIMD
+            if (kernel == PixelKernel::AVX2 && IsPixelKernelAvailable(PixelKernel::AVX2)) return ConvertRowPairAVX2;
+            if (kernel == PixelKernel::SSE2 && IsPixelKernelAvailable(PixelKernel::SSE2)) return ConvertRowPairSSE2;
+#else
+            (void)kernel;
+#endif
+            return ConvertRowPairScalar;
+        }
+
+        using RowPairHalver = void (*)(const uint8*, const uint8*, uint8*, uint32);
+
+        RowPairHalver GetRowPairHalver(PixelKernel kernel) {
+#ifdef SPLASHTOP_X86_SIMD
+            if (kernel != PixelKernel::Scalar && IsPixelKernelAvailable(PixelKernel::SSE2)) return HalveRowPairSSE2;
+#else
+            (void)kernel;
+#endif
+            return HalveRowPairScalar;
+        }
+
+        void ConvertBlock(RowPairConverter converter, const uint8* src, uint32 srcStride, uint32 width,
+                          uint32 height, const YuvImage& dst, const YuvCoefficients& c) {
+            const bool nv12 = dst.layout == YuvLayout::NV12;
+            for (uint32 y = 0; y < height; y += 2) {
+                // An odd last row pairs with itself
+                const bool pair = y + 1 < height;
+                const uint8* src0 = src + static_cast<size_t>(y) * srcStride;
+                uint8* y0 = dst.y + static_cast<size_t>(y) * dst.yStride;
+                uint8* u = dst.u + static_cast<size_t>(y / 2) * dst.uStride;
+                uint8* v = nv12 ? u : dst.v + static_cast<size_t>(y / 2) * dst.vStride;
+                converter(src0, pair ? src0 + srcStride : src0, y0, pair ? y0 + dst.yStride : y0,
+                          u, v, width, nv12, c);
+            }
+        }
+
+        // Halve a block while converting it: every pair of output rows is
+        // averaged from four source rows into a small row buffer that stays
+        // in cache, then converted like a full-size row pair
+        void ConvertBlockHalfSize(RowPairConverter converter, RowPairHalver halver, const uint8* src,
+                                  uint32 srcStride, uint32 width, uint32 height, const YuvImage& dst,
+                                  const YuvCoefficients& c) {
+            const uint32 outWidth = (width + 1) / 2;
+            const uint32 outHeight = (height + 1) / 2;
+            const bool nv12 = dst.layout == YuvLayout::NV12;
+
+            // Grows once per thread, so steady-state conversions do not allocate
+            thread_local std::vector<uint8> rows;
+            rows.resize(static_cast<size_t>(outWidth) * 8);
+            uint8* row0 = rows.data();
+            uint8* row1 = row0 + static_cast<size_t>(outWidth) * 4;
+
+            auto sourceRow = [&](uint32 y) {
+                return src + static_cast<size_t>(std::min(y, height - 1)) * srcStride;
+            };
+
+            for (uint32 y = 0; y < outHeight; y += 2) {
+                const bool pair = y + 1 < outHeight;
+                halver(sourceRow(y * 2), sourceRow(y * 2 + 1), row0, width);
+                if (pair) halver(sourceRow(y * 2 + 2), sourceRow(y * 2 + 3), row1, width);
+
+                uint8* y0 = dst.y + static_cast<size_t>(y) * dst.yStride;
+                uint8* u = dst.u + static_cast<size_t>(y / 2) * dst.uStride;
+                uint8* v = nv12 ? u : dst.v + static_cast<size_t>(y / 2) * dst.vStride;
+                converter(row0, pair ? row1 : row0, y0, pair ? y0 + dst.yStride : y0, u, v, outWidth, nv12, c);
+            }
+        }
+
+        // The same image starting firstRow rows further down (firstRow is even)
+        YuvImage OffsetRows(const YuvImage& image, uint32 firstRow) {
+            YuvImage band = image;
+            band.y += static_cast<size_t>(firstRow) * image.yStride;
+            band.u += static_cast<size_t>(firstRow / 2) * image.uStride;
+            if (image.layout == YuvLayout::I420) band.v += static_cast<size_t>(firstRow / 2) * image.vStride;
+            return band;
+        }
+
+        // Below this many pixels per band, waking a thread costs more than it saves
+        constexpr uint64 kMinBandPixels = 256 * 1024;
+        constexpr uint32 kMaxThreads = 8;
+
+    } // namespace
+
+    void ConvertBGRAToYuv(const uint8* src, uint32 srcStride, uint32 width, uint32 height,
+                          const YuvImage& dst, const YuvFormat& format) {
+        ConvertBlock(GetRowPairConverter(GetBestPixelKernel()), src, srcStride, width, height, dst,
+                     GetCoefficients(format));
+    }
+
+    bool ConvertBGRAToYuvWithKernel(PixelKernel kernel, const uint8* src, uint32 srcStride,
+                                    uint32 width, uint32 height, const YuvImage& dst, const YuvFormat& format) {
+        if (!IsPixelKernelAvailable(kernel)) return false;
+        ConvertBlock(GetRowPairConverter(kernel), src, srcStride, width, height, dst, GetCoefficients(format));
+        return true;
+    }
+
+    void ConvertBGRAToYuvHalfSize(const uint8* src, uint32 srcStride, uint32 width, uint32 height,
+                                  const YuvImage& dst, const YuvFormat& format) {
+        PixelKernel kernel = GetBestPixelKernel();
+        ConvertBlockHalfSize(GetRowPairConverter(kernel), GetRowPairHalver(kernel), src, srcStride,
+                             width, height, dst, GetCoefficients(format));
+    }
+
+    YuvImage GetYuv420Planes(const VideoFrame& frame) {
+        YuvImage image;
+        image.y = frame.data;
+        image.u = frame.GetUPlane();
+        image.v = frame.GetVPlane();
+        image.yStride = frame.stride;
+        image.uStride = frame.stride / 2;
+        image.vStride = frame.stride / 2;
+        return image;
+    }
+
+    YuvConverter::YuvConverter(uint32 threads) : m_kernel(GetBestPixelKernel()) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, kMaxThreads);
+        for (uint32 band = 1; band < threads; band++) {
+            m_workers.emplace_back(&YuvConverter::WorkerLoop, this, band);
+        }
+    }
+
+    YuvConverter::~YuvConverter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) worker.join();
+    }
+
+    void YuvConverter::SetKernel(PixelKernel kernel) {
+        m_kernel = IsPixelKernelAvailable(kernel) ? kernel : PixelKernel::Scalar;
+    }
+
+    void YuvConverter::Convert(const uint8* src, uint32 srcStride, uint32 width, uint32 height,
+                               const YuvImage& dst) {
+        uint64 pixels = static_cast<uint64>(width) * height;
+        uint32 bands = static_cast<uint32>(std::min<uint64>(GetThreadCount(), pixels / kMinBandPixels));
+        if (bands <= 1) {
+            if (m_halfSize) {
+                ConvertBlockHalfSize(GetRowPairConverter(m_kernel), GetRowPairHalver(m_kernel), src, srcStride,
+                                     width, height, dst, GetCoefficients(m_format));
+            } else {
+                ConvertBlock(GetRowPairConverter(m_kernel), src, srcStride, width, height, dst,
+                             GetCoefficients(m_format));
+            }
+            return;
+        }
+
+        // Even band heights keep each chroma row inside one band
+        uint32 outHeight = m_halfSize ? (height + 1) / 2 : height;
+        uint32 bandRows = ((outHeight + bands - 1) / bands + 1) & ~1u;
+        Job job = {src, srcStride, width, height, dst, bandRows};
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = job;
+            m_bands = bands;
+            m_pending = bands - 1;
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        ConvertBand(job, 0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+    }
+
+    void YuvConverter::WorkerLoop(uint32 band) {
+        uint64 seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) return;
+            seen = m_generation;
+            if (band >= m_bands) continue; // Not needed for this frame
+
+            Job job = m_job;
+            lock.unlock();
+            ConvertBand(job, band);
+            lock.lock();
+
+            if (--m_pending == 0) m_done.notify_one();
+        }
+    }
+
+    void YuvConverter::ConvertBand(const Job& job, uint32 band) {
+        // Rows of the band in the output, and the source rows they come from
+        const uint32 scale = m_halfSize ? 2 : 1;
+        uint32 firstRow = band * job.bandRows;
+        if (firstRow * scale >= job.height) return;
+        uint32 sourceRows = std::min(job.bandRows * scale, job.height - firstRow * scale);
+        const uint8* src = job.src + static_cast<size_t>(firstRow) * scale * job.srcStride;
+        if (m_halfSize) {
+            ConvertBlockHalfSize(GetRowPairConverter(m_kernel), GetRowPairHalver(m_kernel), src, job.srcStride,
+                                 job.width, sourceRows, OffsetRows(job.dst, firstRow), GetCoefficients(m_format));
+        } else {
+            ConvertBlock(GetRowPairConverter(m_kernel), src, job.srcStride, job.width, sourceRows,
+                         OffsetRows(job.dst, firstRow), GetCoefficients(m_format));
+        }
+    }
+
+} // namespace SplashTop
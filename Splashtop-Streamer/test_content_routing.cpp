@@ -0,0 +1,357 @@
+#include "platform.h"
+#include "content_classifier.h"
+#include "hybrid_video_encoder.h"
+#include "tile_video_encoder.h"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstring>
+
+using namespace SplashTop;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+// 4 x 2 tiles of 64 pixels, each drawn as text or as video
+static const uint32 kTileSize = 64;
+static const uint32 kTilesX = 4;
+static const uint32 kTilesY = 2;
+
+struct Canvas {
+    uint32 width = kTilesX * kTileSize;
+    uint32 height = kTilesY * kTileSize;
+    std::vector<uint8> pixels = std::vector<uint8>(static_cast<size_t>(width) * height * 4);
+
+    uint32* Row(uint32 y) { return reinterpret_cast<uint32*>(pixels.data() + static_cast<size_t>(y) * width * 4); }
+
+    // Dark glyph-like blocks on white: two colors, hard edges
+    void DrawText(uint32 tx, uint32 ty, uint32 seed) {
+        std::mt19937 rng(seed);
+        for (uint32 y = 0; y < kTileSize; y++) {
+            uint32* row = Row(ty * kTileSize + y);
+            for (uint32 x = 0; x < kTileSize; x++) {
+                if (x % 6 == 0 && y % 12 == 0) rng();
+                bool ink = (y % 12) > 2 && (x % 6) < 4 && ((rng.min() + x / 6 + y / 12 + seed) % 3 != 0);
+                row[tx * kTileSize + x] = ink ? 0xFF202020 : 0xFFFFFFFF;
+            }
+        }
+    }
+
+    // Soft gradient with fine noise: many colors, every pixel differs from
+    // its neighbour, no high-contrast edges
+    void DrawVideo(uint32 tx, uint32 ty, uint32 seed) {
+        std::mt19937 rng(seed);
+        for (uint32 y = 0; y < kTileSize; y++) {
+            uint32* row = Row(ty * kTileSize + y);
+            for (uint32 x = 0; x < kTileSize; x++) {
+                uint32 base = (x * 2 + y + seed * 3) & 0x7F;
+                uint32 r = base + rng() % 24, g = base + 40 + rng() % 24, b = base + 80 + rng() % 24;
+                row[tx * kTileSize + x] = 0xFF000000 | r << 16 | g << 8 | b;
+            }
+        }
+    }
+
+    VideoFrame Frame(uint64 sequence) {
+        VideoFrame frame = {};
+        frame.data = pixels.data();
+        frame.width = width;
+        frame.height = height;
+        frame.stride = width * 4;
+        frame.format = 0;
+        frame.sequence = sequence;
+        frame.timestamp = sequence * 33333;
+        return frame;
+    }
+
+    void DrawDesktop() {
+        for (uint32 ty = 0; ty < kTilesY; ty++) {
+            for (uint32 tx = 0; tx < kTilesX; tx++) DrawText(tx, ty, tx + ty * kTilesX);
+        }
+    }
+};
+
+// A video tile is taken for natural content only once it has looked like
+// video and kept changing for a few frames; text stays synthetic however
+// often it changes
+static void TestBecomesNatural() {
+    Canvas canvas;
+    canvas.DrawDesktop();
+    ContentClassifier classifier(kTileSize);
+
+    int firstNatural = 0;
+    bool textNatural = false;
+    bool otherNatural = false;
+    for (int i = 1; i <= 10; i++) {
+        canvas.DrawVideo(1, 0, i);
+        canvas.DrawText(2, 1, 100 + i);
+        VideoFrame frame = canvas.Frame(i);
+        classifier.Classify(frame);
+        if (!firstNatural && frame.naturalTiles.IsDirty(1, 0)) firstNatural = i;
+        textNatural |= frame.naturalTiles.IsDirty(2, 1);
+        otherNatural |= frame.naturalTiles.CountDirty() > (frame.naturalTiles.IsDirty(1, 0) ? 1u : 0u);
+    }
+
+    Check(firstNatural > 1, "classify: one video frame is not enough");
+    Check(firstNatural != 0 && firstNatural <= 4, "classify: changing video turns natural within a few frames");
+    Check(!textNatural, "classify: changing text stays synthetic");
+    Check(!otherNatural, "classify: static tiles stay synthetic");
+}
+
+// Leaving the natural class takes more than entering it: a single
+// text-like update or an occasional change keeps a natural tile natural,
+// while the same occasional changes never make a synthetic tile natural
+static void TestHysteresis() {
+    Canvas canvas;
+    canvas.DrawDesktop();
+    ContentClassifier classifier(kTileSize);
+    uint64 sequence = 0;
+    auto classify = [&]() {
+        VideoFrame frame = canvas.Frame(++sequence);
+        classifier.Classify(frame);
+        return frame.naturalTiles;
+    };
+
+    for (uint32 i = 0; i < 20; i++) {
+        canvas.DrawVideo(1, 0, i);
+        classify();
+    }
+    canvas.DrawText(1, 0, 7);
+    Check(classify().IsDirty(1, 0), "hysteresis: one text-like update keeps the tile natural");
+
+    // Tile (1, 0) was video, tile (2, 0) never was; both now change every
+    // sixth frame
+    bool stayed = true;
+    bool entered = false;
+    for (uint32 i = 0; i < 36; i++) {
+        if (i % 6 == 5) {
+            canvas.DrawVideo(1, 0, 200 + i);
+            canvas.DrawVideo(2, 0, 300 + i);
+        }
+        DirtyTileMap natural = classify();
+        stayed &= natural.IsDirty(1, 0);
+        entered |= natural.IsDirty(2, 0);
+    }
+    Check(stayed, "hysteresis: occasional changes keep a natural tile natural");
+    Check(!entered, "hysteresis: occasional changes do not make a tile natural");
+
+    bool left = false;
+    for (uint32 i = 0; i < 40 && !left; i++) left = !classify().IsDirty(1, 0);
+    Check(left, "hysteresis: a natural tile that stops changing goes back to synthetic");
+}
+
+// One hybrid message, split into its parts
+struct HybridMessage {
+    bool valid = false;
+    uint32 tilesX = 0, tilesY = 0;
+    std::vector<uint8> bitmap;
+    const uint8* tiles = nullptr;
+    uint32 tileBytes = 0;
+    uint32 tileCount = 0; // Tiles in the tile message
+    uint32 videoBytes = 0;
+
+    bool IsNatural(uint32 tx, uint32 ty) const {
+        uint32 index = ty * tilesX + tx;
+        return (bitmap[index / 8] >> (index % 8)) & 1;
+    }
+};
+
+static uint32 ReadU32(const uint8* data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32>(data[3]) << 24;
+}
+
+static HybridMessage ParseHybrid(const std::vector<uint8>& data) {
+    HybridMessage message;
+    if (data.size() < 8 || std::memcmp(data.data(), "STH1", 4) != 0) return message;
+    message.tilesX = data[4] | data[5] << 8;
+    message.tilesY = data[6] | data[7] << 8;
+    size_t offset = 8;
+    size_t bitmapBytes = (static_cast<size_t>(message.tilesX) * message.tilesY + 7) / 8;
+    if (data.size() < offset + bitmapBytes + 4) return message;
+    message.bitmap.assign(data.begin() + offset, data.begin() + offset + bitmapBytes);
+    offset += bitmapBytes;
+
+    message.tileBytes = ReadU32(data.data() + offset);
+    offset += 4;
+    if (data.size() < offset + message.tileBytes + 4 || message.tileBytes < 20) return message;
+    message.tiles = data.data() + offset;
+    message.tileCount = ReadU32(message.tiles + 16); // After magic, flags, compression, tile size, width, height
+    offset += message.tileBytes;
+
+    message.videoBytes = ReadU32(data.data() + offset);
+    message.valid = data.size() == offset + 4 + message.videoBytes;
+    return message;
+}
+
+static bool SameTile(Canvas& canvas, const TileFrameDecoder& decoder, uint32 tx, uint32 ty) {
+    for (uint32 y = ty * kTileSize; y < (ty + 1) * kTileSize; y++) {
+        const uint8* expected = canvas.pixels.data() + (static_cast<size_t>(y) * canvas.width + tx * kTileSize) * 4;
+        const uint8* actual = decoder.GetImage().data() + static_cast<size_t>(y) * decoder.GetStride() + tx * kTileSize * 4;
+        if (std::memcmp(expected, actual, kTileSize * 4) != 0) return false;
+    }
+    return true;
+}
+
+// Raw frames through the video layer, unless told to fail like an encoder
+// holding back a frame
+class FlakyVideoEncoder : public IVideoEncoder {
+public:
+    FlakyVideoEncoder() : m_raw(CreateVideoEncoder("raw")) {}
+
+    bool fail = false;
+
+    bool Initialize(uint32 width, uint32 height, uint32 fps, uint32 bitrate) override {
+        return m_raw->Initialize(width, height, fps, bitrate);
+    }
+    bool EncodeFrame(const VideoFrame& frame, std::vector<uint8>& encodedData) override {
+        return !fail && m_raw->EncodeFrame(frame, encodedData);
+    }
+    bool EncodePacket(const VideoFrame& frame, EncodedPacket& packet, const SliceCallback& onSlice) override {
+        return !fail && m_raw->EncodePacket(frame, packet, onSlice);
+    }
+    EncoderStats GetStats() override { return m_raw->GetStats(); }
+    bool IsHardwareAccelerated() const override { return false; }
+    void SetBitrate(uint32 bitrate) override { m_raw->SetBitrate(bitrate); }
+    void SetFPS(uint32 fps) override { m_raw->SetFPS(fps); }
+    void SetQuality(uint32 quality) override { m_raw->SetQuality(quality); }
+    void SetKeyframeInterval(uint32 frames) override { m_raw->SetKeyframeInterval(frames); }
+    void SetSliceCount(uint32 slices) override { m_raw->SetSliceCount(slices); }
+    void RequestKeyframe() override { m_raw->RequestKeyframe(); }
+    void SetIntraRefresh(bool enabled) override { m_raw->SetIntraRefresh(enabled); }
+    std::vector<std::string> GetSupportedCodecs() const override { return {"raw"}; }
+
+private:
+    std::unique_ptr<IVideoEncoder> m_raw;
+};
+
+// Classifies, encodes and parses one frame, feeding the tile layer to
+// decoder
+struct HybridSession {
+    Canvas canvas;
+    ContentClassifier classifier{kTileSize};
+    FlakyVideoEncoder* video;
+    HybridVideoEncoder encoder;
+    TileFrameDecoder decoder;
+    std::vector<uint8> data;
+    uint64 sequence = 0;
+
+    HybridSession() : HybridSession(std::make_unique<FlakyVideoEncoder>()) {}
+
+    explicit HybridSession(std::unique_ptr<FlakyVideoEncoder> flaky) : video(flaky.get()), encoder(std::move(flaky)) {
+        canvas.DrawDesktop();
+        encoder.Initialize(canvas.width, canvas.height, 30, 4000000);
+    }
+
+    HybridMessage Encode(DirtyTileMap* natural = nullptr) {
+        VideoFrame frame = canvas.Frame(++sequence);
+        classifier.Classify(frame);
+        if (natural) *natural = frame.naturalTiles;
+        HybridMessage message;
+        if (!encoder.EncodeFrame(frame, data)) return message;
+        message = ParseHybrid(data);
+        if (message.valid && !decoder.Decode(message.tiles, message.tileBytes)) message.valid = false;
+        return message;
+    }
+};
+
+// Messages carry the classification, video only when natural tiles
+// changed, and tiles leaving the video layer come back through the tile
+// layer even when they did not change
+static void TestHybridRoundTrip() {
+    HybridSession session;
+    Canvas& canvas = session.canvas;
+
+    HybridMessage first = session.Encode();
+    Check(first.valid, "hybrid: message parses");
+    Check(first.tilesX == kTilesX && first.tilesY == kTilesY, "hybrid: tile grid in the header");
+    Check(first.tileCount == kTilesX * kTilesY && first.videoBytes == 0, "hybrid: keyframe is all tile layer");
+
+    bool bitmapMatches = true;
+    bool videoWhenNatural = true;
+    bool naturalSkipsTiles = true;
+    int naturalFrames = 0;
+    for (uint32 i = 0; i < 10; i++) {
+        canvas.DrawVideo(3, 1, i);
+        DirtyTileMap natural;
+        HybridMessage message = session.Encode(&natural);
+        bitmapMatches &= message.valid && message.bitmap[0] == (natural.bits[0] & 0xFF);
+        if (message.IsNatural(3, 1)) {
+            naturalFrames++;
+            videoWhenNatural &= message.videoBytes > 0;
+            naturalSkipsTiles &= message.tileCount == 0;
+        }
+    }
+    Check(bitmapMatches, "hybrid: bitmap is the classification");
+    Check(naturalFrames > 0, "hybrid: video tile routed to the video layer");
+    Check(videoWhenNatural, "hybrid: changed natural tiles carry video");
+    Check(naturalSkipsTiles, "hybrid: natural tiles are not in the tile layer");
+
+    // The video stops and leaves text behind, which stays natural for a
+    // while, then goes back to the tile layer without changing again
+    canvas.DrawText(3, 1, 42);
+    HybridMessage settled = session.Encode();
+    Check(settled.IsNatural(3, 1) && settled.videoBytes > 0, "hybrid: last change still goes to the video layer");
+
+    bool left = false;
+    bool resent = false;
+    for (uint32 i = 0; i < 40 && !left; i++) {
+        HybridMessage message = session.Encode();
+        if (message.valid && !message.IsNatural(3, 1)) {
+            left = true;
+            resent = message.tileCount == 1 && message.videoBytes == 0;
+        }
+    }
+    Check(left, "hybrid: settled tile leaves the video layer");
+    Check(resent, "hybrid: leaving tile resent through the tile layer");
+    Check(SameTile(canvas, session.decoder, 3, 1), "hybrid: leaving tile decodes losslessly");
+}
+
+// A frame the video codec produced nothing for must not leave natural
+// tiles without data: they go through the tile layer and rejoin the video
+// layer on a later frame
+static void TestHybridVideoFailure() {
+    HybridSession session;
+    Canvas& canvas = session.canvas;
+    session.Encode();
+
+    for (uint32 i = 0; i < 10; i++) {
+        canvas.DrawVideo(0, 0, i);
+        session.Encode();
+    }
+    canvas.DrawVideo(2, 0, 1000); // Unchanged from here on
+
+    session.video->fail = true;
+    canvas.DrawVideo(0, 0, 500);
+    DirtyTileMap natural;
+    HybridMessage failed = session.Encode(&natural);
+    Check(natural.IsDirty(0, 0), "video failure: tile still classified natural");
+    Check(failed.valid && !failed.IsNatural(0, 0) && failed.videoBytes == 0, "video failure: tile left out of the video layer");
+    Check(failed.tileCount >= 1 && SameTile(canvas, session.decoder, 0, 0), "video failure: tile sent through the tile layer");
+
+    session.video->fail = false;
+    HybridMessage unchanged = session.Encode();
+    Check(unchanged.valid && unchanged.IsNatural(0, 0) && unchanged.videoBytes > 0, "video failure: tile rejoins the video layer");
+}
+
+int main() {
+    std::cout << "SplashTop Content Routing Test" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    TestBecomesNatural();
+    TestHysteresis();
+    TestHybridRoundTrip();
+    TestHybridVideoFailure();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All content routing tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "platform.h"
+#include "frame_scheduler.h"
+#include <iostream>
+
+using namespace SplashTop;
+
+using Clock = std::chrono::steady_clock;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+static int64 Micros(std::chrono::nanoseconds duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+// Deadlines lie on the grid: a whole number of intervals plus the phase
+static bool OnGrid(const FrameScheduler& scheduler) {
+    auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(scheduler.GetDeadline().time_since_epoch());
+    return (sinceEpoch - scheduler.GetPhase()) % scheduler.GetInterval() == std::chrono::nanoseconds(0);
+}
+
+// An idle loop ticks at the frame rate without drifting
+static void TestSteadyRate() {
+    FrameScheduler scheduler(120);
+    scheduler.WaitForNextFrame();
+    Clock::time_point start = Clock::now();
+    uint32 missed = 0;
+    for (int i = 0; i < 60; i++) missed += scheduler.WaitForNextFrame();
+    int64 elapsed = Micros(Clock::now() - start);
+
+    FrameTimingStats stats = scheduler.GetStats();
+    Check(OnGrid(scheduler), "steady: deadlines on the grid");
+    Check(elapsed > 490000 && elapsed < 520000, "steady: 60 intervals at 120 fps take half a second");
+    Check(stats.ticks == 61, "steady: ticks counted");
+    Check(stats.intervalMicros > 8333 && stats.intervalMicros < 8334, "steady: nominal interval");
+    std::cout << "steady: " << missed << " missed, jitter p50/p95/p99/max " << stats.jitterP50Micros << "/"
+              << stats.jitterP95Micros << "/" << stats.jitterP99Micros << "/" << stats.jitterMaxMicros
+              << " us, lateness p99 " << stats.latenessP99Micros << " us" << std::endl;
+    Check(stats.jitterP50Micros < 1000, "steady: median jitter under a millisecond");
+}
+
+// A loop that overran several intervals skips them and keeps the grid
+static void TestSkip() {
+    FrameScheduler scheduler(200);
+    scheduler.WaitForNextFrame();
+    Clock::time_point first = scheduler.GetDeadline();
+    std::this_thread::sleep_for(std::chrono::milliseconds(23));
+
+    uint32 missed = scheduler.WaitForNextFrame();
+    int64 intervals = Micros(scheduler.GetDeadline() - first) / 5000;
+    Check(missed >= 3, "skip: overrun deadlines skipped");
+    Check(intervals == missed + 1, "skip: ticked for the most recent deadline");
+    Check(OnGrid(scheduler), "skip: still on the grid");
+    Check(scheduler.GetStats().missed == missed, "skip: missed counted");
+}
+
+// CatchUp lets a few late deadlines through back to back, then skips
+static void TestCatchUp() {
+    FrameScheduler scheduler(200, FrameScheduler::Policy::CatchUp, 2);
+    scheduler.WaitForNextFrame();
+    std::this_thread::sleep_for(std::chrono::milliseconds(23));
+
+    Clock::time_point start = Clock::now();
+    Check(scheduler.WaitForNextFrame() == 0, "catch up: first late tick");
+    Check(scheduler.WaitForNextFrame() == 0, "catch up: second late tick");
+    Check(Micros(Clock::now() - start) < 2000, "catch up: late ticks do not sleep");
+    Check(scheduler.WaitForNextFrame() > 0, "catch up: the rest are skipped");
+}
+
+// The phase follows a producer's timestamps: far off it jumps, close by it
+// eases in, and it takes the short way round the interval
+static void TestAlign() {
+    FrameScheduler scheduler(100);
+    const uint64 base = 1000000000;
+    auto lead = std::chrono::microseconds(1000);
+
+    scheduler.AlignTo(base + 3000, lead);
+    Check(Micros(scheduler.GetPhase()) == 4000, "align: jumps to the producer phase plus the lead");
+
+    scheduler.AlignTo(base + 3400, lead);
+    Check(Micros(scheduler.GetPhase()) == 4100, "align: eases towards a close phase");
+
+    scheduler.SetPhase(std::chrono::microseconds(9800));
+    scheduler.AlignTo(base + 9000 + 10000, lead);
+    Check(Micros(scheduler.GetPhase()) == 9850, "align: wraps round the interval");
+
+    scheduler.WaitForNextFrame();
+    Check(OnGrid(scheduler), "align: ticks at the new phase");
+}
+
+// A new rate neither repeats a tick nor leaves a gap
+static void TestRateChange() {
+    FrameScheduler scheduler(100);
+    scheduler.WaitForNextFrame();
+    Clock::time_point last = scheduler.GetDeadline();
+    scheduler.SetFPS(60);
+    scheduler.WaitForNextFrame();
+    int64 gap = Micros(scheduler.GetDeadline() - last);
+    Check(gap >= 8333 && gap <= 25000, "rate change: next tick within an interval and a half");
+    Check(OnGrid(scheduler), "rate change: on the new grid");
+}
+
+int main() {
+    std::cout << "SplashTop Frame Scheduler Test" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    TestSteadyRate();
+    TestSkip();
+    TestCatchUp();
+    TestAlign();
+    TestRateChange();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All frame scheduler tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "platform.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include <iostream>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace SplashTop;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+static bool Contains(const std::string& text, const std::string& pattern) {
+    return text.find(pattern) != std::string::npos;
+}
+
+// Send one request to the server and return the whole response
+static std::string Fetch(uint16 port, const std::string& request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return std::string();
+    }
+    send(fd, request.data(), request.size(), 0);
+
+    std::string response;
+    char buffer[1024];
+    ssize_t received;
+    while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, received);
+    close(fd);
+    return response;
+}
+
+// Samples land in the first bucket whose bound they do not exceed
+static void TestHistogram() {
+    LatencyHistogram histogram;
+    histogram.Observe(0);
+    histogram.Observe(100);
+    histogram.Observe(101);
+    histogram.Observe(16000);
+    histogram.Observe(5000000);
+
+    LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    Check(snapshot.count == 5, "histogram: count");
+    Check(snapshot.sumMicros == 5016201, "histogram: sum");
+    Check(snapshot.counts[0] == 2, "histogram: bounds are inclusive");
+    Check(snapshot.counts[1] == 1, "histogram: next bucket");
+    Check(snapshot.counts[7] == 1, "histogram: 16 ms under 25 ms");
+    Check(snapshot.counts[LatencyHistogram::kBucketCount] == 1, "histogram: overflow bucket");
+}
+
+// The exposition has HELP and TYPE once, cumulative buckets in seconds
+static void TestWriter() {
+    LatencyHistogram histogram;
+    histogram.Observe(200);
+    histogram.Observe(3000);
+
+    PrometheusWriter writer;
+    writer.Family("test_frames_total", "counter", "Frames");
+    writer.Sample("test_frames_total", 42, "stage=\"sent\"");
+    writer.Sample("test_frames_total", 7, "stage=\"dropped\"");
+    writer.Family("test_latency_seconds", "histogram", "Latency");
+    writer.Histogram("test_latency_seconds", histogram.GetSnapshot(), "stage=\"encode\"");
+    const std::string& text = writer.GetText();
+
+    Check(Contains(text, "# HELP test_frames_total Frames\n# TYPE test_frames_total counter\n"), "writer: header");
+    Check(Contains(text, "test_frames_total{stage=\"sent\"} 42\n"), "writer: labelled sample");
+    Check(Contains(text, "test_latency_seconds_bucket{stage=\"encode\",le=\"0.0001\"} 0\n"), "writer: empty bucket");
+    Check(Contains(text, "test_latency_seconds_bucket{stage=\"encode\",le=\"0.00025\"} 1\n"), "writer: bucket");
+    Check(Contains(text, "test_latency_seconds_bucket{stage=\"encode\",le=\"0.005\"} 2\n"), "writer: cumulative");
+    Check(Contains(text, "test_latency_seconds_bucket{stage=\"encode\",le=\"+Inf\"} 2\n"), "writer: +Inf bucket");
+    Check(Contains(text, "test_latency_seconds_sum{stage=\"encode\"} 0.0032\n"), "writer: sum in seconds");
+    Check(Contains(text, "test_latency_seconds_count{stage=\"encode\"} 2\n"), "writer: count");
+}
+
+// GET /metrics gets the handler's text, other paths and methods do not
+static void TestServer() {
+    MetricsServer server;
+    int scrapes = 0;
+    bool started = server.Start("127.0.0.1", 0, [&scrapes] {
+        scrapes++;
+        return std::string("test_up 1\n");
+    });
+    Check(started && server.GetPort() != 0, "server: listening on a free port");
+    if (!started) return;
+
+    std::string response = Fetch(server.GetPort(), "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    Check(response.find("HTTP/1.1 200 OK\r\n") == 0, "server: 200");
+    Check(Contains(response, "Content-Type: text/plain; version=0.0.4"), "server: exposition content type");
+    Check(Contains(response, "Content-Length: 10\r\n"), "server: content length");
+    Check(Contains(response, "\r\n\r\ntest_up 1\n"), "server: body");
+
+    Check(Contains(Fetch(server.GetPort(), "GET /metrics?x=1 HTTP/1.1\r\n\r\n"), "200 OK"), "server: query ignored");
+    Check(Contains(Fetch(server.GetPort(), "GET / HTTP/1.1\r\n\r\n"), "404 Not Found"), "server: 404");
+    Check(Contains(Fetch(server.GetPort(), "POST /metrics HTTP/1.1\r\n\r\n"), "405"), "server: GET only");
+    Check(scrapes == 2, "server: handler called per scrape");
+
+    MetricsServer second;
+    Check(!second.Start("127.0.0.1", server.GetPort(), [] { return std::string(); }), "server: port in use");
+    Check(!second.Start("not an address", 0, [] { return std::string(); }), "server: bad address");
+
+    server.Stop();
+    Check(!server.IsRunning(), "server: stopped");
+    Check(Fetch(server.GetPort(), "GET /metrics HTTP/1.1\r\n\r\n").empty(), "server: closed after stop");
+}
+
+int main() {
+    std::cout << "SplashTop Metrics Test" << std::endl;
+    std::cout << "======================" << std::endl;
+
+    TestHistogram();
+    TestWriter();
+    TestServer();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All metrics tests passed" << std::endl;
+    return 0;
+}
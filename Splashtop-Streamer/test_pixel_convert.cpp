@@ -0,0 +1,110 @@
+#include "platform.h"
+#include "pixel_convert.h"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstring>
+
+using namespace SplashTop;
+
+struct LayoutCase {
+    const char* name;
+    PixelLayout layout;
+};
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+// Known values so the scalar reference itself is pinned down
+static void TestScalarReference() {
+    PixelLayout xrgb = {32, 0xFF0000, 0x00FF00, 0x0000FF, false};
+    const uint8 src32[4] = {0x11, 0x22, 0x33, 0x00}; // B, G, R, X
+    uint8 dst[4] = {};
+    ConvertToBGRAWithKernel(PixelKernel::Scalar, src32, 4, xrgb, dst, 4, 1, 1);
+    Check(dst[0] == 0x11 && dst[1] == 0x22 && dst[2] == 0x33 && dst[3] == 0xFF, "scalar 32bpp xRGB");
+
+    PixelLayout rgb565 = {16, 0xF800, 0x07E0, 0x001F, false};
+    const uint8 white565[2] = {0xFF, 0xFF};
+    ConvertToBGRAWithKernel(PixelKernel::Scalar, white565, 2, rgb565, dst, 4, 1, 1);
+    Check(dst[0] == 0xFF && dst[1] == 0xFF && dst[2] == 0xFF && dst[3] == 0xFF, "scalar 565 white");
+
+    const uint8 red565[2] = {0x00, 0xF8};
+    ConvertToBGRAWithKernel(PixelKernel::Scalar, red565, 2, rgb565, dst, 4, 1, 1);
+    Check(dst[0] == 0x00 && dst[1] == 0x00 && dst[2] == 0xFF, "scalar 565 red");
+
+    PixelLayout bgr24 = {24, 0xFF0000, 0x00FF00, 0x0000FF, false};
+    const uint8 src24[3] = {0x01, 0x02, 0x03};
+    ConvertToBGRAWithKernel(PixelKernel::Scalar, src24, 3, bgr24, dst, 4, 1, 1);
+    Check(dst[0] == 0x01 && dst[1] == 0x02 && dst[2] == 0x03 && dst[3] == 0xFF, "scalar 24bpp packed");
+}
+
+// Every SIMD kernel must produce exactly the scalar output
+static void TestKernelsMatchScalar(const LayoutCase& testCase, uint32 width, uint32 height) {
+    const PixelLayout& layout = testCase.layout;
+    uint32 srcStride = width * (layout.bitsPerPixel / 8) + 7; // odd padding
+    uint32 dstStride = width * 4 + 16;
+
+    std::mt19937 rng(width * 131 + height);
+    std::vector<uint8> src(static_cast<size_t>(srcStride) * height);
+    for (auto& byte : src) byte = static_cast<uint8>(rng());
+
+    std::vector<uint8> expected(static_cast<size_t>(dstStride) * height, 0);
+    ConvertToBGRAWithKernel(PixelKernel::Scalar, src.data(), srcStride, layout,
+                            expected.data(), dstStride, width, height);
+
+    for (PixelKernel kernel : {PixelKernel::SSE2, PixelKernel::AVX2}) {
+        if (!IsPixelKernelSupported(kernel, layout)) continue;
+
+        std::vector<uint8> actual(expected.size(), 0);
+        ConvertToBGRAWithKernel(kernel, src.data(), srcStride, layout,
+                                actual.data(), dstStride, width, height);
+        Check(actual == expected, std::string(testCase.name) + " " + GetPixelKernelName(kernel) +
+              " " + std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    // The automatic dispatch must agree as well
+    std::vector<uint8> dispatched(expected.size(), 0);
+    ConvertToBGRA(src.data(), srcStride, layout, dispatched.data(), dstStride, width, height);
+    Check(dispatched == expected, std::string(testCase.name) + " dispatch");
+}
+
+int main() {
+    std::cout << "SplashTop Pixel Conversion Test" << std::endl;
+    std::cout << "===============================" << std::endl;
+    std::cout << "Best kernel: " << GetPixelKernelName(GetBestPixelKernel()) << std::endl;
+
+    TestScalarReference();
+
+    const LayoutCase cases[] = {
+        {"32bpp xRGB", {32, 0xFF0000, 0x00FF00, 0x0000FF, false}},
+        {"32bpp xBGR", {32, 0x0000FF, 0x00FF00, 0xFF0000, false}},
+        {"32bpp RGBx", {32, 0xFF000000, 0x00FF0000, 0x0000FF00, false}},
+        {"24bpp BGR", {24, 0xFF0000, 0x00FF00, 0x0000FF, false}},
+        {"24bpp RGB", {24, 0x0000FF, 0x00FF00, 0xFF0000, false}},
+        {"16bpp 565", {16, 0xF800, 0x07E0, 0x001F, false}},
+        {"16bpp 555", {16, 0x7C00, 0x03E0, 0x001F, false}},
+        {"32bpp MSB", {32, 0xFF0000, 0x00FF00, 0x0000FF, true}},
+    };
+
+    const uint32 sizes[][2] = {{1, 1}, {7, 3}, {33, 5}, {64, 4}, {257, 9}, {1920, 2}};
+
+    for (const auto& testCase : cases) {
+        for (const auto& size : sizes) {
+            TestKernelsMatchScalar(testCase, size[0], size[1]);
+        }
+    }
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All pixel conversion tests passed" << std::endl;
+    return 0;
+}
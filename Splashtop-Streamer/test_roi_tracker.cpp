@@ -0,0 +1,95 @@
+#include "platform.h"
+#include "roi_tracker.h"
+#include <iostream>
+
+using namespace SplashTop;
+
+using Clock = std::chrono::steady_clock;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+static VideoFrame MakeFrame(uint32 width, uint32 height) {
+    VideoFrame frame = {};
+    frame.width = width;
+    frame.height = height;
+    frame.stride = width * 4;
+    frame.format = 0;
+    return frame;
+}
+
+// The pointer region follows the last position, clipped, until it expires
+static void TestPointer() {
+    RoiSettings settings;
+    settings.pointerRadius = 64;
+    settings.pointerHoldMs = 1000;
+    RegionOfInterestTracker tracker(settings);
+    VideoFrame frame = MakeFrame(1920, 1080);
+    Clock::time_point t0 = Clock::now();
+
+    Check(tracker.Apply(frame, t0) == 0, "pointer: no regions before the pointer moves");
+
+    tracker.OnPointerMoved(500, 400, t0);
+    Check(tracker.Apply(frame, t0) == 1, "pointer: region after a move");
+    const Rect& rect = frame.regionsOfInterest[0].rect;
+    Check(rect.x == 436 && rect.y == 336 && rect.width == 128 && rect.height == 128, "pointer: box around the pointer");
+    Check(frame.regionsOfInterest[0].qpOffset < 0, "pointer: better quality");
+
+    tracker.OnPointerMoved(10, 1070, t0);
+    tracker.Apply(frame, t0 + std::chrono::milliseconds(500));
+    const Rect& clipped = frame.regionsOfInterest[0].rect;
+    Check(clipped.x == 0 && clipped.y == 1006 && clipped.width == 74 && clipped.height == 74, "pointer: clipped to the frame");
+
+    Check(tracker.Apply(frame, t0 + std::chrono::milliseconds(1500)) == 0, "pointer: expires when idle");
+}
+
+// Damage is held for a while, full-screen repaints and old rects are dropped
+static void TestDamage() {
+    RoiSettings settings;
+    settings.damageHoldMs = 500;
+    settings.maxRegions = 3;
+    RegionOfInterestTracker tracker(settings);
+    VideoFrame frame = MakeFrame(1920, 1080);
+    Clock::time_point t0 = Clock::now();
+
+    frame.hasDamageInfo = true;
+    frame.dirtyRects = {{100, 100, 50, 20}, {0, 0, 1920, 1080}};
+    Check(tracker.Apply(frame, t0) == 1, "damage: full-screen repaint ignored");
+    Check(frame.regionsOfInterest[0].rect.x == 100, "damage: rect kept");
+
+    frame.dirtyRects.clear();
+    Check(tracker.Apply(frame, t0 + std::chrono::milliseconds(400)) == 1, "damage: held");
+    Check(tracker.Apply(frame, t0 + std::chrono::milliseconds(600)) == 0, "damage: expires");
+
+    Clock::time_point t1 = t0 + std::chrono::seconds(1);
+    frame.dirtyRects = {{1, 1, 10, 10}, {2, 2, 10, 10}, {3, 3, 10, 10}};
+    Check(tracker.Apply(frame, t1) == 2, "damage: capped, one slot left for the pointer");
+    Check(frame.regionsOfInterest[0].rect.x == 2, "damage: oldest dropped");
+
+    tracker.OnPointerMoved(960, 540, t1);
+    frame.dirtyRects.clear();
+    Check(tracker.Apply(frame, t1) == 3, "damage: pointer added");
+    Check(frame.regionsOfInterest[0].qpOffset == settings.pointerQpOffset, "damage: pointer region first");
+}
+
+int main() {
+    std::cout << "SplashTop ROI Tracker Test" << std::endl;
+    std::cout << "==========================" << std::endl;
+
+    TestPointer();
+    TestDamage();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All ROI tracker tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "platform.h"
+#include "stage_queue.h"
+#include <iostream>
+
+using namespace SplashTop;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+using Queue = StageQueue<int>;
+
+// Items come out in order; the capacity is rounded up to a power of two
+static void TestOrder() {
+    Queue queue(3, Queue::Policy::Block);
+    Check(queue.GetCapacity() == 4, "order: capacity rounded up");
+
+    int item = 0;
+    Check(!queue.TryPop(item), "order: empty at start");
+    for (int i = 1; i <= 4; i++) Check(queue.Push(i), "order: push");
+    Check(queue.GetStats().depth == 4, "order: depth when full");
+    for (int i = 1; i <= 4; i++) {
+        Check(queue.TryPop(item) && item == i, "order: pop in order");
+    }
+    Check(!queue.TryPop(item), "order: empty again");
+    Check(!queue.Pop(item, std::chrono::milliseconds(5)), "order: pop times out");
+
+    queue.Close();
+    Check(!queue.Push(5), "order: push fails when closed");
+    queue.Reset();
+    Check(queue.Push(6) && queue.TryPop(item) && item == 6, "order: usable after reset");
+}
+
+// A full DropOldest queue evicts its oldest droppable item and hands it to
+// the callback; a non-droppable item makes the producer wait instead
+static void TestDropOldest() {
+    Queue queue(2, Queue::Policy::DropOldest);
+    int merged = 0;
+    auto merge = [&](int& evicted, int& next) {
+        merged += evicted;
+        next += 100;
+    };
+
+    queue.Push(1, true, merge);
+    queue.Push(2, true, merge);
+    queue.Push(3, true, merge);
+    Check(merged == 1, "drop: oldest evicted");
+    Check(queue.GetStats().dropped == 1, "drop: counted");
+
+    int item = 0;
+    Check(queue.TryPop(item) && item == 2, "drop: second item kept");
+    Check(queue.TryPop(item) && item == 103, "drop: newest item sees the eviction");
+
+    queue.Push(10, false, merge);
+    queue.Push(11, true, merge);
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int popped = 0;
+        queue.TryPop(popped);
+        Check(popped == 10, "drop: keyframe still queued");
+    });
+    queue.Push(12, true, merge);
+    consumer.join();
+    Check(merged == 1, "drop: keyframe never evicted");
+    Check(queue.GetStats().producerWaitMicros > 0, "drop: producer waited for the keyframe");
+    Check(queue.TryPop(item) && item == 11, "drop: order kept after waiting");
+    Check(queue.TryPop(item) && item == 12, "drop: last item");
+}
+
+// One producer and one consumer: everything pushed is either received in
+// order or (DropOldest only) evicted
+static void TestThreaded(Queue::Policy policy, const std::string& name) {
+    const int count = 200000;
+    Queue queue(2, policy);
+    int evicted = 0;
+    int received = 0;
+    bool ordered = true;
+
+    std::thread consumer([&] {
+        int last = 0;
+        int item = 0;
+        while (queue.Pop(item, std::chrono::milliseconds(100))) {
+            if (item <= last) ordered = false;
+            last = item;
+            received++;
+        }
+    });
+    for (int i = 1; i <= count; i++) {
+        queue.Push(i, i % 1000 != 0, [&](int&, int&) { evicted++; });
+    }
+    queue.Close();
+    consumer.join();
+
+    StageQueueStats stats = queue.GetStats();
+    Check(ordered, name + ": items in order");
+    Check(stats.pushed == static_cast<uint64>(count), name + ": all pushed");
+    Check(received + evicted == count, name + ": nothing lost");
+    Check(stats.dropped == static_cast<uint64>(evicted), name + ": drops counted");
+    if (policy == Queue::Policy::Block) Check(evicted == 0, name + ": nothing dropped");
+    std::cout << name << ": " << received << " received, " << evicted << " dropped, average depth "
+              << stats.averageDepth << std::endl;
+}
+
+int main() {
+    std::cout << "SplashTop Stage Queue Test" << std::endl;
+    std::cout << "==========================" << std::endl;
+
+    TestOrder();
+    TestDropOldest();
+    TestThreaded(Queue::Policy::Block, "block");
+    TestThreaded(Queue::Policy::DropOldest, "drop oldest");
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All stage queue tests passed" << std::endl;
+    return 0;
+}
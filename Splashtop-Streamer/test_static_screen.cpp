@@ -0,0 +1,137 @@
+#include "platform.h"
+#include "static_screen_detector.h"
+#include <iostream>
+#include <vector>
+
+using namespace SplashTop;
+
+using Action = StaticScreenDetector::Action;
+using Clock = std::chrono::steady_clock;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+static VideoFrame MakeFrame(std::vector<uint8>& pixels, uint32 width, uint32 height) {
+    VideoFrame frame = {};
+    frame.data = pixels.data();
+    frame.width = width;
+    frame.height = height;
+    frame.stride = width * 4;
+    frame.format = 0;
+    return frame;
+}
+
+// Frames numbered by the capture, with and without a change map
+static void TestSequencedFrames() {
+    std::vector<uint8> pixels(128 * 64 * 4, 0);
+    VideoFrame frame = MakeFrame(pixels, 128, 64);
+    StaticScreenSettings settings;
+    settings.keepaliveMs = 1000;
+    settings.refineDelayMs = 200;
+    settings.refineFrames = 2;
+    StaticScreenDetector detector(settings);
+
+    Clock::time_point t0 = Clock::now();
+    auto at = [t0](int ms) { return t0 + std::chrono::milliseconds(ms); };
+
+    frame.sequence = 1;
+    frame.dirtyTiles.Resize(128, 64, 64);
+    frame.dirtyTiles.SetAll();
+    Check(detector.Update(frame, at(0)) == Action::Encode, "first frame encoded");
+
+    // The same frame handed out again is skipped until refinement is due
+    Check(detector.Update(frame, at(33)) == Action::Skip, "repeated frame skipped");
+    Check(detector.Update(frame, at(66)) == Action::Skip, "repeated frame skipped again");
+    Check(detector.Update(frame, at(200)) == Action::Refine, "first refinement");
+    Check(frame.dirtyTiles.CountDirty() == 0, "refinement frame marked unchanged");
+    Check(detector.Update(frame, at(233)) == Action::Refine, "second refinement");
+    Check(detector.Update(frame, at(266)) == Action::Skip, "refinement done");
+
+    // Keepalive a second after the last frame sent
+    Check(detector.Update(frame, at(1200)) == Action::Skip, "no keepalive yet");
+    Check(detector.Update(frame, at(1233)) == Action::Keepalive, "keepalive");
+    Check(detector.Update(frame, at(1266)) == Action::Skip, "skip after keepalive");
+
+    // A new frame whose change map is empty is still static
+    frame.sequence = 2;
+    frame.dirtyTiles.Clear();
+    Check(detector.Update(frame, at(1300)) == Action::Skip, "new but identical frame skipped");
+
+    frame.sequence = 3;
+    frame.dirtyTiles.SetDirty(1, 0);
+    Check(detector.Update(frame, at(1333)) == Action::Encode, "changed frame encoded");
+
+    Check(detector.GetSkippedFrames() == 6, "skipped frames counted");
+}
+
+// Captures without sequence numbers or change info fall back to hashing
+static void TestHashedFrames() {
+    std::vector<uint8> pixels(200 * 100 * 4, 0);
+    VideoFrame frame = MakeFrame(pixels, 200, 100);
+    StaticScreenSettings settings;
+    settings.keepaliveMs = 0;
+    settings.refineFrames = 0;
+    StaticScreenDetector detector(settings);
+
+    Clock::time_point now = Clock::now();
+    Check(detector.Update(frame, now) == Action::Encode, "hashed: first frame encoded");
+    for (int i = 0; i < 100; i++) {
+        now += std::chrono::milliseconds(33);
+        if (detector.Update(frame, now) != Action::Skip) {
+            Check(false, "hashed: static frame not skipped");
+            break;
+        }
+    }
+
+    pixels[(50 * 200 + 150) * 4] ^= 0xFF;
+    Check(detector.Update(frame, now) == Action::Encode, "hashed: changed pixel encoded");
+    Check(detector.Update(frame, now) == Action::Skip, "hashed: unchanged again");
+}
+
+// YUV420 frames are hashed per plane, so a change in chroma alone counts
+static void TestHashedYuvFrames() {
+    const uint32 width = 198, height = 99, stride = 200;
+    std::vector<uint8> planes(VideoFrame::GetYuv420Size(stride, height), 0);
+    VideoFrame frame = MakeFrame(planes, width, height);
+    frame.stride = stride;
+    frame.format = 2;
+    StaticScreenSettings settings;
+    settings.keepaliveMs = 0;
+    settings.refineFrames = 0;
+    StaticScreenDetector detector(settings);
+
+    Clock::time_point now = Clock::now();
+    Check(detector.Update(frame, now) == Action::Encode, "yuv: first frame encoded");
+    now += std::chrono::milliseconds(33);
+    Check(detector.Update(frame, now) == Action::Skip, "yuv: static frame skipped");
+
+    frame.GetVPlane()[49 * (stride / 2) + 98] ^= 0xFF; // Last chroma row and column
+    Check(detector.Update(frame, now) == Action::Encode, "yuv: chroma change encoded");
+    Check(detector.Update(frame, now) == Action::Skip, "yuv: unchanged again");
+
+    planes[10 * stride + 197] ^= 0xFF;
+    Check(detector.Update(frame, now) == Action::Encode, "yuv: luma change encoded");
+}
+
+int main() {
+    std::cout << "SplashTop Static Screen Test" << std::endl;
+    std::cout << "============================" << std::endl;
+
+    TestSequencedFrames();
+    TestHashedFrames();
+    TestHashedYuvFrames();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All static screen tests passed" << std::endl;
+    return 0;
+}
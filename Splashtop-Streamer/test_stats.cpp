@@ -0,0 +1,125 @@
+#include "platform.h"
+#include "stats.h"
+#include <cmath>
+#include <iostream>
+
+using namespace SplashTop;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+static bool Near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+}
+
+// Adds from several threads all land, whichever shard they go to
+static void TestCounter() {
+    Check(alignof(LatencyHistogram) == kCacheLineSize, "counter: histograms start on their own line");
+    Check(sizeof(StatCounter) == StatCounter::kShardCount * kCacheLineSize, "counter: one line per shard");
+
+    StatCounter counter;
+    const int kThreads = 4;
+    const int kAdds = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < kAdds; i++) counter.Add();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    Check(counter.Get() == static_cast<uint64>(kThreads) * kAdds, "counter: every add counted");
+
+    counter.Add(5);
+    Check(counter.Get() == static_cast<uint64>(kThreads) * kAdds + 5, "counter: add amount");
+    counter.Reset();
+    Check(counter.Get() == 0, "counter: reset");
+}
+
+// The first interval sets the rate, later ones move it by the time-weighted
+// EWMA step
+static void TestRate() {
+    RateEstimator rate(2.0);
+    Check(rate.Update(1000, 0) == 0.0, "rate: no rate from one sample");
+    Check(Near(rate.Update(1100, 1000000), 100.0, 1e-9), "rate: first interval taken as is");
+
+    double expected = 100.0 + (1.0 - std::exp(-0.5)) * (300.0 - 100.0);
+    Check(Near(rate.Update(1400, 2000000), expected, 1e-9), "rate: EWMA step");
+    Check(Near(rate.Update(5000, 2010000), expected, 1e-9), "rate: too soon to fold in");
+
+    // A steady 30/s wins over the window whatever the reading interval
+    uint64 total = 1400;
+    for (uint64 t = 2100000; t <= 20000000; t += 100000) {
+        total += 3;
+        rate.Update(total, t);
+    }
+    Check(Near(rate.Get(), 30.0, 0.5), "rate: converges");
+
+    Check(rate.Update(10, 20100000) == 0.0, "rate: total going back starts over");
+    rate.Reset();
+    Check(rate.Get() == 0.0, "rate: reset");
+}
+
+// Items, bytes and the time of the last whole item; partial items add bytes only
+static void TestThroughput() {
+    ThroughputMeter meter;
+    Check(meter.GetLastMillis() == 0, "throughput: no time before the first item");
+    meter.GetRates();
+
+    for (int i = 0; i < 10; i++) {
+        meter.Record(1000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    meter.Record(500, 0);
+    Check(meter.GetItems() == 10, "throughput: items");
+    Check(meter.GetBytes() == 10500, "throughput: bytes include partial items");
+    Check(meter.GetLastMillis() > 0 && meter.GetLastMillis() <= StatsNowMicros() / 1000, "throughput: last item time");
+
+    ThroughputMeter::Rates rates = meter.GetRates();
+    Check(rates.itemsPerSecond > 0.0 && rates.itemsPerSecond <= 100.0 * 1.05, "throughput: item rate");
+    Check(Near(rates.bitsPerSecond, rates.itemsPerSecond * 1050 * 8, rates.bitsPerSecond * 0.01),
+          "throughput: bit rate");
+
+    meter.Reset();
+    Check(meter.GetItems() == 0 && meter.GetBytes() == 0 && meter.GetLastMillis() == 0, "throughput: reset");
+}
+
+// Percentiles report the upper bound of the bucket they fall in
+static void TestPercentile() {
+    LatencyHistogram histogram;
+    Check(histogram.GetSnapshot().GetPercentileMicros(0.5) == 0, "percentile: empty");
+
+    for (int i = 0; i < 90; i++) histogram.Observe(200);
+    for (int i = 0; i < 10; i++) histogram.Observe(20000);
+    LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+    Check(snapshot.GetPercentileMicros(0.5) == 250, "percentile: p50");
+    Check(snapshot.GetPercentileMicros(0.9) == 250, "percentile: p90 at the edge");
+    Check(snapshot.GetPercentileMicros(0.99) == 25000, "percentile: p99");
+    Check(snapshot.GetPercentileMicros(0.0) == 250, "percentile: p0 is the first sample");
+
+    histogram.Observe(5000000);
+    Check(histogram.GetSnapshot().GetPercentileMicros(1.0) == 1000000, "percentile: overflow reports the last bound");
+}
+
+int main() {
+    std::cout << "SplashTop Stats Test" << std::endl;
+    std::cout << "====================" << std::endl;
+
+    TestCounter();
+    TestRate();
+    TestThroughput();
+    TestPercentile();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All stats tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "platform.h"
+#include "tile_video_encoder.h"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstring>
+
+using namespace SplashTop;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+// Padded BGRA image with random garbage in the alpha channel, which the
+// codec must ignore
+struct TestImage {
+    uint32 width, height, stride;
+    std::vector<uint8> pixels;
+
+    TestImage(uint32 w, uint32 h) : width(w), height(h), stride(w * 4 + 12), pixels(static_cast<size_t>(stride) * h) {}
+
+    void Set(uint32 x, uint32 y, uint32 color) {
+        std::memcpy(pixels.data() + static_cast<size_t>(y) * stride + x * 4, &color, 4);
+    }
+
+    // Fill a block with colors drawn from a palette of the given size
+    void Fill(uint32 x0, uint32 y0, uint32 w, uint32 h, uint32 colors, uint32 runLength, uint32 seed) {
+        std::mt19937 rng(seed);
+        std::vector<uint32> palette(colors);
+        for (auto& color : palette) color = rng() & 0x00FFFFFF;
+        uint32 color = palette[0];
+        for (uint32 y = y0; y < y0 + h && y < height; y++) {
+            for (uint32 x = x0; x < x0 + w && x < width; x++) {
+                if (rng() % runLength == 0) color = palette[rng() % colors];
+                Set(x, y, color | (rng() << 24));
+            }
+        }
+    }
+
+    VideoFrame Frame() {
+        VideoFrame frame;
+        frame.data = pixels.data();
+        frame.width = width;
+        frame.height = height;
+        frame.stride = stride;
+        frame.timestamp = 0;
+        frame.format = 0;
+        return frame;
+    }
+};
+
+static bool SameImage(const TestImage& image, const TileFrameDecoder& decoder) {
+    if (decoder.GetWidth() != image.width || decoder.GetHeight() != image.height) return false;
+    for (uint32 y = 0; y < image.height; y++) {
+        for (uint32 x = 0; x < image.width; x++) {
+            uint32 expected, actual;
+            std::memcpy(&expected, image.pixels.data() + static_cast<size_t>(y) * image.stride + x * 4, 4);
+            std::memcpy(&actual, decoder.GetImage().data() + static_cast<size_t>(y) * decoder.GetStride() + x * 4, 4);
+            if (((expected & 0x00FFFFFF) | 0xFF000000) != actual) return false;
+        }
+    }
+    return true;
+}
+
+// Every analysis kernel must report the same palette and run count
+static void TestAnalyzeKernels() {
+    const uint32 colorCounts[] = {1, 2, 3, 16, 17, 127, 128, 5000};
+    const uint32 sizes[][2] = {{64, 64}, {1, 1}, {13, 7}, {33, 64}};
+
+    for (uint32 colors : colorCounts) {
+        for (const auto& size : sizes) {
+            TestImage image(size[0], size[1]);
+            image.Fill(0, 0, size[0], size[1], colors, 5, colors * 7 + size[0]);
+
+            TilePalette expected;
+            AnalyzeTile(PixelKernel::Scalar, image.pixels.data(), image.stride, size[0], size[1], expected);
+
+            for (PixelKernel kernel : {PixelKernel::SSE2, PixelKernel::AVX2}) {
+                if (!IsPixelKernelAvailable(kernel)) continue;
+                TilePalette actual;
+                AnalyzeTile(kernel, image.pixels.data(), image.stride, size[0], size[1], actual);
+                bool same = actual.count == expected.count && actual.runs == expected.runs &&
+                            std::equal(expected.colors, expected.colors + TilePalette::kMaxColors + 1, actual.colors);
+                Check(same, std::string("analyze ") + GetPixelKernelName(kernel) + " " + std::to_string(colors) +
+                      " colors " + std::to_string(size[0]) + "x" + std::to_string(size[1]));
+            }
+        }
+    }
+
+    TestImage solid(64, 64);
+    solid.Fill(0, 0, 64, 64, 1, 1, 1);
+    TilePalette palette;
+    AnalyzeTile(GetBestPixelKernel(), solid.pixels.data(), solid.stride, 64, 64, palette);
+    Check(palette.count == 1 && palette.runs == 1, "solid tile has one run");
+}
+
+// Desktop-like frame: flat background, text-like blocks, an icon-ish area
+// and a noisy "photo" that has to fall back to raw
+static void DrawDesktop(TestImage& image) {
+    image.Fill(0, 0, image.width, image.height, 1, 1, 10);
+    image.Fill(10, 10, 120, 40, 2, 3, 11);
+    image.Fill(70, 60, 50, 50, 12, 4, 12);
+    image.Fill(140, 20, 60, 30, 100, 8, 13);
+    image.Fill(130, 80, 70, 50, 5000, 1, 14);
+}
+
+static void TestRoundTrip() {
+    TestImage image(200, 130); // Partial tiles on the right and bottom
+    DrawDesktop(image);
+
+    TileVideoEncoder encoder(64);
+    TileFrameDecoder decoder;
+    Check(encoder.Initialize(image.width, image.height, 30, 0), "initialize");
+
+    std::vector<uint8> keyframe;
+    VideoFrame frame = image.Frame();
+    Check(encoder.EncodeFrame(frame, keyframe), "encode keyframe");
+    Check(decoder.Decode(keyframe.data(), keyframe.size()), "decode keyframe");
+    Check(SameImage(image, decoder), "keyframe is lossless");
+
+    // A small change only sends the touched tile
+    image.Fill(5, 70, 20, 10, 3, 2, 20);
+    std::vector<uint8> update;
+    Check(encoder.EncodeFrame(frame, update), "encode update");
+    Check(update.size() < keyframe.size() / 4, "update smaller than keyframe");
+    Check(decoder.Decode(update.data(), update.size()), "decode update");
+    Check(SameImage(image, decoder), "update is lossless");
+
+    // Nothing changed: an empty update
+    Check(encoder.EncodeFrame(frame, update), "encode static frame");
+    Check(update.size() <= 32, "static frame is tiny");
+    Check(decoder.Decode(update.data(), update.size()), "decode static frame");
+
+    // Sliced output decodes slice by slice
+    encoder.SetSliceCount(3);
+    DrawDesktop(image);
+    image.Fill(0, 0, image.width, image.height, 40, 6, 30);
+    uint32 slices = 0;
+    bool decoded = true;
+    EncodedPacket packet;
+    Check(encoder.EncodePacket(frame, packet, [&](const EncodedSlice& slice) {
+        slices++;
+        decoded &= decoder.Decode(slice.data, slice.size);
+    }), "encode slices");
+    Check(slices == 3 && decoded, "decode slices");
+    Check(packet.GetSliceCount() == 3 && packet.sliceEnds.back() == packet.data.size(), "packet holds every slice");
+    Check(SameImage(image, decoder), "slices are lossless");
+
+    // Truncated or corrupt input is rejected
+    Check(!decoder.Decode(keyframe.data(), keyframe.size() - 1), "truncated message rejected");
+    std::vector<uint8> corrupt = keyframe;
+    corrupt[0] ^= 0xFF;
+    Check(!decoder.Decode(corrupt.data(), corrupt.size()), "bad magic rejected");
+
+    // A new decoder cannot start from an update
+    TileFrameDecoder fresh;
+    Check(encoder.EncodeFrame(frame, update), "encode for fresh decoder");
+    Check(!fresh.Decode(update.data(), update.size()), "update without keyframe rejected");
+}
+
+// Intra refresh heals a lost update without keyframes; a requested
+// keyframe lets a new decoder start
+static void TestLossRecovery() {
+    TestImage image(200, 130); // Four tile columns
+    DrawDesktop(image);
+
+    TileVideoEncoder encoder(64);
+    TileFrameDecoder decoder;
+    Check(encoder.Initialize(image.width, image.height, 30, 0), "recovery: initialize");
+    encoder.SetKeyframeInterval(4);
+    encoder.SetIntraRefresh(true);
+
+    VideoFrame frame = image.Frame();
+    EncodedPacket packet;
+    Check(encoder.EncodePacket(frame, packet, nullptr) && packet.keyframe, "recovery: first frame is a keyframe");
+    Check(decoder.Decode(packet.data.data(), packet.data.size()), "recovery: decode keyframe");
+
+    // This update never reaches the decoder
+    image.Fill(20, 20, 150, 100, 7, 3, 40);
+    Check(encoder.EncodePacket(frame, packet, nullptr), "recovery: encode lost update");
+
+    bool keyframes = false;
+    for (int i = 0; i < 4; i++) {
+        Check(encoder.EncodePacket(frame, packet, nullptr), "recovery: encode refresh");
+        keyframes |= packet.keyframe;
+        Check(decoder.Decode(packet.data.data(), packet.data.size()), "recovery: decode refresh");
+    }
+    Check(!keyframes, "recovery: no keyframes with intra refresh");
+    Check(SameImage(image, decoder), "recovery: picture healed within one interval");
+
+    encoder.RequestKeyframe();
+    TileFrameDecoder fresh;
+    Check(encoder.EncodePacket(frame, packet, nullptr) && packet.keyframe, "recovery: requested keyframe");
+    Check(fresh.Decode(packet.data.data(), packet.data.size()) && SameImage(image, fresh),
+          "recovery: new decoder starts from requested keyframe");
+}
+
+int main() {
+    std::cout << "SplashTop Tile Codec Test" << std::endl;
+    std::cout << "=========================" << std::endl;
+    std::cout << "Best kernel: " << GetPixelKernelName(GetBestPixelKernel()) << std::endl;
+
+    TestAnalyzeKernels();
+    TestRoundTrip();
+    TestLossRecovery();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All tile codec tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "platform.h"
+#include "yuv_convert.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace SplashTop;
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+// Planes of a 4:2:0 image with padded strides, which the conversion must keep
+struct TestYuv {
+    uint32 width, height, chromaWidth, chromaHeight;
+    std::vector<uint8> y, u, v;
+    YuvImage image;
+
+    TestYuv(uint32 w, uint32 h, YuvLayout layout)
+        : width(w), height(h), chromaWidth((w + 1) / 2), chromaHeight((h + 1) / 2) {
+        image.layout = layout;
+        image.yStride = w + 16;
+        image.uStride = (layout == YuvLayout::NV12 ? chromaWidth * 2 : chromaWidth) + 16;
+        image.vStride = layout == YuvLayout::NV12 ? 0 : chromaWidth + 16;
+        y.assign(static_cast<size_t>(image.yStride) * h, 0xAA);
+        u.assign(static_cast<size_t>(image.uStride) * chromaHeight, 0xAA);
+        v.assign(std::max<size_t>(1, static_cast<size_t>(image.vStride) * chromaHeight), 0xAA);
+        image.y = y.data();
+        image.u = u.data();
+        image.v = v.data();
+    }
+
+    uint8 Y(uint32 x, uint32 row) const { return y[static_cast<size_t>(row) * image.yStride + x]; }
+
+    uint8 U(uint32 x, uint32 row) const {
+        if (image.layout == YuvLayout::NV12) return u[static_cast<size_t>(row) * image.uStride + x * 2];
+        return u[static_cast<size_t>(row) * image.uStride + x];
+    }
+
+    uint8 V(uint32 x, uint32 row) const {
+        if (image.layout == YuvLayout::NV12) return u[static_cast<size_t>(row) * image.uStride + x * 2 + 1];
+        return v[static_cast<size_t>(row) * image.vStride + x];
+    }
+};
+
+// Straight from the matrix definition, in floating point
+struct Reference {
+    double kr, kb, yScale, yOffset, cScale;
+
+    explicit Reference(const YuvFormat& format) {
+        kr = format.matrix == YuvMatrix::BT601 ? 0.299 : 0.2126;
+        kb = format.matrix == YuvMatrix::BT601 ? 0.114 : 0.0722;
+        bool limited = format.range == YuvRange::Limited;
+        yScale = limited ? 219.0 / 255.0 : 1.0;
+        yOffset = limited ? 16.0 : 0.0;
+        cScale = limited ? 224.0 / 255.0 : 1.0;
+    }
+
+    double Luma(double b, double g, double r) const { return kr * r + (1.0 - kr - kb) * g + kb * b; }
+    double Y(double b, double g, double r) const { return yOffset + yScale * Luma(b, g, r); }
+    double U(double b, double g, double r) const { return 128.0 + cScale * (b - Luma(b, g, r)) / (2.0 * (1.0 - kb)); }
+    double V(double b, double g, double r) const { return 128.0 + cScale * (r - Luma(b, g, r)) / (2.0 * (1.0 - kr)); }
+};
+
+static bool Near(uint8 actual, double expected) {
+    return std::fabs(actual - std::min(255.0, std::max(0.0, expected))) <= 1.0;
+}
+
+static const char* FormatName(const YuvFormat& format) {
+    if (format.matrix == YuvMatrix::BT601) return format.range == YuvRange::Limited ? "bt601 limited" : "bt601 full";
+    return format.range == YuvRange::Limited ? "bt709 limited" : "bt709 full";
+}
+
+// Every kernel stays within 1 LSB of the floating-point reference, and all
+// kernels agree exactly, on odd sizes and both layouts
+static void TestAgainstReference() {
+    const uint32 sizes[][2] = {{1, 1}, {7, 3}, {33, 17}, {64, 2}, {101, 51}};
+    const YuvFormat formats[] = {{YuvMatrix::BT601, YuvRange::Limited}, {YuvMatrix::BT601, YuvRange::Full},
+                                 {YuvMatrix::BT709, YuvRange::Limited}, {YuvMatrix::BT709, YuvRange::Full}};
+    std::mt19937 rng(42);
+
+    for (const auto& size : sizes) {
+        const uint32 width = size[0], height = size[1];
+        const uint32 srcStride = width * 4 + 20;
+        std::vector<uint8> src(static_cast<size_t>(srcStride) * height);
+        for (auto& byte : src) byte = static_cast<uint8>(rng());
+
+        for (const YuvFormat& format : formats) {
+            for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12}) {
+                const std::string name = std::string(FormatName(format)) +
+                                         (layout == YuvLayout::NV12 ? " nv12 " : " i420 ") +
+                                         std::to_string(width) + "x" + std::to_string(height);
+                Reference ref(format);
+
+                TestYuv scalar(width, height, layout);
+                ConvertBGRAToYuvWithKernel(PixelKernel::Scalar, src.data(), srcStride, width, height,
+                                           scalar.image, format);
+
+                bool lumaOk = true, chromaOk = true;
+                for (uint32 y = 0; y < height; y++) {
+                    for (uint32 x = 0; x < width; x++) {
+                        const uint8* p = src.data() + static_cast<size_t>(y) * srcStride + x * 4;
+                        lumaOk &= Near(scalar.Y(x, y), ref.Y(p[0], p[1], p[2]));
+                    }
+                }
+                for (uint32 cy = 0; cy < scalar.chromaHeight; cy++) {
+                    for (uint32 cx = 0; cx < scalar.chromaWidth; cx++) {
+                        double b = 0, g = 0, r = 0;
+                        for (uint32 dy = 0; dy < 2; dy++) {
+                            for (uint32 dx = 0; dx < 2; dx++) {
+                                uint32 x = std::min(cx * 2 + dx, width - 1);
+                                uint32 y = std::min(cy * 2 + dy, height - 1);
+                                const uint8* p = src.data() + static_cast<size_t>(y) * srcStride + x * 4;
+                                b += p[0] / 4.0;
+                                g += p[1] / 4.0;
+                                r += p[2] / 4.0;
+                            }
+                        }
+                        chromaOk &= Near(scalar.U(cx, cy), ref.U(b, g, r)) && Near(scalar.V(cx, cy), ref.V(b, g, r));
+                    }
+                }
+                Check(lumaOk, "scalar luma " + name);
+                Check(chromaOk, "scalar chroma " + name);
+
+                for (PixelKernel kernel : {PixelKernel::SSE2, PixelKernel::AVX2}) {
+                    if (!IsPixelKernelAvailable(kernel)) continue;
+                    TestYuv simd(width, height, layout);
+                    ConvertBGRAToYuvWithKernel(kernel, src.data(), srcStride, width, height, simd.image, format);
+                    Check(simd.y == scalar.y && simd.u == scalar.u && simd.v == scalar.v,
+                          std::string(GetPixelKernelName(kernel)) + " matches scalar " + name);
+                }
+            }
+        }
+    }
+}
+
+// Known colors pin down the range and matrix
+static void TestKnownColors() {
+    const uint8 pixels[] = {255, 255, 255, 255, 0, 0, 0, 255}; // White, black
+    TestYuv limited(2, 1, YuvLayout::I420);
+    ConvertBGRAToYuv(pixels, 8, 2, 1, limited.image, {YuvMatrix::BT709, YuvRange::Limited});
+    Check(limited.Y(0, 0) == 235 && limited.Y(1, 0) == 16, "limited range white and black");
+    Check(limited.U(0, 0) == 128 && limited.V(0, 0) == 128, "grey has neutral chroma");
+
+    TestYuv full(2, 1, YuvLayout::I420);
+    ConvertBGRAToYuv(pixels, 8, 2, 1, full.image, {YuvMatrix::BT601, YuvRange::Full});
+    Check(full.Y(0, 0) == 255 && full.Y(1, 0) == 0, "full range white and black");
+
+    const uint8 red[] = {0, 0, 255, 255, 0, 0, 255, 255};
+    TestYuv red601(2, 1, YuvLayout::I420);
+    TestYuv red709(2, 1, YuvLayout::I420);
+    ConvertBGRAToYuv(red, 8, 2, 1, red601.image, {YuvMatrix::BT601, YuvRange::Full});
+    ConvertBGRAToYuv(red, 8, 2, 1, red709.image, {YuvMatrix::BT709, YuvRange::Full});
+    Check(red601.Y(0, 0) == 76 && red709.Y(0, 0) == 54, "red luma per matrix");
+    Check(red601.V(0, 0) == 255 && red709.V(0, 0) == 255, "red saturates V");
+}
+
+// Threaded bands give the same image as a single pass, padding untouched
+static void TestThreadedBands() {
+    const uint32 width = 1283, height = 1081; // Odd sizes split unevenly
+    std::vector<uint8> src(static_cast<size_t>(width) * 4 * height);
+    std::mt19937 rng(7);
+    for (auto& byte : src) byte = static_cast<uint8>(rng());
+
+    for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12}) {
+        TestYuv single(width, height, layout);
+        ConvertBGRAToYuv(src.data(), width * 4, width, height, single.image);
+
+        YuvConverter converter(4);
+        TestYuv banded(width, height, layout);
+        for (int i = 0; i < 3; i++) converter.Convert(src.data(), width * 4, width, height, banded.image);
+        Check(converter.GetThreadCount() == 4, "four threads");
+        Check(banded.y == single.y && banded.u == single.u && banded.v == single.v,
+              std::string("banded matches single pass ") + (layout == YuvLayout::NV12 ? "nv12" : "i420"));
+    }
+}
+
+// Halving while converting matches a separate 2x2 average followed by a
+// full-size conversion, for every kernel and with threaded bands
+static void TestHalfSize() {
+    const uint32 sizes[][2] = {{1, 1}, {3, 2}, {17, 9}, {64, 36}, {1283, 1081}};
+    std::mt19937 rng(11);
+    for (const auto& size : sizes) {
+        const uint32 width = size[0], height = size[1];
+        const uint32 outWidth = (width + 1) / 2, outHeight = (height + 1) / 2;
+        std::vector<uint8> src(static_cast<size_t>(width) * 4 * height);
+        for (auto& byte : src) byte = static_cast<uint8>(rng());
+
+        std::vector<uint8> halved(static_cast<size_t>(outWidth) * 4 * outHeight);
+        for (uint32 y = 0; y < outHeight; y++) {
+            for (uint32 x = 0; x < outWidth; x++) {
+                uint32 x0 = x * 2, x1 = std::min(x0 + 1, width - 1);
+                uint32 y0 = y * 2, y1 = std::min(y0 + 1, height - 1);
+                for (uint32 c = 0; c < 4; c++) {
+                    auto at = [&](uint32 px, uint32 py) { return src[(static_cast<size_t>(py) * width + px) * 4 + c]; };
+                    halved[(static_cast<size_t>(y) * outWidth + x) * 4 + c] =
+                        static_cast<uint8>((at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1) + 2) / 4);
+                }
+            }
+        }
+
+        const std::string name = std::to_string(width) + "x" + std::to_string(height);
+        TestYuv expected(outWidth, outHeight, YuvLayout::I420);
+        ConvertBGRAToYuvWithKernel(PixelKernel::Scalar, halved.data(), outWidth * 4, outWidth, outHeight,
+                                   expected.image);
+
+        TestYuv direct(outWidth, outHeight, YuvLayout::I420);
+        ConvertBGRAToYuvHalfSize(src.data(), width * 4, width, height, direct.image);
+        Check(direct.y == expected.y && direct.u == expected.u && direct.v == expected.v,
+              "half size matches average then convert " + name);
+
+        for (PixelKernel kernel : {PixelKernel::Scalar, PixelKernel::SSE2, PixelKernel::AVX2}) {
+            if (!IsPixelKernelAvailable(kernel)) continue;
+            YuvConverter converter(4);
+            converter.SetKernel(kernel);
+            converter.SetHalfSize(true);
+            TestYuv banded(outWidth, outHeight, YuvLayout::I420);
+            converter.Convert(src.data(), width * 4, width, height, banded.image);
+            Check(banded.y == expected.y && banded.u == expected.u && banded.v == expected.v,
+                  std::string("threaded half size ") + GetPixelKernelName(kernel) + " " + name);
+        }
+    }
+}
+
+int main() {
+    std::cout << "SplashTop YUV Conversion Test" << std::endl;
+    std::cout << "=============================" << std::endl;
+    std::cout << "Best kernel: " << GetPixelKernelName(GetBestPixelKernel()) << std::endl;
+
+    TestAgainstReference();
+    TestKnownColors();
+    TestThreadedBands();
+    TestHalfSize();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All YUV conversion tests passed" << std::endl;
+    return 0;
+}
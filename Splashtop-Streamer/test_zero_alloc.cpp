@@ -0,0 +1,235 @@
+#include "platform.h"
+#include "video_encoder.h"
+#include "codec_registry.h"
+#include "content_classifier.h"
+#include "hybrid_video_encoder.h"
+#include "packet_pool.h"
+#include "splashtop_app.h"
+#include "synthetic_screen_capture.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace SplashTop;
+
+// Counts every operator new on any thread while g_counting is set, so the
+// test can check that encoding into pooled packets, and the whole capture,
+// encode and send pipeline, allocate nothing
+static std::atomic<bool> g_counting(false);
+static std::atomic<uint64> g_allocations(0);
+
+void* operator new(size_t size) {
+    if (g_counting.load(std::memory_order_relaxed)) g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    if (g_counting.load(std::memory_order_relaxed)) g_allocations++;
+    size_t alignment = static_cast<size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if (void* p = std::aligned_alloc(alignment, size ? size : alignment)) return p;
+    throw std::bad_alloc();
+}
+
+// Not inlined, so GCC does not pair std::free with the caller's new
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { ::operator delete(p); }
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t align) noexcept { ::operator delete(p, align); }
+
+static int g_failures = 0;
+
+static void Check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAIL: " << message << std::endl;
+        g_failures++;
+    }
+}
+
+// Text-like cells that change a few at a time plus a noisy video region,
+// repeating every kCycle frames so buffer sizes settle during warm-up
+static const uint32 kWidth = 1280;
+static const uint32 kHeight = 720; // Partial bottom tile row
+static const uint32 kCycle = 8;
+
+static void DrawFrame(std::vector<uint8>& pixels, uint32 frameIndex) {
+    std::mt19937 rng(frameIndex % kCycle);
+    for (uint32 y = 0; y < kHeight; y++) {
+        uint32* row = reinterpret_cast<uint32*>(pixels.data() + static_cast<size_t>(y) * kWidth * 4);
+        for (uint32 x = 0; x < kWidth; x++) {
+            bool video = x >= 640 && y >= 320;
+            bool cell = (y / 16 + x / 96) % kCycle == frameIndex % kCycle;
+            if (video) {
+                row[x] = 0xFF000000 | ((x + frameIndex) & 0xFF) << 16 | ((y * 2) & 0xFF) << 8 | (rng() & 0x1F);
+            } else if (cell && (x % 7 < 3) && (y % 16 > 3)) {
+                row[x] = 0xFF202020;
+            } else {
+                row[x] = (x % 96 == 0 || y % 16 == 0) ? 0xFFC0C0C0 : 0xFFFFFFFF;
+            }
+        }
+    }
+}
+
+// The encoder on its own, encoding into pooled packets
+static void TestSteadyState(const std::string& name, IVideoEncoder& encoder, bool classify) {
+    const int warmupFrames = 4 * kCycle;
+    const int measuredFrames = 8 * kCycle;
+
+    std::vector<uint8> pixels(static_cast<size_t>(kWidth) * kHeight * 4);
+    VideoFrame frame = {};
+    frame.data = pixels.data();
+    frame.width = kWidth;
+    frame.height = kHeight;
+    frame.stride = kWidth * 4;
+    frame.format = 0;
+
+    ContentClassifier classifier(64);
+    PacketPool pool(2);
+    Check(encoder.Initialize(kWidth, kHeight, 30, 4000000), name + ": initialize");
+    encoder.SetSliceCount(4);
+
+    uint64 bytesSent = 0;
+    uint32 framesEncoded = 0;
+    for (int i = 0; i < warmupFrames + measuredFrames; i++) {
+        DrawFrame(pixels, i);
+        frame.sequence = i + 1;
+        frame.timestamp = static_cast<uint64>(i) * 33333;
+
+        if (i == warmupFrames) g_counting = true;
+        auto packet = pool.Acquire();
+        if (!packet) break;
+        if (classify) classifier.Classify(frame);
+        if (encoder.EncodePacket(frame, *packet, [&bytesSent](const EncodedSlice& slice) {
+            bytesSent += slice.size;
+        })) {
+            framesEncoded++;
+        }
+        packet.reset();
+    }
+    g_counting = false;
+
+    Check(framesEncoded == static_cast<uint32>(warmupFrames + measuredFrames), name + ": every frame encoded");
+    Check(bytesSent > 0, name + ": slices produced");
+    Check(g_allocations == 0, name + ": " + std::to_string(g_allocations) + " allocation(s) in steady state");
+    std::cout << name << ": " << g_allocations << " allocations in " << measuredFrames << " frames" << std::endl;
+    g_allocations = 0;
+}
+
+// Counts what reaches it, nothing else
+class CountingStreamer : public IWebRTCStreamer {
+public:
+    bool Initialize() override { return true; }
+    bool StartStreaming(const std::string& signalingServer, uint16 port) override {
+        (void)signalingServer; (void)port;
+        return true;
+    }
+    void StopStreaming() override {}
+    bool SendVideoFrame(const VideoFrame& frame) override { (void)frame; return true; }
+    bool SendVideoSlice(const EncodedSlice& slice) override {
+        bytes += slice.size;
+        if (slice.IsLastInFrame()) frames++;
+        return true;
+    }
+    void SetInputCallback(std::function<void(const InputEvent&)> callback) override { (void)callback; }
+    void SetConnectionStateCallback(std::function<void(bool connected)> callback) override { (void)callback; }
+    void SetKeyframeRequestCallback(std::function<void()> callback) override { (void)callback; }
+    StreamingStats GetStats() override { return StreamingStats{}; }
+    void SetBitrate(uint32 bitrate) override { (void)bitrate; }
+    void SetFPS(uint32 fps) override { (void)fps; }
+    void SetQuality(uint32 quality) override { (void)quality; }
+
+    std::atomic<uint64> bytes{0};
+    std::atomic<uint64> frames{0};
+};
+
+class NullInputInjector : public IInputInjector {
+public:
+    bool Initialize() override { return true; }
+    bool InjectMouseMove(int32 x, int32 y) override { (void)x; (void)y; return true; }
+    bool InjectMouseButton(uint32 button, bool pressed) override { (void)button; (void)pressed; return true; }
+    bool InjectMouseWheel(int32 delta) override { (void)delta; return true; }
+    bool InjectKey(uint32 key, bool pressed) override { (void)key; (void)pressed; return true; }
+    bool InjectText(const std::string& text) override { (void)text; return true; }
+    void SetCoordinateMapping(uint32 sourceWidth, uint32 sourceHeight,
+                              uint32 targetWidth, uint32 targetHeight) override {
+        (void)sourceWidth; (void)sourceHeight; (void)targetWidth; (void)targetHeight;
+    }
+    InputStats GetStats() override { return InputStats{}; }
+    bool IsAvailable() const override { return true; }
+};
+
+// SplashTopApp's own capture, encode and send stages on a scrolling text
+// desktop, counting allocations on all of their threads once warmed up
+static void TestPipeline(const std::string& codec) {
+    const std::string name = "pipeline " + codec;
+    if (!VideoCodecRegistry::Instance().IsAvailable(codec)) {
+        std::cout << name << ": not available, skipped" << std::endl;
+        return;
+    }
+
+    bool started = false;
+    uint64 framesMeasured = 0;
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    {
+        auto streamer = std::make_unique<CountingStreamer>();
+        CountingStreamer& sent = *streamer;
+
+        SplashTopApp app;
+        app.SetVideoCodec(codec);
+        app.SetScreenCapture(std::make_unique<SyntheticScreenCapture>(SyntheticWorkload::ScrollingText, kWidth, kHeight));
+        app.SetInputInjector(std::make_unique<NullInputInjector>());
+        app.SetWebRTCStreamer(std::move(streamer));
+        app.SetStreamingParameters(30, 4000000, 80);
+        app.SetSliceCount(4);
+
+        started = app.Initialize() && app.StartStreaming();
+        if (started) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            uint64 framesBefore = sent.frames;
+            g_counting = true;
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+            g_counting = false;
+            framesMeasured = sent.frames - framesBefore;
+        }
+    }
+    std::cout.rdbuf(out);
+
+    Check(started, name + ": started");
+    Check(framesMeasured > 0, name + ": frames sent");
+    Check(g_allocations == 0, name + ": " + std::to_string(g_allocations) + " allocation(s) in steady state");
+    std::cout << name << ": " << g_allocations << " allocations in " << framesMeasured << " frames" << std::endl;
+    g_allocations = 0;
+}
+
+int main() {
+    std::cout << "SplashTop Zero Allocation Test" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    auto raw = CreateVideoEncoder("raw");
+    TestSteadyState("raw", *raw, false);
+
+    auto tile = CreateVideoEncoder("tile");
+    TestSteadyState("tile", *tile, false);
+
+    // Without FFmpeg the video layer falls back to raw frames
+    HybridVideoEncoder hybrid;
+    TestSteadyState("hybrid", hybrid, true);
+
+    TestPipeline("raw");
+    TestPipeline("tile");
+    TestPipeline("hybrid");
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All zero allocation tests passed" << std::endl;
+    return 0;
+}